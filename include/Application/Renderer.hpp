@@ -2,11 +2,30 @@
 #include "common.hpp"
 #include "pch.hpp"
 
+#include <chrono>
+#include <future>
 #include <unordered_map>
 
+#include "DataType/Bvh.hpp"
 #include "DataType/Camera.hpp"
+#include "DataType/DepthPyramid.hpp"
+#include "DataType/GeometryBuffer.hpp"
+#include "DataType/GpuCuller.hpp"
+#include "DataType/GpuTimer.hpp"
+#include "DataType/IndexBuffer.hpp"
+#include "DataType/LightClusters.hpp"
+#include "DataType/Lod.hpp"
+#include "DataType/Meshlet.hpp"
 #include "DataType/Model.hpp"
+#include "DataType/ObjStreamLoader.hpp"
+#include "DataType/ParallelRecorder.hpp"
+#include "DataType/ResidencyManager.hpp"
+#include "DataType/StagingRing.hpp"
 #include "DataType/Texture.hpp"
+#include "DataType/TextureStreamer.hpp"
+#include "DataType/UniformRing.hpp"
+#include "DataType/UploadBatch.hpp"
+#include "DataType/VertexFormat.hpp"
 #include "GUI/MainWindow.hpp"
 
 #include "EasyVK/BufferAllocator.hpp"
@@ -23,6 +42,143 @@ class Device;
 
 struct RendererState {
   data::Camera camera{};
+  // triangles submitted by the last frame
+  u32 drawnTriangles{0};
+  // lod level of the last frame, 0 is the full mesh
+  u32 lodLevel{0};
+  // The scene's instances left by culling and its draws in the last frame,
+  // only eCpu culling knows the draws on the CPU. cullMs is the CPU time
+  // spent culling. eGpu culling reads its counts back a few frames late.
+  u32   visibleObjects{0};
+  u32   sceneDraws{0};
+  float cullMs{0.f};
+  u32   frustumCulledObjects{0};
+  u32   occludedObjects{0};
+  // lights the clusters of a frame a few frames back had past
+  // LightClusters::kMaxClusterLights and did not shade
+  u32   droppedLights{0};
+  // GPU time of a frame a few frames back, in ms
+  float gpuMs{0.f};
+  // CPU time of recording the last frame's render pass in ms, and whether
+  // the last frame executed a kept recording instead
+  float recordMs{0.f};
+  bool  recordingReused{false};
+};
+
+enum class SceneCulling {
+  // every instance is drawn
+  eOff,
+  // a bvh of the instances is walked on the CPU and only the visible ones
+  // are recorded
+  eCpu,
+  // a compute pass culls, see data::GpuCuller
+  eGpu,
+};
+
+struct RendererOptions {
+  std::string modelPath = "assets/space_shuttle/space-shuttle.obj";
+  // draw the model while it is still parsing when it has no mesh cache yet
+  bool streamingLoad = true;
+  // skip meshlets outside the view frustum
+  bool meshletCulling = true;
+  // how the scene's instances outside the view frustum are skipped
+  SceneCulling sceneCulling = SceneCulling::eGpu;
+  // every this many frames compare the GPU culling with the CPU and log
+  // both timings, 0 never
+  u32 gpuCullingValidationInterval = 0;
+  // with eGpu culling also skip instances hidden behind what the ones
+  // visible in the last frame drew, which pays off in dense interiors
+  bool occlusionCulling = false;
+  // every this many frames turn occlusion culling on or off and log the
+  // mean GPU frame time of both, 0 never
+  u32 occlusionBenchmarkFrames = 0;
+  // cull back faces in the pipeline, this also enables meshlet cone culling
+  bool backfaceCulling = false;
+  // vertex layout of the uploaded model, streamed chunks always use eFull
+  data::VertexFormat vertexFormat = data::VertexFormat::ePacked;
+  // draw a simplified level when the model is far away
+  bool lod = true;
+  // largest screen space error of the chosen level, in pixels
+  float lodPixelError = 1.f;
+  // decode textures in the background and draw with a placeholder until
+  // they are in, otherwise create() waits for them
+  bool streamTextures = true;
+  // staging memory shared by all uploads, larger ones are split
+  VkDeviceSize stagingRingSize = 64 << 20;
+  // first size of the shared vertex and index buffers, they grow when full
+  VkDeviceSize vertexBufferSize = 64 << 20;
+  VkDeviceSize indexBufferSize  = 32 << 20;
+  // uniform blocks one frame may write, 4096 blocks of 256 bytes
+  VkDeviceSize uniformFrameSize = 1 << 20;
+  // device memory to stay under, 0 follows the budget the driver reports
+  VkDeviceSize memoryBudget = 0;
+  // keep the model's vertices and indices in host memory after the upload
+  bool keepCpuGeometry = false;
+  // record the draws into secondary command buffers on this many threads, 0
+  // records them inline on the main thread
+  u32 recordThreads = 0;
+  // every this many frames move on to the next thread count from 1 to the
+  // most there are and log the mean recording time, 0 never
+  u32 recordBenchmarkFrames = 0;
+  // keep each frame slot's recorded draws and execute them again while the
+  // draws and what they use stay the same, which they do for a static view
+  bool reuseRecording = false;
+  // point lights shaded, the first is g_light and the others are spread
+  // over the model's bounds
+  u32 lightCount = 1;
+  // every this many frames move on to the next of 16, 256 and 4096 lights
+  // and log the mean GPU frame time, 0 never
+  u32 lightBenchmarkFrames = 0;
+};
+
+// a chunk of a model that is still streaming in
+struct StreamedMesh {
+  u32 vertexRange;
+  u32 indexRange;
+  u32 indexCount;
+};
+
+// a model read and prepared for upload, what can be done off the render
+// thread
+struct ParsedMesh {
+  data::Model                scene;
+  data::ObjModel             model;
+  std::vector<data::Meshlet> meshlets;
+  data::CompactIndices       indices;
+};
+
+// the draws of one frame's render pass, they share pipeline and index type
+struct FrameDraws {
+  VkPipeline                                pipeline;
+  VkIndexType                               indexType;
+  VkDescriptorSet                           descriptorSet;
+  u32                                       uniformOffset;
+  VkBuffer                                  vertexBuffer;
+  VkBuffer                                  indexBuffer;
+  std::vector<VkDrawIndexedIndirectCommand> draws;
+  // the GPU culler's indirect draw follows the others
+  bool gpuCulled;
+};
+
+// recording time of one thread count, see recordBenchmarkFrames
+struct RecordBenchmark {
+  u32    threads{1};
+  u32    frames{0};
+  double totalMs{0.};
+};
+
+// GPU frame times without and with occlusion culling, see
+// occlusionBenchmarkFrames
+struct OcclusionBenchmark {
+  u32    frames[2]{0, 0};
+  double totalMs[2]{0., 0.};
+  u64    occluded{0};
+};
+
+// GPU frame time of the current light count, see lightBenchmarkFrames
+struct LightBenchmark {
+  u32    frames{0};
+  double totalMs{0.};
 };
 
 class Renderer {
@@ -60,17 +216,53 @@ public:
 
   void recreateSwapchain();
 
-  void createMesh();
+  void createMesh(data::UploadBatch& upload);
   void destroyMesh();
+  // the model alone, unloadMesh() frees it and loadMesh() brings it back
+  void loadMesh(data::UploadBatch& upload);
+  void unloadMesh();
+  void trackMesh();
+  void uploadStreamedMeshes();
+
+  // loadMesh() in two steps, so the parse can run off the render thread. An
+  // obj model that streams is not parsed, streamMesh() hands it to
+  // m_streamLoader instead and is false for every other model
+  bool              streamMesh();
+  static ParsedMesh ParseMesh(const std::string& modelPath);
+  void              uploadMesh(data::UploadBatch& upload, ParsedMesh&& mesh);
+
+  // adds the scene's instances in frustum to m_frameDraws, returns the
+  // indices drawn
+  u32 cullSceneOnCpu(const data::Frustum& frustum, u32 firstIndex,
+                     i32 vertexOffset);
+  // binds the pipeline, uniforms and buffers of m_frameDraws
+  void bindDrawState(VkCommandBuffer cmd) const;
+  // draws [begin, end) of m_frameDraws with the state they need
+  void recordDraws(VkCommandBuffer cmd, u32 begin, u32 end) const;
+  // reads the counts and timings of the frame that last used frame's slot
+  void readFrameStats(u64 frame);
+  // fills m_lightClusters within the model's bounds, again when they
+  // changed
+  void placeLights();
+  // lights shaded in frame, the benchmark's count while it runs
+  u32 lightCount(u64 frame) const;
+  // drops the kept recordings, for when something they use but do not
+  // compare changes, like descriptor sets, pipelines or buffers
+  void invalidateRecordings();
+  // reloads what is evicted and in view, then evicts what is over budget
+  void updateResidency(const glm::mat4& viewProj);
 
   void createDescriptorSets();
   void destroyDescriptorSets();
 
   void createTextures();
   void destroyTextures();
+  void writeTextureDescriptor(u32 set);
+  void writeInstanceDescriptor(u32 set);
 
 public:
-  RendererState m_state;
+  RendererState   m_state;
+  RendererOptions m_options;
 
   gui::MainWindow m_window;
 
@@ -86,6 +278,11 @@ public:
   VkImageView          m_resolveView;
 
   VkRenderPass m_renderPass;
+  // compatible with m_renderPass, for the two phases of occlusion culling:
+  // the first keeps the depth for the pyramid and the second goes on with
+  // what the first drew
+  VkRenderPass m_earlyRenderPass;
+  VkRenderPass m_lateRenderPass;
 
   ezvk::Framebuffer m_frameBuffer;
 
@@ -94,25 +291,101 @@ public:
   VkPipelineCache                               m_defaultPipelineCache;
   VkPipelineLayout                              m_defaultPipelineLayout;
 
+  // same layout as the default pipeline but reads PackedVertex
+  std::unique_ptr<ezvk::GraphicPipelineBuilder> m_packedPipelineBuilder;
+  VkPipeline                                    m_packedPipeline;
+  VkPipelineCache                               m_packedPipelineCache;
+
   ezvk::CommandPool m_transientCmdPool;
+  data::StagingRing m_stagingRing;
 
   VkQueue m_graphicQueue;
   u32     m_graphicQueueIndex;
 
   ezvk::DescriptorPool         m_descPool;
   ezvk::DescriptorSetLayout    m_uniformLayout;
+  // one per frame slot
   std::vector<VkDescriptorSet> m_uniformSets;
 
-  data::TextureImage m_testTexture;
-  ezvk::ImageView    m_testTextureImageView;
-  ezvk::Sampler      m_testTextureSampler;
-
-  data::ObjModel        m_testModel;
-  ezvk::AllocatedBuffer m_testModelVertexBuf;
-  ezvk::AllocatedBuffer m_testModelIndexBuf;
-
-  ezvk::AllocatedBuffer m_uniformBuffer;
-  ezvk::AllocatedBuffer m_lightBuffer;
+  data::TextureStreamer m_textureStreamer;
+  u32                   m_testTexture{0};
+  ezvk::Sampler         m_testTextureSampler;
+  // sets whose texture view changed, each is rewritten when its frame slot
+  // comes around again
+  std::vector<u8> m_staleTextureSets;
+
+  // vertices and indices of every mesh, the ranges into it are kInvalid
+  // while their mesh is not loaded
+  data::GeometryBuffer m_geometry;
+  u32                  m_testModelVertexRange{data::GeometryBuffer::kInvalid};
+  u32                  m_testModelIndexRange{data::GeometryBuffer::kInvalid};
+  // all lod levels in one range, indexing m_testModelVertexRange
+  u32                  m_testModelLodIndexRange{data::GeometryBuffer::kInvalid};
+  u32                  m_sceneVertexRange{data::GeometryBuffer::kInvalid};
+  u32                  m_sceneIndexRange{data::GeometryBuffer::kInvalid};
+
+  data::ObjModel               m_testModel;
+  data::VertexQuantization     m_testModelQuantization;
+  std::vector<data::Meshlet>   m_testModelMeshlets;
+  data::CompactIndices         m_testModelIndices;
+  std::vector<data::DrawRange> m_drawRanges;
+  VkIndexType                  m_testModelLodIndexType{VK_INDEX_TYPE_UINT32};
+  data::LodSelector            m_lodSelector;
+
+  // models that are not .obj files go through assimp
+  data::Model m_scene;
+  // instance 0 is the identity the other models draw with, the scene's
+  // instances follow
+  static constexpr u32  kFirstSceneInstance = 1;
+  ezvk::AllocatedBuffer m_instanceBuffer;
+  // draws the scene's instances that are in view
+  data::GpuCuller m_gpuCuller;
+  // indices of all of the scene's instances, what goes into culling
+  u32 m_sceneInstancedIndexCount{0};
+  // eCpu culling, the list of visible instances has one slice per frame in
+  // flight, each with entry 0 unused
+  data::Bvh             m_sceneBvh;
+  ezvk::AllocatedBuffer m_cpuVisibleBuffer;
+  u32*                  m_cpuVisible{nullptr};
+  std::vector<u32>      m_visibleObjects;
+  // end of the run of every mesh in the current slice
+  std::vector<u32> m_meshVisibleEnds;
+
+  data::ObjStreamLoader     m_streamLoader;
+  std::vector<StreamedMesh> m_streamedMeshes;
+  // mesh uploads still in flight, streamed chunks, reloads and trims
+  std::vector<data::UploadBatch> m_meshUploads;
+
+  // The model and its texture are evicted as a whole when they are out of
+  // view and memory runs short, the bounds outlive the mesh.
+  data::ResidencyManager m_residency;
+  u32                    m_meshAsset{data::ResidencyManager::kInvalid};
+  u32                    m_textureAsset{data::ResidencyManager::kInvalid};
+  bool                   m_meshEvicted{false};
+  bool                   m_textureEvicted{false};
+  glm::vec3              m_modelBoundsMin{0.f}, m_modelBoundsMax{0.f};
+
+  // an evicted mesh is parsed again on the thread pool, only the upload is
+  // left to the render thread
+  std::future<ParsedMesh> m_meshReload;
+
+  FrameDraws             m_frameDraws;
+  data::ParallelRecorder m_recorder;
+  RecordBenchmark        m_recordBenchmark;
+  data::DepthPyramid     m_depthPyramid;
+  data::GpuTimer         m_gpuTimer;
+  OcclusionBenchmark     m_occlusionBenchmark;
+  data::LightClusters    m_lightClusters;
+  LightBenchmark         m_lightBenchmark;
+  // the bounds placeLights() last placed the lights in
+  glm::vec3              m_lightBoundsMin{0.f}, m_lightBoundsMax{0.f};
+  // the draws kept by each frame slot of m_recorder
+  std::vector<FrameDraws> m_recordedDraws;
+
+  std::chrono::steady_clock::time_point m_createTime;
+  bool                                  m_firstPixelLogged{false};
+
+  data::UniformRing m_uniformRing;
 
   // private:
   Application*                     m_application;
@@ -0,0 +1,78 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Frustum.hpp"
+
+#include <atomic>
+#include <span>
+
+namespace myvk::data {
+// Bounding volume hierarchy over axis aligned boxes with four children per
+// node, so one SSE test covers the whole node. The child bounds of a node
+// are stored as structure of arrays in one flat node array. It is built as
+// a binary tree with binned SAH, the two halves of large nodes on separate
+// threads, and then collapsed.
+class Bvh {
+public:
+  static constexpr u32 kWidth = 4;
+  // with one box per leaf the test of a node is exact for its boxes
+  static constexpr u32 kMaxLeafSize = 1;
+  static constexpr u32 kBinCount    = 16;
+  // Deeper nodes are split at the median instead. SAH may peel off one box
+  // per level, the median halves them, so the build and the walks over the
+  // tree recurse at most kMaxSahDepth + 32 levels deep.
+  static constexpr u32 kMaxSahDepth = 48;
+
+  void build(std::span<const glm::vec3> boundsMin,
+             std::span<const glm::vec3> boundsMax);
+  void clear();
+
+  // Appends the indices of the boxes that intersect frustum, in no
+  // particular order. Subtrees fully inside are taken without testing.
+  void cull(const Frustum& frustum, std::vector<u32>& visible) const;
+
+  bool empty() const {
+    return m_nodes.empty();
+  }
+  u32 nodeCount() const {
+    return (u32)m_nodes.size();
+  }
+
+private:
+  struct alignas(16) Node {
+    float minX[kWidth], minY[kWidth], minZ[kWidth];
+    float maxX[kWidth], maxY[kWidth], maxZ[kWidth];
+    // a node index, or the first entry of m_indices for a leaf
+    u32 child[kWidth];
+    // boxes of a leaf child, 0 for a node
+    u32 leafSize[kWidth];
+    u32 childCount;
+  };
+
+  struct BuildNode {
+    glm::vec3 boundsMin, boundsMax;
+    u32       left, right;
+    u32       first, count;
+  };
+
+  struct BuildState {
+    std::span<const glm::vec3> boundsMin, boundsMax;
+    std::vector<glm::vec3>     centers;
+    std::vector<BuildNode>     nodes;
+    std::atomic<u32>           nodeCount{0};
+  };
+
+  void buildNode(BuildState& state, u32 node, u32 first, u32 count,
+                 u32 depth);
+  u32  collapse(const BuildState& state, u32 node);
+  // masks of the children outside of a plane and inside of all of them
+  static void TestChildren(const Node& node, const Frustum& frustum,
+                           u32& outside, u32& inside);
+  void appendSubtree(u32 node, std::vector<u32>& visible) const;
+
+  std::vector<Node> m_nodes;
+  // box indices, leaves are runs of it
+  std::vector<u32> m_indices;
+};
+} // namespace myvk::data
@@ -9,6 +9,10 @@
 
 namespace myvk::data {
 struct Camera {
+  // depth range of projMat()
+  static constexpr float kNear = 0.1f;
+  static constexpr float kFar  = 10000.f;
+
   enum class MoveDirection {
     eForward,
     eBackward,
@@ -42,7 +46,7 @@ struct Camera {
   }
 
   glm::mat4 projMat(float aspect) {
-    glm::mat4 ret = glm::perspective(m_zoom, aspect, 0.1f, 10000.f);
+    glm::mat4 ret = glm::perspective(m_zoom, aspect, kNear, kFar);
     ret[1][1] *= -1;
     return ret;
   }
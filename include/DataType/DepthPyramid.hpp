@@ -0,0 +1,72 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "EasyVK/BufferAllocator.hpp"
+
+namespace myvk::data {
+// Mip chain of the farthest depth under each texel, for occlusion tests in
+// compute shaders. Level 0 is the depth extent rounded down to powers of
+// two, each of its texels takes the farthest sample of every depth texel it
+// overlaps, and each further level the farthest of 2x2 texels below. A box
+// whose nearest depth is farther than the texels covering it is hidden.
+// depthpyramid.comp builds one level per dispatch into storage image views.
+class DepthPyramid {
+public:
+  static constexpr u32 kGroupSize = 8;
+
+  void create(ezvk::BufferAllocator& allocator, VkDevice device,
+              const VkPipelineShaderStageCreateInfo& shader);
+  void destroy();
+
+  // (re)creates the pyramid of a multisampled depth image, whose view has
+  // to be samplable
+  void resize(VkImageView depthView, VkExtent2D depthExtent,
+              VkSampleCountFlagBits samples);
+
+  // Builds every level, outside of a render pass. The depth has to be in
+  // DEPTH_STENCIL_READ_ONLY_OPTIMAL with its writes visible to compute
+  // shaders, the pyramid is left in GENERAL for them to read.
+  void record(VkCommandBuffer cmd);
+
+  // all levels, for texelFetch
+  VkImageView view() const {
+    return m_view;
+  }
+  VkSampler sampler() const {
+    return m_sampler;
+  }
+  VkExtent2D extent() const {
+    return m_extent;
+  }
+
+private:
+  // push constants of depthpyramid.comp
+  struct Params {
+    u32 srcWidth, srcHeight;
+    u32 dstWidth, dstHeight;
+    u32 level;
+    u32 sampleCount;
+  };
+
+  void destroyImage();
+
+  VkDevice               m_device{VK_NULL_HANDLE};
+  ezvk::BufferAllocator* m_allocator{nullptr};
+
+  VkDescriptorSetLayout m_setLayout{VK_NULL_HANDLE};
+  VkPipelineLayout      m_pipelineLayout{VK_NULL_HANDLE};
+  VkPipeline            m_pipeline{VK_NULL_HANDLE};
+  VkSampler             m_sampler{VK_NULL_HANDLE};
+
+  VkExtent2D           m_depthExtent{0, 0};
+  u32                  m_sampleCount{1};
+  VkExtent2D           m_extent{0, 0};
+  ezvk::AllocatedImage m_image{};
+  VkImageView          m_view{VK_NULL_HANDLE};
+  // one view and set per level, the set of level i reads level i - 1
+  std::vector<VkImageView>     m_levelViews;
+  VkDescriptorPool             m_descPool{VK_NULL_HANDLE};
+  std::vector<VkDescriptorSet> m_levelSets;
+};
+} // namespace myvk::data
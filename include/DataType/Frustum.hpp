@@ -0,0 +1,24 @@
+#pragma once
+#include "common.hpp"
+
+#include <glm/glm.hpp>
+
+namespace myvk::data {
+// The six clip planes of a view projection matrix, normals point inwards.
+struct Frustum {
+  enum Plane { eLeft, eRight, eBottom, eTop, eNear, eFar, ePlaneCount };
+
+  glm::vec4 planes[ePlaneCount];
+
+  static Frustum FromMatrix(const glm::mat4& viewProj);
+
+  bool intersectsSphere(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : planes) {
+      if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+        return false;
+    }
+    return true;
+  }
+  bool intersectsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+};
+} // namespace myvk::data
@@ -0,0 +1,123 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/UploadBatch.hpp"
+
+#include "EasyVK/BufferAllocator.hpp"
+
+#include <map>
+#include <optional>
+
+namespace myvk::data {
+// Free list of byte ranges, best fit, neighbouring free ranges are merged
+class RangeAllocator {
+public:
+  void reset(VkDeviceSize capacity);
+
+  // offset is a multiple of alignment, which need not be a power of two
+  std::optional<VkDeviceSize> allocate(VkDeviceSize size,
+                                       VkDeviceSize alignment);
+  void                        free(VkDeviceSize offset, VkDeviceSize size);
+
+  VkDeviceSize capacity() const {
+    return m_capacity;
+  }
+  VkDeviceSize freeBytes() const {
+    return m_freeBytes;
+  }
+
+private:
+  VkDeviceSize                         m_capacity{0};
+  VkDeviceSize                         m_freeBytes{0};
+  std::map<VkDeviceSize, VkDeviceSize> m_free;
+};
+
+// Every vertex and index of every mesh lives in one vertex and one index
+// buffer, so a frame binds each of them once and draws pick their range
+// through firstIndex and vertexOffset. Ranges are aligned to their element
+// size, so first() is in vertices or indices. When a pool has no room left
+// it is moved into a new buffer, the same size when compacting frees
+// enough and twice as large otherwise. Ranges keep their handle but not
+// their offset, so draws read first() every frame.
+class GeometryBuffer {
+public:
+  static constexpr u32 kInvalid = ~0u;
+  // updates a replaced buffer is kept alive for, frames in flight may
+  // still read it
+  static constexpr u32 kRetireDelay = 8;
+
+  void create(ezvk::BufferAllocator& allocator, VkDeviceSize vertexCapacity,
+              VkDeviceSize indexCapacity);
+  void destroy();
+
+  // vertices of stride bytes each, uploaded through batch
+  u32 addVertices(UploadBatch& batch, const void* data, VkDeviceSize size,
+                  u32 stride);
+  u32 addIndices(UploadBatch& batch, const void* data, VkDeviceSize size,
+                 VkIndexType type);
+  void remove(u32 range);
+  // halves pools that are at most a quarter full, down to their first size
+  void trim(UploadBatch& batch);
+
+  // first vertex or index of range, what draws add to their offsets
+  u32 first(u32 range) const {
+    return (u32)(m_ranges[range].offset / m_ranges[range].elementSize);
+  }
+  VkDeviceSize size(u32 range) const {
+    return m_ranges[range].size;
+  }
+  VkBuffer vertexBuffer() const {
+    return m_pools[kVertexPool].buffer.buffer;
+  }
+  VkBuffer indexBuffer() const {
+    return m_pools[kIndexPool].buffer.buffer;
+  }
+
+  // frees buffers replaced long enough ago, call once per frame
+  void update();
+
+private:
+  static constexpr u32 kVertexPool = 0;
+  static constexpr u32 kIndexPool  = 1;
+
+  struct Pool {
+    ezvk::AllocatedBuffer buffer;
+    VkBufferUsageFlags    usage;
+    VkDeviceSize          minCapacity;
+    RangeAllocator        ranges;
+  };
+
+  struct Range {
+    u32          pool;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    VkDeviceSize elementSize;
+    bool         live;
+  };
+
+  struct RetiredBuffer {
+    ezvk::AllocatedBuffer buffer;
+    u64                   destroyAt;
+  };
+
+  u32  add(UploadBatch& batch, u32 pool, const void* data, VkDeviceSize size,
+           VkDeviceSize elementSize);
+  void createPool(u32 pool, VkDeviceSize capacity);
+  // live ranges of pool in offset order
+  std::vector<u32> liveRanges(u32 pool) const;
+  // bytes the live ranges of pool take when moved to the front of a buffer,
+  // with their alignment padding, and extra more of extraAlignment
+  VkDeviceSize packedSize(u32 pool, VkDeviceSize extra = 0,
+                          VkDeviceSize extraAlignment = 1) const;
+  // moves the live ranges of pool to the front of a new buffer
+  void relocate(UploadBatch& batch, u32 pool, VkDeviceSize capacity);
+
+  ezvk::BufferAllocator*     m_allocator{nullptr};
+  Pool                       m_pools[2];
+  std::vector<Range>         m_ranges;
+  std::vector<u32>           m_freeHandles;
+  std::vector<RetiredBuffer> m_retired;
+  u64                        m_updateCount{0};
+};
+} // namespace myvk::data
@@ -0,0 +1,187 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/DepthPyramid.hpp"
+#include "DataType/Frustum.hpp"
+#include "DataType/UploadBatch.hpp"
+
+#include "EasyVK/BufferAllocator.hpp"
+
+#include <optional>
+#include <span>
+
+namespace myvk::data {
+// Frustum culls instances in a compute shader and draws what is left with
+// one indirect draw, so the CPU cost of a frame does not grow with the
+// number of objects. Every mesh has one draw command and its instances a
+// run of the visible list, cull.comp appends each instance that passes to
+// the run of its mesh and counts it in the command. With
+// VK_KHR_draw_indirect_count the commands that kept instances are compacted
+// and their count read by the GPU, otherwise every command is drawn and the
+// empty ones cost nothing.
+//
+// With occlusion culling a frame draws in two phases. The early phase draws
+// the objects in frustum that were visible the frame before. recordLate()
+// then tests every object against a depth pyramid of what the early phase
+// drew, keeps the result for the next frame and draws the visible ones the
+// early phase missed. Objects coming into view are drawn the frame they
+// appear, so nothing pops in.
+//
+// Entry 0 of the visible list is always 0, so draws with firstInstance 0
+// read instance 0 the same way as without culling.
+class GpuCuller {
+public:
+  static constexpr u32 kGroupSize = 64;
+
+  // std430 layout of Object in cull.comp
+  struct Object {
+    glm::vec3 boundsMin;
+    // index of the draw command
+    u32       draw;
+    glm::vec3 boundsMax;
+    // what the visible list holds for the object
+    u32       instance;
+  };
+
+  struct Stats {
+    u32    gpuVisible;
+    u32    cpuVisible;
+    double gpuMs;
+    double cpuMs;
+  };
+
+  // Counts of one frame, layout of Counts in cull.comp. Objects the early
+  // phase drew but the late one found hidden count as drawn and occluded,
+  // the next frame skips them.
+  struct Counts {
+    u32 drawnEarly;
+    u32 drawnLate;
+    u32 frustumCulled;
+    u32 occluded;
+  };
+
+  // frameCount has to be at least the number of frames in flight
+  void create(ezvk::BufferAllocator& allocator, VkDevice device,
+              VkPhysicalDevice gpu, VkCommandPool cmdPool, VkQueue queue,
+              u32 frameCount, const VkPipelineShaderStageCreateInfo& shader);
+  void destroy();
+
+  // the pyramid occlusion culling tests against, set again when resized
+  void setPyramid(const DepthPyramid& pyramid);
+
+  // Objects in bounds in world space, draws with firstInstance pointing at
+  // the run of their objects in the visible list, which has visibleCount
+  // entries. firstIndex and vertexOffset are relative to what record()
+  // adds.
+  void setScene(UploadBatch& batch, std::span<const Object> objects,
+                std::span<const VkDrawIndexedIndirectCommand> draws,
+                u32 visibleCount);
+
+  // Records the culling, or its early phase with occlusionCulling, outside
+  // of a render pass. With frustumCulling false every object is drawn.
+  void record(VkCommandBuffer cmd, const Frustum& frustum,
+              const glm::mat4& viewProj, bool frustumCulling,
+              bool occlusionCulling, u32 firstIndex, i32 vertexOffset);
+  // the draws of the last record(), index and vertex buffers bound
+  void draw(VkCommandBuffer cmd) const;
+  // Records the late phase of occlusion culling after the pyramid was built
+  // from the early draws, outside of a render pass.
+  void recordLate(VkCommandBuffer cmd);
+  // the draws of the last recordLate()
+  void drawLate(VkCommandBuffer cmd) const;
+
+  // copies the counts of the frame recorded into cmd for counts()
+  void copyCounts(VkCommandBuffer cmd, u64 frame);
+  // The counts of the last frame that used frame's slot, nothing when there
+  // was none. That frame has to be done.
+  std::optional<Counts> counts(u64 frame) const;
+  // culls once on the GPU and once on the CPU and compares the results,
+  // waits for the queue
+  Stats validate(const Frustum& frustum, u32 firstIndex, i32 vertexOffset);
+
+  VkBuffer visibleBuffer() const {
+    return m_visible.buffer;
+  }
+  u32 objectCount() const {
+    return (u32)m_objects.size();
+  }
+  bool drawCountSupported() const {
+    return m_drawIndexedIndirectCount != nullptr;
+  }
+
+private:
+  enum Pass : u32 {
+    eReset,
+    eCull,
+    eCompact,
+    eLateReset,
+    eLateCull,
+    eLateCompact,
+  };
+
+  // push constants of cull.comp
+  struct Params {
+    glm::vec4 planes[Frustum::ePlaneCount];
+    u32       objectCount;
+    u32       drawCount;
+    u32       pass;
+    u32       frustumCulling;
+    u32       firstIndex;
+    i32       vertexOffset;
+    u32       occlusionCulling;
+  };
+
+  // std140 layout of View in cull.comp
+  struct View {
+    glm::mat4 viewProj;
+    glm::vec2 pyramidSize;
+  };
+
+  void createPipeline(const VkPipelineShaderStageCreateInfo& shader);
+  void writeDescriptors();
+  void dispatch(VkCommandBuffer cmd, Params& params, Pass pass, u32 count);
+  void destroyBuffers();
+
+  ezvk::BufferAllocator* m_allocator{nullptr};
+  VkDevice               m_device{VK_NULL_HANDLE};
+  VkCommandPool          m_cmdPool{VK_NULL_HANDLE};
+  VkQueue                m_queue{VK_NULL_HANDLE};
+
+  VkDescriptorSetLayout m_setLayout{VK_NULL_HANDLE};
+  VkDescriptorPool      m_descPool{VK_NULL_HANDLE};
+  VkDescriptorSet       m_set{VK_NULL_HANDLE};
+  VkPipelineLayout      m_pipelineLayout{VK_NULL_HANDLE};
+  VkPipeline            m_pipeline{VK_NULL_HANDLE};
+
+  PFN_vkCmdDrawIndexedIndirectCountKHR m_drawIndexedIndirectCount{nullptr};
+
+  // bounds for validate()
+  std::vector<Object> m_objects;
+  u32                 m_drawCount{0};
+  // what recordLate() goes on with
+  Params              m_params{};
+  VkExtent2D          m_pyramidExtent{0, 0};
+
+  ezvk::AllocatedBuffer m_objectBuffer;
+  // the draws as given, reset copies them into m_draws
+  ezvk::AllocatedBuffer m_templates;
+  ezvk::AllocatedBuffer m_draws;
+  ezvk::AllocatedBuffer m_visible;
+  ezvk::AllocatedBuffer m_compacted;
+  ezvk::AllocatedBuffer m_count;
+  // 1 for the objects visible in the last frame with occlusion culling
+  ezvk::AllocatedBuffer m_visibility;
+  ezvk::AllocatedBuffer m_lateDraws;
+  ezvk::AllocatedBuffer m_lateCompacted;
+  ezvk::AllocatedBuffer m_lateCount;
+
+  // live for as long as the culler
+  ezvk::AllocatedBuffer m_view;
+  ezvk::AllocatedBuffer m_counts;
+  // one Counts per frame slot
+  ezvk::AllocatedBuffer m_countsReadback;
+  const Counts*         m_countsMapped{nullptr};
+  std::vector<u8>       m_countsWritten;
+};
+} // namespace myvk::data
@@ -0,0 +1,32 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include <optional>
+
+namespace myvk::data {
+// GPU time of whole frames from timestamps at the start and end of their
+// command buffers. Each frame slot has its own pair of queries, read when
+// the slot comes around again and its fence was waited for.
+class GpuTimer {
+public:
+  // frameCount has to be at least the number of frames in flight
+  void create(VkDevice device, VkPhysicalDevice gpu, u32 frameCount);
+  void destroy();
+
+  void begin(VkCommandBuffer cmd, u64 frame);
+  void end(VkCommandBuffer cmd);
+
+  // Milliseconds of the last frame that used frame's slot, nothing when
+  // there was none. That frame has to be done.
+  std::optional<double> ms(u64 frame) const;
+
+private:
+  VkDevice    m_device{VK_NULL_HANDLE};
+  VkQueryPool m_pool{VK_NULL_HANDLE};
+  // nanoseconds per tick, 0 when the queue cannot write timestamps
+  double          m_period{0.};
+  u32             m_slot{0};
+  std::vector<u8> m_written;
+};
+} // namespace myvk::data
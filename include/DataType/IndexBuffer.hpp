@@ -0,0 +1,54 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Meshlet.hpp"
+
+#include <span>
+
+namespace myvk::data {
+// a range of indices drawn with the same vertexOffset
+struct IndexChunk {
+  u32 firstIndex;
+  u32 indexCount;
+  i32 vertexOffset;
+};
+
+// Index data as it is uploaded. Meshes with more than 65536 vertices are
+// split into chunks of at most 65536 vertices each, the chunk's vertices
+// are laid out together in the uploaded vertex buffer (vertices shared by
+// chunks are duplicated) and its indices are relative to the first of them.
+// Falls back to 32 bit indices if that would duplicate too many vertices.
+struct CompactIndices {
+  VkIndexType             type{VK_INDEX_TYPE_UINT32};
+  std::vector<u16>        indices16;
+  std::vector<IndexChunk> chunks;
+  // source vertex of every uploaded vertex, empty when the vertex buffer is
+  // uploaded as it is
+  std::vector<u32> vertexRemap;
+
+  // Meshlets are never split between chunks and get their chunk's
+  // vertexOffset. When the mesh is chunked the meshlets are reordered
+  // spatially and their firstIndex points into indices16. Without meshlets
+  // chunks end on triangle boundaries.
+  static CompactIndices Build(std::span<const u32> indices, size_t vertexCount,
+                              std::span<Meshlet> meshlets);
+
+  size_t indexSize() const {
+    return type == VK_INDEX_TYPE_UINT16 ? sizeof(u16) : sizeof(u32);
+  }
+};
+
+// Maps indices of the source vertices to the uploaded vertex buffer, which
+// holds vertexRemap when it is not empty. A duplicated vertex maps to its
+// first copy.
+std::vector<u32> RemapIndices(std::span<const u32> indices,
+                              std::span<const u32> vertexRemap,
+                              size_t               vertexCount);
+
+// Zigzag delta varint coding of an index stream, about 1.3 to 1.5 bytes per
+// index once MeshOptimizer has put the vertices in first use order.
+std::vector<u8> EncodeIndices(std::span<const u32> indices);
+// fails if encoded does not hold exactly out.size() indices
+bool DecodeIndices(std::span<const u8> encoded, std::span<u32> out);
+} // namespace myvk::data
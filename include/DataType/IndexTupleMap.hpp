@@ -0,0 +1,42 @@
+#pragma once
+#include "common.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <utility>
+#include <vector>
+
+namespace myvk::data {
+// Flat open addressing map from an obj (position, texcoord, normal) index
+// tuple to a vertex id. Slots are 16 bytes and probed linearly.
+class IndexTupleMap {
+public:
+  void reserve(size_t count);
+
+  // returns the stored id and whether the tuple was newly inserted
+  std::pair<u32, bool> insert(const tinyobj::index_t& key, u32 value);
+
+  size_t size() const {
+    return m_size;
+  }
+
+  void clear();
+
+private:
+  struct Slot {
+    i32 vertex;
+    i32 texcoord;
+    i32 normal;
+    u32 value;
+  };
+  static constexpr i32 kEmpty = -1;
+
+  static u32 Hash(const tinyobj::index_t& key);
+
+  void rehash(size_t capacity);
+
+  std::vector<Slot> m_slots;
+  size_t            m_mask{0};
+  size_t            m_size{0};
+};
+} // namespace myvk::data
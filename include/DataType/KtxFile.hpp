@@ -0,0 +1,55 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/MappedFile.hpp"
+#include "DataType/Texture.hpp"
+
+#include <span>
+#include <string>
+
+namespace myvk::data {
+// KTX2 texture cache stored next to its source image as "<source>.ktx2".
+// Only what the baker writes is read back: one 2D layer and face, block
+// compressed sRGB levels and no supercompression. The source size, time and
+// hash live in a "myvk.source" key/value entry, so a stale cache is found
+// the same way as a stale MeshCache.
+class KtxFile {
+public:
+  static constexpr u32 kVersion = 1;
+
+  static std::string PathFor(ccstr sourcePath);
+  static bool        Write(ccstr sourcePath, const MipChain& levels);
+
+  // maps the cache of sourcePath, fails if it is missing, stale or corrupt
+  bool open(ccstr sourcePath);
+  void close();
+
+  bool isOpen() const {
+    return m_file.isOpen();
+  }
+  VkFormat format() const {
+    return m_format;
+  }
+  u32 levelCount() const {
+    return (u32)m_extents.size();
+  }
+
+  // Levels are stored smallest first, levelData() starts at the smallest and
+  // offsets() are relative to it.
+  std::span<const u8>         levelData() const;
+  std::span<const VkExtent2D> extents() const {
+    return m_extents;
+  }
+  std::span<const size_t> offsets() const {
+    return m_offsets;
+  }
+
+private:
+  MappedFile              m_file;
+  VkFormat                m_format{VK_FORMAT_UNDEFINED};
+  size_t                  m_dataOffset{0};
+  std::vector<VkExtent2D> m_extents;
+  std::vector<size_t>     m_offsets;
+};
+} // namespace myvk::data
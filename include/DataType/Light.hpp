@@ -3,8 +3,11 @@
 #include "pch.hpp"
 
 namespace myvk::data {
+// a point light, layout of Light in lightcull.comp and main.frag
 struct Light {
   alignas(16) glm::vec3 position;
+  // it fades out towards this distance and lights nothing past it
+  float radius;
   alignas(16) glm::vec3 color;
 };
-} // namespace myvk::data
\ No newline at end of file
+} // namespace myvk::data
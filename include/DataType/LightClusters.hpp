@@ -0,0 +1,109 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Light.hpp"
+#include "EasyVK/BufferAllocator.hpp"
+
+#include <optional>
+#include <span>
+
+namespace myvk::data {
+// Point lights binned into clusters of the view frustum for forward shading.
+// The screen is split into kTilesX x kTilesY tiles and the view depth into
+// kSlices slices that grow exponentially from the near to the far plane.
+// lightcull.comp tests every light's sphere against the bounds of each
+// cluster every frame, one workgroup per cluster, and lists the lights that
+// touch it. A fragment only shades the lights of its cluster, so its cost
+// follows the lights around it and not all there are. Every frame slot has
+// its own copy of the lights, so they change without waiting for the GPU.
+class LightClusters {
+public:
+  // also in lightcull.comp and main.frag
+  static constexpr u32 kTilesX       = 16;
+  static constexpr u32 kTilesY       = 9;
+  static constexpr u32 kSlices       = 24;
+  static constexpr u32 kClusterCount = kTilesX * kTilesY * kSlices;
+  // lights of a cluster past this many are dropped, and counted
+  static constexpr u32 kMaxClusterLights = 256;
+
+  // frameCount has to be at least the number of frames in flight
+  void create(ezvk::BufferAllocator& allocator, VkDevice device,
+              u32 maxLights, u32 frameCount,
+              const VkPipelineShaderStageCreateInfo& shader);
+  void destroy();
+
+  // At most maxLights, each frame slot's copy is written by its next
+  // record(), frames in flight keep shading the lights they had.
+  void setLights(std::span<const Light> lights);
+
+  // Bins the first lightCount lights for the view, outside of a render pass.
+  // extent is the one of the framebuffer, zNear and zFar those of proj.
+  // Copies the count of dropped lights of frame for droppedLights().
+  void record(VkCommandBuffer cmd, const glm::mat4& view,
+              const glm::mat4& proj, VkExtent2D extent, float zNear,
+              float zFar, u32 lightCount, u64 frame);
+  // The lights all clusters of the last frame that used frame's slot
+  // dropped past kMaxClusterLights, nothing when there was none. That frame
+  // has to be done.
+  std::optional<u32> droppedLights(u64 frame) const;
+
+  u32 maxLights() const {
+    return m_maxLights;
+  }
+  u32 lightCount() const {
+    return m_lightCount;
+  }
+  // what main.frag reads, the lights of all frame slots, the view and the
+  // clusters' lists
+  VkBuffer lightBuffer() const {
+    return m_lights.buffer;
+  }
+  VkBuffer viewBuffer() const {
+    return m_view.buffer;
+  }
+  VkBuffer clusterBuffer() const {
+    return m_clusters.buffer;
+  }
+
+private:
+  // layout of ClusterView in lightcull.comp and main.frag
+  struct View {
+    glm::mat4 view;
+    glm::mat4 invProj;
+    glm::vec2 extent;
+    float     zNear;
+    float     zFar;
+    u32       lightCount;
+    // where the frame slot's lights start in m_lights
+    u32       firstLight;
+  };
+
+  VkDevice               m_device{VK_NULL_HANDLE};
+  ezvk::BufferAllocator* m_allocator{nullptr};
+
+  VkDescriptorSetLayout m_setLayout{VK_NULL_HANDLE};
+  VkDescriptorPool      m_descPool{VK_NULL_HANDLE};
+  VkDescriptorSet       m_set{VK_NULL_HANDLE};
+  VkPipelineLayout      m_pipelineLayout{VK_NULL_HANDLE};
+  VkPipeline            m_pipeline{VK_NULL_HANDLE};
+
+  u32                   m_maxLights{0};
+  u32                   m_lightCount{0};
+  u32                   m_frameCount{0};
+  // maxLights per frame slot, persistently mapped
+  ezvk::AllocatedBuffer m_lights;
+  Light*                m_lightsMapped{nullptr};
+  // what setLights() got, and the slots that do not have it yet
+  std::vector<Light>    m_pendingLights;
+  std::vector<u8>       m_staleLights;
+  ezvk::AllocatedBuffer m_view;
+  // the light count of every cluster, the dropped lights, then
+  // kMaxClusterLights light indices per cluster
+  ezvk::AllocatedBuffer m_clusters;
+  // the dropped lights of every frame slot
+  ezvk::AllocatedBuffer m_droppedReadback;
+  const u32*            m_droppedMapped{nullptr};
+  std::vector<u8>       m_droppedWritten;
+};
+} // namespace myvk::data
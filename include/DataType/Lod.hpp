@@ -0,0 +1,62 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Mesh.hpp"
+
+#include <span>
+
+namespace myvk::data {
+// a simplified version of a mesh, its indices are a range of
+// LodChain::indices
+struct LodLevel {
+  u32 firstIndex;
+  u32 indexCount;
+  // how far the surface may be off the full mesh, in model space
+  float error;
+};
+
+struct LodOptions {
+  u32 maxLevels = 8;
+  // every level targets this fraction of the previous level's triangles
+  float reduction = .5f;
+  // no level is built below this many triangles
+  u32 minTriangles = 256;
+};
+
+// Levels coarser than the full mesh, finest first. They all index the full
+// mesh's vertex buffer.
+struct LodChain {
+  std::vector<LodLevel> levels;
+  std::vector<u32>      indices;
+
+  static LodChain Build(std::span<const Vertex> vertices,
+                        std::span<const u32>    indices,
+                        const LodOptions&       options = {});
+};
+
+// Picks the coarsest level whose error covers at most pixelError pixels on
+// screen. A coarser level is only taken once its error drops below
+// (1 - hysteresis) * pixelError, so the level does not flicker while the
+// distance stays around a threshold.
+class LodSelector {
+public:
+  float pixelError = 1.f;
+  float hysteresis = .25f;
+
+  // Level 0 is the full mesh, level i > 0 is levels[i - 1]. distance is
+  // from the camera to the closest point of the mesh bounds.
+  u32 select(std::span<const LodLevel> levels, const glm::mat4& proj,
+             float viewportHeight, float distance);
+
+  u32 level() const {
+    return m_level;
+  }
+  void reset() {
+    m_level = 0;
+  }
+
+private:
+  u32 m_level{0};
+};
+} // namespace myvk::data
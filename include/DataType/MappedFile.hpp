@@ -0,0 +1,40 @@
+#pragma once
+#include "common.hpp"
+
+#include <cstddef>
+
+namespace myvk::data {
+// read-only memory mapping of a whole file
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  bool open(ccstr filename);
+  void close();
+
+  bool isOpen() const {
+    return m_isOpen;
+  }
+  const char* data() const {
+    return static_cast<const char*>(m_data);
+  }
+  size_t size() const {
+    return m_size;
+  }
+
+private:
+  void*  m_data{nullptr};
+  size_t m_size{0};
+  bool   m_isOpen{false};
+#ifdef _WIN32
+  void* m_file{nullptr};
+  void* m_mapping{nullptr};
+#endif
+};
+} // namespace myvk::data
@@ -2,7 +2,6 @@
 #include "common.hpp"
 #include "pch.hpp"
 
-#include "glm/gtx/hash.hpp"
 namespace myvk::data {
 struct VertexInputDescription {
   std::vector<VkVertexInputBindingDescription>   bindings;
@@ -21,20 +20,9 @@ struct Vertex {
     if (this == &other)
       return true;
     else
-      return pos == other.pos && color == other.color && uv == other.uv;
+      return pos == other.pos && color == other.color &&
+             norm == other.norm && uv == other.uv;
   }
 };
   
 } // namespace myvk::data
-
-// data::Vertex hash support
-namespace std {
-template <> struct hash<myvk::data::Vertex> {
-  size_t operator()(myvk::data::Vertex const& vertex) const {
-    return ((hash<glm::vec3>()(vertex.pos) ^
-             (hash<glm::vec3>()(vertex.color) << 1)) >>
-            1) ^
-           (hash<glm::vec2>()(vertex.uv) << 1);
-  }
-};
-} // namespace std
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/MappedFile.hpp"
+#include "DataType/Lod.hpp"
+#include "DataType/Mesh.hpp"
+
+#include <fstream>
+#include <span>
+#include <string>
+
+namespace myvk::data {
+// Binary mesh cache stored next to its source asset as "<source>.meshcache".
+// The vertex and index payloads are laid out exactly as they are uploaded,
+// so a warm load maps the file and copies the payload into a staging buffer.
+struct MeshCacheHeader {
+  enum Flags : u32 {
+    // the payload went through MeshOptimizer
+    eOptimized = 1 << 0,
+    // indices are stored with EncodeIndices
+    eCompressedIndices = 1 << 1,
+    // a LodChain follows the indices, it may have no levels
+    eLods = 1 << 2,
+  };
+
+  u32       magic;
+  u32       version;
+  u64       sourceSize;
+  i64       sourceTime;
+  u64       sourceHash;
+  u64       payloadHash;
+  u32       vertexStride;
+  u32       flags;
+  u64       vertexCount;
+  u64       indexCount;
+  u64       vertexOffset;
+  u64       indexOffset;
+  u64       indexBytes;
+  // LodLevel table followed by the level indices
+  u64       lodOffset;
+  u64       lodIndexCount;
+  u32       lodLevelCount;
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+};
+
+class MeshCache {
+public:
+  static constexpr u32 kMagic   = 0x434D564D; // "MVMC"
+  static constexpr u32 kVersion = 3;
+
+  static std::string PathFor(ccstr sourcePath);
+  static u64         HashSource(ccstr sourcePath);
+  static u64         HashPayload(std::span<const Vertex>    vertices,
+                                 std::span<const std::byte> indexBytes,
+                                 std::span<const std::byte> lodBytes = {});
+
+  // cheap header check against the source size and mtime, it does not
+  // verify the payload
+  static bool IsCurrent(ccstr sourcePath);
+
+  static bool Write(ccstr sourcePath, u64 sourceHash,
+                    std::span<const Vertex> vertices,
+                    std::span<const u32> indices, const glm::vec3& boundsMin,
+                    const glm::vec3& boundsMax, u32 flags = 0,
+                    const LodChain& lods = {});
+
+  // maps the cache of sourcePath, fails if it is missing, stale or corrupt
+  bool open(ccstr sourcePath);
+  void close();
+
+  bool isOpen() const {
+    return m_file.isOpen();
+  }
+  const MeshCacheHeader& header() const {
+    return *reinterpret_cast<const MeshCacheHeader*>(m_file.data());
+  }
+
+  std::span<const Vertex> vertices() const;
+  std::span<const u32>    indices() const;
+  // empty unless the eLods flag is set
+  std::span<const LodLevel> lodLevels() const;
+  std::span<const u32>      lodIndices() const;
+
+private:
+  MappedFile m_file;
+  // compressed indices are decoded on open
+  std::vector<u32> m_decodedIndices;
+};
+
+// Writes a mesh cache whose geometry arrives in pieces, for example from a
+// streaming load. Indices are spooled to a side file, so memory use does not
+// depend on the mesh size.
+class MeshCacheWriter {
+public:
+  ~MeshCacheWriter();
+
+  bool begin(ccstr sourcePath);
+  void appendVertices(std::span<const Vertex> vertices);
+  // indices are stored as base + index
+  void appendIndices(std::span<const u32> indices, u32 base = 0);
+  bool finish(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+  void abort();
+
+private:
+  std::string      m_sourcePath;
+  std::string      m_vertexPath, m_indexPath;
+  std::ofstream    m_vertexOut, m_indexOut;
+  u64              m_sourceSize{0};
+  i64              m_sourceTime{0};
+  u64              m_vertexCount{0}, m_indexCount{0};
+  std::vector<u32> m_rebased;
+  bool             m_active{false};
+};
+} // namespace myvk::data
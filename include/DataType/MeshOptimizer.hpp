@@ -0,0 +1,57 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Mesh.hpp"
+
+#include <span>
+
+namespace myvk::data {
+struct VertexCacheStats {
+  // average cache miss ratio: transformed vertices per triangle
+  float acmr;
+  // average transform to vertex ratio: transformed vertices per vertex
+  float atvr;
+};
+
+struct MeshOptimizeOptions {
+  // vertices closer than this fraction of the bounds diagonal are merged
+  float weldPositionEpsilon = 1e-6f;
+  // absolute tolerance for normals and uvs while welding
+  float weldAttributeEpsilon = 1e-4f;
+  u32   cacheSize            = 16;
+  // a cluster may end when its miss ratio exceeds the whole mesh's by this
+  float overdrawThreshold = 1.05f;
+};
+
+// Reorders a triangle list for the post transform cache (Tipsify), then
+// sorts the resulting clusters to reduce overdraw and finally reorders the
+// vertices in first use order for fetch locality.
+struct MeshOptimizer {
+  static VertexCacheStats AnalyzeVertexCache(std::span<const u32> indices,
+                                             size_t               vertexCount,
+                                             u32 cacheSize = 16);
+
+  // merges nearly equal vertices and drops triangles that collapse
+  static void WeldVertices(std::vector<Vertex>& vertices,
+                           std::vector<u32>& indices, float positionEpsilon,
+                           float attributeEpsilon);
+
+  // returns the first triangle of every cache cluster
+  static std::vector<u32> OptimizeVertexCache(std::vector<u32>& indices,
+                                              size_t            vertexCount,
+                                              u32               cacheSize);
+
+  // splits the cache clusters further and sorts them outside in
+  static void OptimizeOverdraw(const std::vector<Vertex>& vertices,
+                               std::vector<u32>&          indices,
+                               const std::vector<u32>& clusters, u32 cacheSize,
+                               float threshold);
+
+  static void OptimizeVertexFetch(std::vector<Vertex>& vertices,
+                                  std::vector<u32>&    indices);
+
+  static void Optimize(std::vector<Vertex>& vertices, std::vector<u32>& indices,
+                       const MeshOptimizeOptions& options = {});
+};
+} // namespace myvk::data
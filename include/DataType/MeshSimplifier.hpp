@@ -0,0 +1,26 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Mesh.hpp"
+
+#include <span>
+
+namespace myvk::data {
+// Quadric error edge collapse. Vertices are never moved or created, a
+// collapse redirects one position onto a neighbouring one, so the result
+// indexes the same vertex buffer as the input.
+//
+// Vertices that share a position (uv or normal seams) collapse together,
+// every corner picks the copy at the target whose attributes are closest to
+// its own. Positions on open borders are never collapsed.
+struct MeshSimplifier {
+  // Collapses until at most targetIndexCount indices are left or the next
+  // collapse would move the surface further than targetError (model space).
+  // resultError receives the largest error of a collapse that was done.
+  static std::vector<u32> Simplify(std::span<const Vertex> vertices,
+                                   std::span<const u32>    indices,
+                                   size_t targetIndexCount, float targetError,
+                                   float* resultError = nullptr);
+};
+} // namespace myvk::data
@@ -0,0 +1,56 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Frustum.hpp"
+#include "DataType/Mesh.hpp"
+
+#include <span>
+
+namespace myvk::data {
+// A run of at most kMaxTriangles triangles touching at most kMaxVertices
+// vertices. Meshlets are ranges of the model's index buffer, so they can be
+// drawn with plain drawIndexed and need no mesh shaders.
+struct Meshlet {
+  static constexpr u32 kMaxVertices  = 64;
+  static constexpr u32 kMaxTriangles = 124;
+
+  u32 firstIndex;
+  u32 indexCount;
+  // added to every index, set when the indices are rebased to 16 bit
+  i32 vertexOffset;
+
+  // bounding sphere
+  glm::vec3 center;
+  float     radius;
+  // sine of the normal cone's half angle around coneAxis, a cutoff of 1
+  // marks a cone that never culls
+  glm::vec3 coneAxis;
+  float     coneCutoff;
+};
+
+// a range of the index buffer to draw
+struct DrawRange {
+  u32 firstIndex;
+  u32 indexCount;
+  i32 vertexOffset;
+};
+
+struct MeshletBuilder {
+  // splits the index buffer in its current order, run it after
+  // MeshOptimizer so that neighbouring triangles end up together
+  static std::vector<Meshlet> Build(std::span<const Vertex> vertices,
+                                    std::span<const u32>    indices,
+                                    u32 maxVertices  = Meshlet::kMaxVertices,
+                                    u32 maxTriangles = Meshlet::kMaxTriangles);
+};
+
+struct MeshletCuller {
+  // Appends the visible meshlets to draws, merging neighbouring ones with
+  // the same vertexOffset into a single range. Cone culling is only correct
+  // with back face culling on. Returns the number of triangles left to draw.
+  static u32 Cull(std::span<const Meshlet> meshlets, const Frustum& frustum,
+                  const glm::vec3& cameraPos, bool coneCulling,
+                  std::vector<DrawRange>& draws);
+};
+} // namespace myvk::data
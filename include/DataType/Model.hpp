@@ -2,8 +2,15 @@
 #include "common.hpp"
 #include "pch.hpp"
 
+#include "DataType/GeometryBuffer.hpp"
+#include "DataType/Lod.hpp"
+#include "DataType/Material.hpp"
 #include "DataType/Mesh.hpp"
+#include "DataType/MeshCache.hpp"
+#include "DataType/MeshOptimizer.hpp"
+#include "DataType/ObjParser.hpp"
 #include "DataType/Texture.hpp"
+#include "DataType/VertexFormat.hpp"
 #include "EasyVK/BufferAllocator.hpp"
 
 #include <assimp/Importer.hpp>
@@ -11,60 +18,149 @@
 #include <assimp/scene.h>
 
 namespace myvk::data {
-// struct VertexInputDescription {
-//   std::vector<VkVertexInputBindingDescription>   bindings;
-//   std::vector<VkVertexInputAttributeDescription> attributes;
-// };
-// struct Vertex {
-//   glm::vec3 pos;
-//   glm::vec3 norm;
-//   glm::vec2 uv;
-
-//   static VertexInputDescription GetInputDescription();
-// };
-
-// struct Mesh {
-//   std::vector<Vertex>       vertices;
-//   std::vector<u32>          indices;
-//   std::vector<TextureImage> textures;
-// };
+struct ObjLoadOptions {
+  ObjLoader loader   = ObjLoader::eParallel;
+  bool      useCache = true;
+  // reorder the mesh for the GPU caches, with useCache this is paid once
+  bool                optimize = true;
+  MeshOptimizeOptions optimizer;
+  // store the cached indices with EncodeIndices, smaller on disk but they
+  // have to be decoded on every load
+  bool compressIndices = false;
+  // simplified levels for distant views, built after optimizing
+  bool       buildLods = true;
+  LodOptions lod;
+};
 
 class ObjModel {
 public:
+  // empty when the model was loaded from its mesh cache, use vertexData()
+  // and indexData() to read the geometry
   std::vector<Vertex> vertices;
   std::vector<u32>    indices;
+  LodChain            lods;
+
+  glm::vec3 boundsMin{0.f}, boundsMax{0.f};
 
-  ObjModel(ccstr filename);
+  // empty when filename can not be read or parsed
+  ObjModel(ccstr filename, const ObjLoadOptions& options = {});
 
-  ObjModel()  = default;
-  ~ObjModel() = default;
+  ObjModel() = default;
 
   ezvk::AllocatedBuffer allocateVertices(ezvk::BufferAllocator& allocator);
   ezvk::AllocatedBuffer allocateIndices(ezvk::BufferAllocator& allocator);
-  ezvk::AllocatedBuffer
-  allocateVerticesUsingStaging(ezvk::BufferAllocator& allocator,
-                               ezvk::CommandPool& cmdPool, VkDevice device,
-                               VkQueue submitQueue);
-  ezvk::AllocatedBuffer
-  allocateIndicesUsingStaging(ezvk::BufferAllocator& allocator,
-                              ezvk::CommandPool& cmdPool, VkDevice device,
-                              VkQueue submitQueue);
+  // Each returns a range of geometry, uploaded through batch. remap lists
+  // the source vertex of every uploaded vertex, see
+  // CompactIndices::vertexRemap, all vertices are uploaded in order if empty
+  u32 allocateVerticesUsingStaging(GeometryBuffer& geometry, UploadBatch& batch,
+                                   std::span<const u32> remap = {});
+  // PackedVertex range, positions are relative to quantization()
+  u32 allocatePackedVerticesUsingStaging(GeometryBuffer&      geometry,
+                                         UploadBatch&         batch,
+                                         std::span<const u32> remap = {});
+  u32 allocateIndicesUsingStaging(GeometryBuffer& geometry,
+                                  UploadBatch&    batch);
+  // Drops the vertices and indices once they are uploaded, only the bounds
+  // and lod levels stay. The accessors return empty spans afterwards.
+  void releaseGeometry();
+
+  std::span<const Vertex> vertexData() const {
+    return m_cache.isOpen() ? m_cache.vertices() : vertices;
+  }
+  std::span<const u32> indexData() const {
+    return m_cache.isOpen() ? m_cache.indices() : indices;
+  }
+  std::span<const LodLevel> lodLevels() const {
+    return m_cache.isOpen() ? m_cache.lodLevels() : lods.levels;
+  }
+  // the lod levels index vertexData() too
+  std::span<const u32> lodIndexData() const {
+    return m_cache.isOpen() ? m_cache.lodIndices() : lods.indices;
+  }
+
+  VertexQuantization quantization() const {
+    return VertexQuantization::FromBounds(boundsMin, boundsMax);
+  }
+
+private:
+  void buildVertices(const ObjParser& parser);
+  void computeBounds();
+
+  MeshCache m_cache;
 };
 
-// class Model {
-//   std::vector<Mesh> meshes;
-//   std::string       directory;
-//   Model() = default;
-//   Model(ccstr path);
-//   ~Model() = default;
-
-//   void loadModel();
-// };
-
-// class ModelLoader {
-//   const aiScene* scene;
-//   std::string    path;
-//   void create(std::string path, )
-// };
+// one mesh of a Model inside its shared buffers, indices are relative to
+// vertexOffset and bounds are in mesh space
+struct MeshRange {
+  u32       firstIndex;
+  u32       indexCount;
+  i32       vertexOffset;
+  u32       vertexCount;
+  u32       materialIndex;
+  glm::vec3 boundsMin, boundsMax;
+  // the placements of the mesh in Model::instances
+  u32 firstInstance;
+  u32 instanceCount;
+};
+
+// one placement of a mesh in model space
+struct ModelInstance {
+  glm::mat4 transform;
+  u32       mesh;
+  // the mesh bounds after transform, in model space
+  glm::vec3 boundsMin{0.f}, boundsMax{0.f};
+};
+
+// per instance data in the storage buffer the vertex shaders read, the
+// layout matches Instance in the shaders
+struct InstanceData {
+  glm::mat4 transform;
+  // upper 3x3 is the normal matrix
+  glm::mat4  normalTransform;
+  glm::uvec4 material;
+
+  static InstanceData Create(const glm::mat4& transform, u32 material);
+};
+
+struct ModelMaterial {
+  std::string name;
+  Material    params{};
+  // relative to Model::directory, empty without a texture
+  std::string diffuseTexture;
+};
+
+// Any scene assimp reads (glTF, FBX, obj, ...). Each distinct mesh is
+// stored once in mesh space and every node that places it adds an instance
+// with the node transform. Meshes are distinct by content, so copies that
+// the file stores as separate meshes become instances as well. All meshes
+// are packed into one vertex and one index buffer, each converted in
+// parallel straight into its own slice.
+class Model {
+public:
+  std::vector<Vertex>        vertices;
+  std::vector<u32>           indices;
+  std::vector<MeshRange>     meshes;
+  // grouped by mesh, see MeshRange::firstInstance
+  std::vector<ModelInstance> instances;
+  std::vector<ModelMaterial> materials;
+  std::string                directory;
+
+  glm::vec3 boundsMin{0.f}, boundsMax{0.f};
+
+  Model() = default;
+  // logs and leaves the model empty if assimp cannot read path
+  explicit Model(ccstr path);
+
+  bool empty() const {
+    return indices.empty();
+  }
+
+  u32 allocateVerticesUsingStaging(GeometryBuffer& geometry,
+                                   UploadBatch&    batch);
+  u32 allocateIndicesUsingStaging(GeometryBuffer& geometry, UploadBatch& batch);
+  // drops the vertices and indices once they are uploaded, meshes and
+  // instances stay but empty() is true afterwards
+  void releaseGeometry();
+};
 
 } // namespace myvk::data
\ No newline at end of file
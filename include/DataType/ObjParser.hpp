@@ -0,0 +1,31 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Mesh.hpp"
+
+#include <vector>
+
+namespace myvk::data {
+enum class ObjLoader {
+  eParallel,
+  eTinyObj,
+};
+
+// Parses the geometry of an obj file into tinyobj's attribute layout.
+// Faces are triangulated as fans and flattened into one index list.
+struct ObjParser {
+  tinyobj::attrib_t             attrib;
+  std::vector<tinyobj::index_t> indices;
+
+  // memory maps the file and parses line aligned chunks on the global pool
+  bool parse(ccstr filename);
+  bool parse(const char* text, size_t size);
+  // parses more text, new faces may reference attributes parsed before
+  bool append(const char* text, size_t size);
+
+  bool parseWithTinyObj(ccstr filename);
+
+  Vertex vertexAt(const tinyobj::index_t& tuple) const;
+};
+} // namespace myvk::data
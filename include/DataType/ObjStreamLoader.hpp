@@ -0,0 +1,60 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Mesh.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace myvk::data {
+// a piece of a streamed model, indices are relative to its own vertices
+struct ObjStreamChunk {
+  std::vector<Vertex> vertices;
+  std::vector<u32>    indices;
+};
+
+// Parses an obj file on a background thread in fixed size text blocks and
+// publishes each block's triangles as soon as they are ready. At most
+// kMaxQueuedChunks finished chunks wait for the consumer, so the loader's
+// memory follows the block size rather than the file size (apart from the
+// attribute arrays faces may refer back to). The streamed geometry is also
+// written to the mesh cache so the next open does not have to stream.
+class ObjStreamLoader {
+public:
+  static constexpr size_t kDefaultBlockSize = 16 << 20;
+  static constexpr size_t kMaxQueuedChunks  = 4;
+
+  ObjStreamLoader() = default;
+  ~ObjStreamLoader();
+
+  ObjStreamLoader(const ObjStreamLoader&)            = delete;
+  ObjStreamLoader& operator=(const ObjStreamLoader&) = delete;
+
+  void start(ccstr filename, size_t blockSize = kDefaultBlockSize);
+  void stop();
+
+  // takes the oldest finished chunk, false if none is ready yet
+  bool poll(ObjStreamChunk& out);
+
+  bool isActive() const {
+    return m_thread.joinable();
+  }
+  // the loader has stopped and every chunk has been polled
+  bool isFinished();
+
+private:
+  void run(std::string filename, size_t blockSize);
+  bool publish(ObjStreamChunk&& chunk);
+
+  std::thread                m_thread;
+  std::mutex                 m_mutex;
+  std::condition_variable    m_consumed;
+  std::deque<ObjStreamChunk> m_ready;
+  bool                       m_done{false};
+  bool                       m_stop{false};
+};
+} // namespace myvk::data
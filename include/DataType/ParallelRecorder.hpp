@@ -0,0 +1,67 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "ThreadPool.hpp"
+
+namespace myvk::data {
+// Records the draws of a render pass on several threads. Each thread has a
+// command pool of its own for every frame in flight and records one
+// secondary command buffer, which the primary one executes in order. Pools
+// are reset as a whole when their frame comes around again, so no command
+// buffer is allocated or freed per frame. A frame's buffers can also be kept
+// and executed again when it comes around, until they are invalidated.
+class ParallelRecorder {
+public:
+  // frameCount has to be at least the number of frames in flight
+  void create(VkDevice device, u32 queueFamily, u32 frameCount,
+              u32 maxThreads);
+  void destroy();
+
+  // Splits count items into at most threadCount runs, at least one, and
+  // records run t into buffer t through record(cmd, begin, end) on the
+  // thread pool. The previous frame that used frame's pools has to be done.
+  // With keep the buffers stay valid for reuse() until invalidate().
+  template <typename F>
+  void record(u64 frame, const VkCommandBufferInheritanceInfo& inheritance,
+              u32 count, u32 threadCount, bool keep, F&& record) {
+    beginFrame(frame);
+    m_recorded =
+        std::clamp(std::min(threadCount, count), 1u, (u32)m_pools[0].size());
+    u32 runSize = (count + m_recorded - 1) / m_recorded;
+    ThreadPool::GetGlobal().parallelFor(m_recorded, [&](u32 thread) {
+      VkCommandBuffer cmd   = begin(thread, inheritance, keep);
+      u32             first = std::min(thread * runSize, count);
+      record(cmd, first, std::min(first + runSize, count));
+      vkEndCommandBuffer(cmd);
+    });
+    m_kept[m_frame] = keep ? m_recorded : 0;
+  }
+  // Picks the buffers frame's pools kept the last time, returns false when
+  // there are none and it has to be recorded.
+  bool reuse(u64 frame);
+  // drops every kept recording, for when what they reference changes
+  void invalidate();
+  // executes the buffers of the last record() or reuse()
+  void execute(VkCommandBuffer primary) const;
+
+  u32 maxThreads() const {
+    return m_pools.empty() ? 0 : (u32)m_pools[0].size();
+  }
+
+private:
+  void            beginFrame(u64 frame);
+  VkCommandBuffer begin(u32 thread,
+                        const VkCommandBufferInheritanceInfo& inheritance,
+                        bool                                  keep);
+
+  VkDevice m_device{VK_NULL_HANDLE};
+  // by frame, then thread
+  std::vector<std::vector<VkCommandPool>>   m_pools;
+  std::vector<std::vector<VkCommandBuffer>> m_cmds;
+  // buffers kept by frame, 0 when there is no recording to reuse
+  std::vector<u32> m_kept;
+  u32              m_frame{0};
+  u32              m_recorded{0};
+};
+} // namespace myvk::data
@@ -0,0 +1,71 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "EasyVK/BufferAllocator.hpp"
+
+#include <functional>
+#include <string>
+
+namespace myvk::data {
+// Keeps the device memory in use under a budget. Every asset that can be
+// loaded again is tracked with its size and the frame it was last drawn in.
+// update() reads the device local heaps from VMA, which reports the
+// VK_EXT_memory_budget numbers when the allocator enabled the extension and
+// an estimate otherwise, and evicts the assets unseen the longest until the
+// usage fits.
+class ResidencyManager {
+public:
+  static constexpr u32 kInvalid = ~0u;
+  // an asset unseen for fewer frames may still be read by a frame in
+  // flight, evicted memory also takes this long to be freed
+  static constexpr u32 kMinIdleFrames = 8;
+  // share of the driver's budget that is used when no budget is given
+  static constexpr float kBudgetShare = .9f;
+
+  // with budget 0 the budget follows what the driver reports
+  void create(ezvk::BufferAllocator& allocator, VkPhysicalDevice gpu,
+              VkDeviceSize budget);
+  void destroy();
+
+  // evict frees the asset, which is untracked before it runs
+  u32  track(std::string name, VkDeviceSize bytes, std::function<void()> evict);
+  void untrack(u32 asset);
+  // asset is drawn this frame
+  void touch(u32 asset);
+  // evicts until the usage fits the budget, call once per frame
+  void update();
+
+  VkDeviceSize usage() const {
+    return m_usage;
+  }
+  VkDeviceSize budget() const {
+    return m_budget;
+  }
+  VkDeviceSize trackedBytes() const;
+
+private:
+  struct Asset {
+    std::string           name;
+    VkDeviceSize          bytes;
+    u64                   lastUsed;
+    std::function<void()> evict;
+    bool                  live;
+  };
+
+  ezvk::BufferAllocator* m_allocator{nullptr};
+  // bit per device local heap
+  u32                    m_heapMask{0};
+  u32                    m_heapCount{0};
+  VkDeviceSize           m_fixedBudget{0};
+  VkDeviceSize           m_budget{0};
+  VkDeviceSize           m_usage{0};
+  std::vector<Asset>     m_assets;
+  std::vector<u32>       m_freeHandles;
+  u64                    m_frame{0};
+  // no eviction before this frame, earlier ones still have to show up in
+  // the heap usage
+  u64                    m_nextEviction{0};
+  bool                   m_overBudgetLogged{false};
+};
+} // namespace myvk::data
@@ -0,0 +1,65 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "EasyVK/BufferAllocator.hpp"
+
+#include <deque>
+
+namespace myvk::data {
+// One persistently mapped staging buffer that every upload sub-allocates
+// from. Allocations are handed out in order and freed in order, once the
+// fence of the submit that read them signaled. Everything allocated since
+// the last fence() belongs to the batch that is recording, so only one
+// batch may record at a time.
+class StagingRing {
+public:
+  // enough for buffer to image copies of every format a texture uses
+  static constexpr VkDeviceSize kAlignment = 16;
+
+  struct Span {
+    VkBuffer     buffer{VK_NULL_HANDLE};
+    VkDeviceSize offset{0};
+    VkDeviceSize size{0};
+    u8*          data{nullptr};
+  };
+
+  void create(ezvk::BufferAllocator& allocator, VkDevice device,
+              VkDeviceSize size);
+  void destroy();
+
+  // Between minSize and size contiguous bytes, waits for older submits when
+  // the ring is full. Empty when the bytes not fenced yet fill the ring, the
+  // caller has to submit them first.
+  Span allocate(VkDeviceSize size, VkDeviceSize minSize);
+  // what was allocated since the last call is free once fence signaled
+  void fence(VkFence fence);
+  // call before destroying a fence passed to fence(), it has to be signaled
+  void release(VkFence fence);
+
+  VkDeviceSize capacity() const {
+    return m_buffer.size;
+  }
+
+private:
+  struct Region {
+    // virtual position the region ends at, see m_head
+    u64     end;
+    VkFence fence;
+  };
+
+  // frees regions whose fence signaled, or waits for the oldest one
+  void reclaim(bool wait);
+
+  ezvk::BufferAllocator* m_allocator{nullptr};
+  VkDevice               m_device{VK_NULL_HANDLE};
+  ezvk::AllocatedBuffer  m_buffer;
+  u8*                    m_mapped{nullptr};
+  // Positions grow without wrapping, the byte offset is position % size.
+  // [m_tail, m_fenced) waits for regions, [m_fenced, m_head) for fence().
+  u64                m_head{0};
+  u64                m_fenced{0};
+  u64                m_tail{0};
+  std::deque<Region> m_regions;
+};
+} // namespace myvk::data
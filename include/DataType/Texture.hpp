@@ -1,21 +1,74 @@
 #pragma once
 #include "common.hpp"
 
+#include "DataType/UploadBatch.hpp"
+
 #include "EasyVK/BufferAllocator.hpp"
 
 namespace myvk::data {
+// levels of a full mip chain down to 1x1
+u32 MipLevelCount(u32 width, u32 height);
+
+// bytes of one level, block formats round up to whole 4x4 blocks
+size_t MipLevelSize(VkFormat format, VkExtent2D extent);
+
+// Every level of an image in one buffer, level 0 first. Build box filters
+// RGBA8 sRGB levels in linear space, used when the GPU cannot blit the
+// format and as the input of EncodeBC.
+struct MipChain {
+  VkFormat                format = VK_FORMAT_R8G8B8A8_SRGB;
+  std::vector<u8>         pixels;
+  std::vector<VkExtent2D> extents;
+  std::vector<size_t>     offsets;
+
+  static MipChain Build(const u8* rgba, u32 width, u32 height);
+};
+
+// BC1 when every texel is opaque and BC3 otherwise. Blocks hanging over the
+// edge of a level repeat its last row and column.
+MipChain EncodeBC(const MipChain& rgba);
+
+// every BC format EncodeBC may pick is sampled with linear filtering
+bool SupportsBC(VkPhysicalDevice gpu);
+
+struct TextureSource;
+
 struct TextureImage {
   i32 width, height;
   i32 channels;
+  u32      mipLevels{1};
+  VkFormat format{VK_FORMAT_R8G8B8A8_SRGB};
 
    ezvk::AllocatedImage image;
 
-  void create( ezvk::BufferAllocator& allocator,  ezvk::CommandPool cmdPool,
-              ccstr filename, VkQueue transferQueue, VkDevice device);
-  void transitionImageLayout(VkCommandPool cmdPool, VkDevice device,
-                             VkQueue transferQueue, VkFormat format,
-                             VkImageLayout oldLayout, VkImageLayout newLayout);
+  // Loads the baked KTX2 cache of filename when gpu samples BC formats, and
+  // bakes it on a miss. Without BC support the full RGBA8 mip chain is built
+  // with a GPU blit when gpu can blit the format and on the CPU otherwise.
+  // The upload is recorded into batch.
+  void create(UploadBatch& batch, ccstr filename, VkPhysicalDevice gpu);
+  // a 1x1 texture of one RGBA8 sRGB color, red in the low byte
+  void createSolid(UploadBatch& batch, u32 rgba);
+  // Takes the size and format of source and creates an image for its full
+  // chain without uploading anything. Levels start out UNDEFINED.
+  void allocate(ezvk::BufferAllocator& allocator,
+                const TextureSource&   source);
+  // Records the copy of levels [firstLevel, lastLevel) of source, which end
+  // up in SHADER_READ_ONLY_OPTIMAL. The batch holding the coarsest level
+  // moves the whole image out of UNDEFINED, so ranges go coarsest first. A
+  // range starting at level 0 generates the levels source does not have.
+  void upload(UploadBatch& batch, const TextureSource& source, u32 firstLevel,
+              u32 lastLevel);
+  // records a layout change of [baseMipLevel, baseMipLevel + levelCount),
+  // false if the pair of layouts is not one a texture goes through
+  bool recordTransition(ezvk::CommandBuffer& cmd, VkImageLayout oldLayout,
+                        VkImageLayout newLayout, u32 baseMipLevel = 0,
+                        u32 levelCount = VK_REMAINING_MIP_LEVELS);
   void destroy( ezvk::BufferAllocator& allocator);
+
+private:
+  // blits the whole chain from level 0, which has to be in
+  // TRANSFER_DST_OPTIMAL, every level ends in SHADER_READ_ONLY_OPTIMAL
+  void generateMipmaps(ezvk::CommandBuffer& cmd);
 };
 
-} // namespace myvk::data
\ No newline at end of file
+} // namespace myvk::data
@@ -0,0 +1,46 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/KtxFile.hpp"
+#include "DataType/Texture.hpp"
+
+#include <span>
+
+namespace myvk::data {
+// The levels of a texture before they reach the device, either decoded into
+// levels or mapped from the KTX2 cache. Loading touches no Vulkan object, so
+// it may run on any thread.
+struct TextureSource {
+  MipChain levels;
+  KtxFile  cache;
+  // the full chain, levels past extents() are generated on the GPU
+  u32 mipLevels{0};
+
+  // Reads the KTX2 cache when bc is set and bakes it on a miss. Otherwise
+  // the RGBA8 chain is built on the CPU, or only level 0 is kept when
+  // gpuMips is set.
+  bool load(ccstr filename, bool bc, bool gpuMips);
+  // a single RGBA8 sRGB texel, red in the low byte
+  static TextureSource Solid(u32 rgba);
+
+  VkFormat format() const {
+    return cache.isOpen() ? cache.format() : levels.format;
+  }
+  std::span<const u8> data() const {
+    return cache.isOpen() ? cache.levelData()
+                          : std::span<const u8>(levels.pixels);
+  }
+  std::span<const VkExtent2D> extents() const {
+    return cache.isOpen() ? cache.extents()
+                          : std::span<const VkExtent2D>(levels.extents);
+  }
+  std::span<const size_t> offsets() const {
+    return cache.isOpen() ? cache.offsets()
+                          : std::span<const size_t>(levels.offsets);
+  }
+  size_t levelSize(u32 level) const {
+    return MipLevelSize(format(), extents()[level]);
+  }
+};
+} // namespace myvk::data
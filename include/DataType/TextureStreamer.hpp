@@ -0,0 +1,114 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Texture.hpp"
+#include "DataType/TextureSource.hpp"
+
+#include "EasyVK/BufferAllocator.hpp"
+
+#include <future>
+#include <memory>
+#include <string>
+
+namespace myvk::data {
+// Loads textures in the background. Files are decoded, or mapped from their
+// KTX2 cache, on the thread pool. update() uploads their levels coarsest
+// first, each batch behind its own fence, so a blurry image shows up long
+// before the full resolution one and no frame waits for a copy. Until the
+// first batch is in, view() returns a 1x1 placeholder.
+class TextureStreamer {
+public:
+  // bytes copied per update, a batch always takes at least one level
+  static constexpr size_t kUploadBudget = 16 << 20;
+  // updates a replaced view is kept alive for, so descriptor sets still
+  // holding it can be rewritten and their frames finish first
+  static constexpr u32 kRetireDelay = 8;
+  // mid grey, it does not stand out while the real texture loads
+  static constexpr u32 kPlaceholderColor = 0xFF808080;
+
+  // uploads the placeholder and waits for it
+  void create(ezvk::BufferAllocator& allocator, VkDevice device,
+              VkPhysicalDevice gpu, VkCommandPool cmdPool, VkQueue queue,
+              StagingRing& ring);
+  // waits for loads and uploads still running
+  void destroy();
+
+  // Starts loading filename and returns its id. With wait set the texture
+  // is loaded and fully uploaded before this returns.
+  u32 request(ccstr filename, bool wait = false);
+  // Takes finished loads, retires batches whose fence signaled and starts
+  // the next ones. True when a view changed since the last call, every
+  // descriptor holding view() has to be rewritten then.
+  bool update();
+
+  // the levels of texture that are in so far, or the placeholder
+  VkImageView view(u32 texture) const;
+  bool        isResident(u32 texture) const;
+
+  // Frees the image of texture, view() returns the placeholder until
+  // reload() brought it back. The next update() reports the change.
+  void evict(u32 texture);
+  // loads an evicted texture again, from its KTX2 cache when it has one
+  void reload(u32 texture);
+  // device memory of the image of texture, 0 while it has none
+  VkDeviceSize memorySize(u32 texture) const;
+
+private:
+  struct Entry {
+    std::string                                 filename;
+    std::future<std::unique_ptr<TextureSource>> pending;
+    // dropped once every level is in
+    std::unique_ptr<TextureSource> source;
+    TextureImage                   image;
+    VkImageView                    view{VK_NULL_HANDLE};
+    // finest level shaders may read and finest level copied or in flight,
+    // both are mipLevels until the first batch
+    u32  residentLevel{0};
+    u32  uploadedLevel{0};
+    bool allocated{false};
+    bool uploading{false};
+  };
+
+  // levels from firstLevel up to the last batch of one texture
+  struct Batch {
+    u32         texture;
+    u32         firstLevel;
+    UploadBatch upload;
+  };
+
+  struct RetiredView {
+    VkImageView view;
+    u64         destroyAt;
+  };
+
+  struct RetiredImage {
+    TextureImage image;
+    u64          destroyAt;
+  };
+
+  static std::unique_ptr<TextureSource> Load(const std::string& filename,
+                                             bool               bc);
+
+  void        accept(u32 texture, std::unique_ptr<TextureSource> source);
+  void        submit(u32 texture, u32 firstLevel, u32 lastLevel);
+  bool        retireFinishedBatches();
+  VkImageView createView(const TextureImage& image, u32 baseLevel);
+
+  ezvk::BufferAllocator*    m_allocator{nullptr};
+  VkDevice                  m_device{VK_NULL_HANDLE};
+  VkCommandPool             m_cmdPool{VK_NULL_HANDLE};
+  VkQueue                   m_queue{VK_NULL_HANDLE};
+  StagingRing*              m_ring{nullptr};
+  bool                      m_bc{false};
+  TextureImage              m_placeholder;
+  VkImageView               m_placeholderView{VK_NULL_HANDLE};
+  std::vector<Entry>        m_entries;
+  std::vector<Batch>        m_batches;
+  std::vector<RetiredView>  m_retired;
+  std::vector<RetiredImage> m_retiredImages;
+  u64                       m_updateCount{0};
+  // set by evict(), update() reports it
+  bool m_viewsChanged{false};
+};
+} // namespace myvk::data
@@ -0,0 +1,52 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "EasyVK/BufferAllocator.hpp"
+
+#include <optional>
+
+namespace myvk::data {
+// Persistently mapped uniform memory split into one slice per frame in
+// flight. Each frame writes its blocks one after another into its own slice
+// and binds them through UNIFORM_BUFFER_DYNAMIC offsets, so nothing is
+// mapped per frame and nothing a frame still in flight reads is overwritten.
+class UniformRing {
+public:
+  // frameCount has to be at least the number of frames in flight
+  void create(ezvk::BufferAllocator& allocator, VkPhysicalDevice gpu,
+              VkDeviceSize frameSize, u32 frameCount);
+  void destroy();
+
+  // starts writing the slice of frame, whose previous frame has to be done
+  void beginFrame(u64 frame);
+  // Dynamic offset of a copy of size bytes of data, nothing when the
+  // frame's slice is full. The slice never wraps, blocks the frame already
+  // bound stay as they are.
+  std::optional<u32> push(const void* data, VkDeviceSize size);
+  template <typename T>
+  std::optional<u32> push(const T& data) {
+    return push(&data, sizeof(T));
+  }
+  // makes the frame's writes visible, call before submitting it
+  void endFrame();
+
+  VkBuffer buffer() const {
+    return m_buffer.buffer;
+  }
+  // bytes pushed in the current frame
+  VkDeviceSize frameUsed() const {
+    return m_head - m_frameBegin;
+  }
+
+private:
+  ezvk::BufferAllocator* m_allocator{nullptr};
+  ezvk::AllocatedBuffer  m_buffer;
+  u8*                    m_mapped{nullptr};
+  VkDeviceSize           m_alignment{0};
+  VkDeviceSize           m_frameSize{0};
+  u32                    m_frameCount{0};
+  VkDeviceSize           m_frameBegin{0};
+  VkDeviceSize           m_head{0};
+};
+} // namespace myvk::data
@@ -0,0 +1,74 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/StagingRing.hpp"
+
+#include "EasyVK/BufferAllocator.hpp"
+
+#include <span>
+
+namespace myvk::data {
+// Records the copies and layout changes of a load into one command buffer
+// and submits it behind its own fence, with the data staged in a
+// StagingRing. When the ring runs full, what was recorded so far is
+// submitted early and large copies are split, so a load costs one submit
+// per ring's worth of data however many buffers and textures it brings in.
+// Nothing waits for the whole device.
+class UploadBatch {
+public:
+  void begin(ezvk::BufferAllocator& allocator, VkDevice device,
+             VkCommandPool cmdPool, VkQueue queue, StagingRing& ring);
+
+  // copies size bytes of data to dstOffset of dst
+  void copyToBuffer(const void* data, VkDeviceSize size, VkBuffer dst,
+                    VkDeviceSize dstOffset = 0);
+  // device local buffer holding a copy of data once the batch finished
+  ezvk::AllocatedBuffer uploadBuffer(const void* data, VkDeviceSize size,
+                                     VkBufferUsageFlags usage);
+  // Copies regions of tightly packed texels to image, which has to be in
+  // TRANSFER_DST_OPTIMAL. bufferOffset of each region is relative to data.
+  void copyToImage(VkImage image, VkFormat format, const u8* data,
+                   std::span<const VkBufferImageCopy> regions);
+
+  // Ends recording and submits. Later submits on the queue see every buffer
+  // write, images are left in the layouts recorded into cmd().
+  void submit();
+  bool finished() const;
+  void wait() const;
+  // waits for the batch and frees what it owns, begin() may be called again
+  void release();
+
+  // the command buffer recording now, copies may submit it and start the
+  // next one in the same object
+  ezvk::CommandBuffer& cmd() {
+    return m_cmd;
+  }
+  ezvk::BufferAllocator& allocator() const {
+    return *m_allocator;
+  }
+  VkDeviceSize stagedBytes() const {
+    return m_stagedBytes;
+  }
+
+private:
+  struct Submit {
+    ezvk::CommandBuffer cmd;
+    VkFence             fence;
+  };
+
+  // room in the ring, submits what was recorded so far when it is full
+  StagingRing::Span stage(VkDeviceSize size, VkDeviceSize minSize);
+  void              submitRecorded();
+
+  ezvk::BufferAllocator* m_allocator{nullptr};
+  VkDevice               m_device{VK_NULL_HANDLE};
+  VkCommandPool          m_cmdPool{VK_NULL_HANDLE};
+  VkQueue                m_queue{VK_NULL_HANDLE};
+  StagingRing*           m_ring{nullptr};
+  ezvk::CommandBuffer    m_cmd;
+  std::vector<Submit>    m_submits;
+  VkDeviceSize           m_stagedBytes{0};
+  bool                   m_recording{false};
+};
+} // namespace myvk::data
@@ -0,0 +1,122 @@
+#pragma once
+#include "common.hpp"
+#include "pch.hpp"
+
+#include "DataType/Mesh.hpp"
+
+#include <array>
+#include <span>
+
+namespace myvk::data {
+enum class VertexFormat {
+  // Vertex, fp32 everything, 44 bytes
+  eFull,
+  // PackedVertex, 16 bytes
+  ePacked,
+};
+
+// storage types of quantized attributes, they only differ in their format
+struct Unorm16x4 {
+  u16 x, y, z, w;
+};
+struct Snorm16x2 {
+  i16 x, y;
+};
+struct Half2 {
+  u16 x, y;
+};
+
+template <typename T> struct VertexAttributeFormat;
+template <> struct VertexAttributeFormat<glm::vec2> {
+  static constexpr VkFormat kFormat = VK_FORMAT_R32G32_SFLOAT;
+};
+template <> struct VertexAttributeFormat<glm::vec3> {
+  static constexpr VkFormat kFormat = VK_FORMAT_R32G32B32_SFLOAT;
+};
+template <> struct VertexAttributeFormat<Unorm16x4> {
+  static constexpr VkFormat kFormat = VK_FORMAT_R16G16B16A16_UNORM;
+};
+template <> struct VertexAttributeFormat<Snorm16x2> {
+  static constexpr VkFormat kFormat = VK_FORMAT_R16G16_SNORM;
+};
+template <> struct VertexAttributeFormat<Half2> {
+  static constexpr VkFormat kFormat = VK_FORMAT_R16G16_SFLOAT;
+};
+
+template <typename Field>
+constexpr VkVertexInputAttributeDescription MakeVertexAttribute(u32 location,
+                                                                u32 offset) {
+  return {
+      .location = location,
+      .binding  = 0,
+      .format   = VertexAttributeFormat<Field>::kFormat,
+      .offset   = offset,
+  };
+}
+
+#define VERTEX_ATTRIBUTE(type, member, location)                               \
+  MakeVertexAttribute<decltype(type::member)>(location, offsetof(type, member))
+
+// Specialized for every vertex type, kAttributes lists the shader inputs in
+// their binding 0 layout.
+template <typename V> struct VertexLayout;
+
+template <> struct VertexLayout<Vertex> {
+  static constexpr std::array kAttributes{
+      VERTEX_ATTRIBUTE(Vertex, pos, 0),
+      VERTEX_ATTRIBUTE(Vertex, color, 1),
+      VERTEX_ATTRIBUTE(Vertex, norm, 2),
+      VERTEX_ATTRIBUTE(Vertex, uv, 3),
+  };
+};
+
+// Positions are 16 bit fractions of the mesh bounds, normals are octahedral
+// encoded and uvs are half floats. There is no vertex color.
+struct PackedVertex {
+  Unorm16x4 pos;
+  Snorm16x2 norm;
+  Half2     uv;
+};
+static_assert(sizeof(PackedVertex) == 16);
+
+template <> struct VertexLayout<PackedVertex> {
+  static constexpr std::array kAttributes{
+      VERTEX_ATTRIBUTE(PackedVertex, pos, 0),
+      VERTEX_ATTRIBUTE(PackedVertex, norm, 2),
+      VERTEX_ATTRIBUTE(PackedVertex, uv, 3),
+  };
+};
+
+#undef VERTEX_ATTRIBUTE
+
+template <typename V> VertexInputDescription GetVertexDescription() {
+  constexpr auto& attributes = VertexLayout<V>::kAttributes;
+  return {
+      .bindings   = {{
+          .binding   = 0,
+          .stride    = sizeof(V),
+          .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+      }},
+      .attributes = {attributes.begin(), attributes.end()},
+  };
+}
+
+// maps the unorm positions of packed vertices back into model space
+struct VertexQuantization {
+  glm::vec3 offset{0.f};
+  glm::vec3 scale{1.f};
+
+  static VertexQuantization FromBounds(const glm::vec3& boundsMin,
+                                       const glm::vec3& boundsMax);
+};
+
+glm::vec2 OctEncode(const glm::vec3& normal);
+glm::vec3 OctDecode(const glm::vec2& encoded);
+
+PackedVertex PackVertex(const Vertex& vertex,
+                        const VertexQuantization& quantization);
+// packs vertices[remap[i]] into element i, or every vertex if remap is empty
+std::vector<PackedVertex> PackVertices(std::span<const Vertex>   vertices,
+                                       const VertexQuantization& quantization,
+                                       std::span<const u32>      remap = {});
+} // namespace myvk::data
@@ -0,0 +1,13 @@
+#pragma once
+#include "common.hpp"
+
+#include <cstddef>
+
+namespace myvk {
+// 64 bit non-cryptographic hash (xxHash64 construction)
+u64 HashBytes(const void* data, size_t size, u64 seed = 0);
+
+// hashes fixed size blocks on the global thread pool and combines them, the
+// result differs from HashBytes over the same data
+u64 HashBytesParallel(const void* data, size_t size, u64 seed = 0);
+} // namespace myvk
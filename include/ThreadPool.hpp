@@ -0,0 +1,88 @@
+#pragma once
+#include "common.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace myvk {
+class ThreadPool {
+public:
+  explicit ThreadPool(u32 threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&)            = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  static ThreadPool& GetGlobal();
+
+  u32 size() const {
+    return (u32)m_workers.size();
+  }
+
+  template <typename F> auto submit(F&& task) {
+    using R = std::invoke_result_t<F>;
+    auto packaged =
+        std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+    std::future<R> ret = packaged->get_future();
+    enqueue([packaged] { (*packaged)(); });
+    return ret;
+  }
+
+  // Runs fn(i) for i in [0, count). The calling thread takes part in the
+  // work, so it is safe to call from inside another pool task.
+  template <typename F> void parallelFor(u32 count, F&& fn) {
+    if (count == 0)
+      return;
+    if (count == 1 || size() == 0) {
+      for (u32 i = 0; i < count; ++i)
+        fn(i);
+      return;
+    }
+
+    struct State {
+      std::atomic<u32>        next{0};
+      std::atomic<u32>        done{0};
+      std::mutex              mutex;
+      std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+
+    auto work = [state, count, &fn] {
+      u32 i;
+      while ((i = state->next.fetch_add(1)) < count) {
+        fn(i);
+        if (state->done.fetch_add(1) + 1 == count) {
+          std::lock_guard lock(state->mutex);
+          state->finished.notify_all();
+        }
+      }
+    };
+
+    u32 helpers = std::min(count - 1, size());
+    for (u32 i = 0; i < helpers; ++i)
+      enqueue(work);
+    work();
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done.load() == count; });
+  }
+
+private:
+  void enqueue(std::function<void()> task);
+  void workerLoop();
+
+  std::vector<std::thread>          m_workers;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex                        m_mutex;
+  std::condition_variable           m_taskReady;
+  bool                              m_stop{false};
+};
+} // namespace myvk
@@ -6,24 +6,62 @@ layout(location = 2) in vec3 inPos;
 
 layout(location = 0) out vec4 outFragColor;
 
-layout(binding = 1) uniform sampler2D texSampler;
-layout(binding = 2) uniform Light {
+// the clusters of LightClusters, see lightcull.comp
+const uint kTilesX = 16;
+const uint kTilesY = 9;
+const uint kSlices = 24;
+const uint kMaxClusterLights = 256;
+
+struct Light {
   vec3 position;
+  float radius;
   vec3 color;
-} uniLight;
+};
+
+layout(binding = 1) uniform sampler2D texSampler;
+layout(std430, binding = 2) readonly buffer Lights {
+  Light lights[];
+};
+layout(std140, binding = 5) uniform ClusterView {
+  mat4 view;
+  mat4 invProj;
+  vec2 extent;
+  float zNear;
+  float zFar;
+  uint lightCount;
+  uint firstLight;
+} cluster;
+layout(std430, binding = 6) readonly buffer Clusters {
+  uint clusterLightCounts[kTilesX * kTilesY * kSlices];
+  uint droppedLights;
+  uint clusterLights[];
+};
 
 
 void main() {
-  float ambientLightIntense = 0.1f;
-  vec4 ambient = vec4(uniLight.color * ambientLightIntense, 1.f);
+  float depth = -(cluster.view * vec4(inPos, 1.0)).z;
+  uvec2 tile = min(uvec2(gl_FragCoord.xy / cluster.extent *
+                         vec2(kTilesX, kTilesY)),
+                   uvec2(kTilesX - 1, kTilesY - 1));
+  float slice = log(max(depth, cluster.zNear) / cluster.zNear) /
+                log(cluster.zFar / cluster.zNear) * float(kSlices);
+  uint id = (min(uint(slice), kSlices - 1) * kTilesY + tile.y) * kTilesX +
+            tile.x;
 
   vec3 norm = normalize(inNorm);
-  vec3 lightDir = normalize(uniLight.position - inPos);
-
-  float diff = max(dot(norm, lightDir), 0.0);
-  vec4 diffuse = diff * vec4(uniLight.color, 1);
+  vec3 lighting = vec3(0.1);
+  uint first = id * kMaxClusterLights;
+  for (uint i = 0; i < clusterLightCounts[id]; ++i) {
+    Light light = lights[clusterLights[first + i]];
+    vec3 toLight = light.position - inPos;
+    float dist = length(toLight);
+    float falloff = clamp(1.0 - dist * dist / (light.radius * light.radius),
+                          0.0, 1.0);
+    float diff = max(dot(norm, toLight / max(dist, 1e-4)), 0.0);
+    lighting += diff * falloff * falloff * light.color;
+  }
 
   vec4 objectColor = texture(texSampler, inTexCoord);
 
-  outFragColor = objectColor * (ambient + diffuse);
+  outFragColor = objectColor * vec4(lighting, 1.0);
 }
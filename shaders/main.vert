@@ -13,10 +13,26 @@ layout(binding = 0) uniform MVP {
   mat4 model, view, proj;
 } ubo;
 
+// per draw instance, instance 0 is the identity
+struct Instance {
+  mat4 transform;
+  mat4 normalTransform;
+  uvec4 material;
+};
+layout(std430, binding = 3) readonly buffer Instances {
+  Instance instances[];
+};
+// instances left by GpuCuller, entry 0 is 0
+layout(std430, binding = 4) readonly buffer Visible {
+  uint visible[];
+};
+
 
 void main() {
-  gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPos, 1.0);
-  outFragPos = vec3(ubo.model * vec4(inPos, 1.f));
-  outNorm = inNorm;
+  Instance instance = instances[visible[gl_InstanceIndex]];
+  vec4 worldPos = ubo.model * instance.transform * vec4(inPos, 1.0);
+  gl_Position = ubo.proj * ubo.view * worldPos;
+  outFragPos = vec3(worldPos);
+  outNorm = mat3(instance.normalTransform) * inNorm;
   outUV = inUV;
 }
@@ -0,0 +1,48 @@
+#version 450
+
+// PackedVertex: unorm positions relative to the mesh bounds, octahedral
+// normals and half float uvs, decoded by the vertex fetch
+layout(location = 0) in vec4 inPos;
+layout(location = 2) in vec2 inOctNorm;
+layout(location = 3) in vec2 inUV;
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out vec3 outNorm;
+layout(location = 2) out vec3 outFragPos;
+layout(binding = 0) uniform MVP {
+  mat4 model, view, proj;
+  vec4 posOffset, posScale;
+} ubo;
+
+// per draw instance, instance 0 is the identity
+struct Instance {
+  mat4 transform;
+  mat4 normalTransform;
+  uvec4 material;
+};
+layout(std430, binding = 3) readonly buffer Instances {
+  Instance instances[];
+};
+// instances left by GpuCuller, entry 0 is 0
+layout(std430, binding = 4) readonly buffer Visible {
+  uint visible[];
+};
+
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0) {
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0,
+                                    n.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normalize(n);
+}
+
+void main() {
+  vec3 pos = ubo.posOffset.xyz + inPos.xyz * ubo.posScale.xyz;
+  Instance instance = instances[visible[gl_InstanceIndex]];
+  vec4 worldPos = ubo.model * instance.transform * vec4(pos, 1.0);
+  gl_Position = ubo.proj * ubo.view * worldPos;
+  outFragPos = vec3(worldPos);
+  outNorm = mat3(instance.normalTransform) * octDecode(inOctNorm);
+  outUV = inUV;
+}
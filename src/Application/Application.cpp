@@ -58,8 +58,14 @@ void Application::initialize() {
   m_deviceObj->create(
       m_instanceObj,
       [](vkb::PhysicalDeviceSelector& selector) {
-        selector.set_minimum_version(1, 2).add_desired_extensions(
-            g_deviceExtensionNames);
+        selector.set_minimum_version(1, 2)
+            .add_desired_extensions(g_deviceExtensionNames)
+            // indirect draws of many meshes with their own instances
+            .set_required_features({
+                .multiDrawIndirect         = VK_TRUE,
+                .drawIndirectFirstInstance = VK_TRUE,
+                .samplerAnisotropy         = VK_TRUE,
+            });
       },
       m_rendererObj->m_surface);
 
@@ -5,6 +5,9 @@
 #include "DataType/Mesh.hpp"
 
 #include <array>
+#include <cstring>
+#include <filesystem>
+#include <random>
 
 namespace myvk {
 
@@ -27,19 +30,36 @@ struct UniformBufferObject {
   glm::mat4 model;
   glm::mat4 view;
   glm::mat4 proj;
+  // dequantizes PackedVertex positions
+  glm::vec4 posOffset;
+  glm::vec4 posScale;
 } g_uniformData;
 
 data::Light g_light{
     {5.f, 12.f, 0.f},
+    data::Camera::kFar,
     {1, 1, 1},
 };
 
+// the light counts of RendererOptions::lightBenchmarkFrames
+constexpr u32 kLightBenchmarkCounts[] = {16, 256, 4096};
+
 void windowFramebufferResizeCallback(GLFWwindow* window, int width,
                                      int height) {
   Renderer* renderer = gui::MainWindow::getUserPointer<Renderer*>(window);
   renderer->m_window.m_framebufferResized = true;
 }
 
+bool sameDraws(const FrameDraws& a, const FrameDraws& b) {
+  return a.pipeline == b.pipeline && a.indexType == b.indexType &&
+         a.descriptorSet == b.descriptorSet &&
+         a.uniformOffset == b.uniformOffset &&
+         a.vertexBuffer == b.vertexBuffer && a.indexBuffer == b.indexBuffer &&
+         a.gpuCulled == b.gpuCulled && a.draws.size() == b.draws.size() &&
+         std::memcmp(a.draws.data(), b.draws.data(),
+                     a.draws.size() * sizeof(a.draws[0])) == 0;
+}
+
 void camCallback(GLFWwindow* window, double xoffset, double yoffset) {
   Renderer*     renderer = gui::MainWindow::getUserPointer<Renderer*>(window);
   data::Camera& cam      = renderer->m_state.camera;
@@ -47,28 +67,69 @@ void camCallback(GLFWwindow* window, double xoffset, double yoffset) {
 }
 
 void Renderer::create(Application* app) {
+  m_createTime  = std::chrono::steady_clock::now();
   m_application = app;
   getGraphicQueueAndQueueIndex();
   m_transientCmdPool.create(*m_application,
                             VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
                             m_graphicQueueIndex);
+  m_stagingRing.create(m_application->m_allocator, *m_application,
+                       m_options.stagingRingSize);
+  m_residency.create(m_application->m_allocator, *m_application,
+                     m_options.memoryBudget);
   createTextures();
   createSwapchain();
   createDepthImages();
   createRenderPass(true);
   createShaders();
+  // room for the most lights the benchmark shades when it runs
+  u32 maxLights = m_options.lightCount;
+  if (m_options.lightBenchmarkFrames)
+    maxLights = std::max(maxLights, kLightBenchmarkCounts[2]);
+  m_lightClusters.create(m_application->m_allocator, *m_application,
+                         maxLights, m_swapchainObj->getImageCount(),
+                         m_shaders["lightCullComp"].m_shaderInfo);
   createDescriptorSets();
   createDefaultPipeline();
   createFrameBuffer(true);
-  createMesh();
+  m_gpuCuller.create(m_application->m_allocator, *m_application,
+                     *m_application, m_transientCmdPool, m_graphicQueue,
+                     m_swapchainObj->getImageCount(),
+                     m_shaders["cullComp"].m_shaderInfo);
+  m_depthPyramid.create(m_application->m_allocator, *m_application,
+                        m_shaders["depthPyramidComp"].m_shaderInfo);
+  m_depthPyramid.resize(m_depthImageView, {m_window.m_width, m_window.m_height},
+                        m_sampleCount);
+  m_gpuCuller.setPyramid(m_depthPyramid);
+  m_gpuTimer.create(*m_application, *m_application,
+                    m_swapchainObj->getImageCount());
+  // the main thread takes part in the recording
+  m_recorder.create(*m_application, m_graphicQueueIndex,
+                    m_swapchainObj->getImageCount(),
+                    ThreadPool::GetGlobal().size() + 1);
+  m_recordedDraws.assign(m_swapchainObj->getImageCount(), {});
+
+  // every buffer of the model goes out in one batch
+  data::UploadBatch upload;
+  upload.begin(m_application->m_allocator, *m_application, m_transientCmdPool,
+               m_graphicQueue, m_stagingRing);
+  createMesh(upload);
+  upload.submit();
+  LOG_INFO("uploaded {} bytes in one batch", upload.stagedBytes());
+  upload.release();
+  // a streaming model has no bounds yet, its lights move once it has
+  placeLights();
 }
 
 void Renderer::destroy() {
   vkDeviceWaitIdle(*m_application);
 
-  m_transientCmdPool.destroy(*m_application);
-
   destroyMesh();
+  m_gpuCuller.destroy();
+  m_depthPyramid.destroy();
+  m_gpuTimer.destroy();
+  m_recorder.destroy();
+  m_lightClusters.destroy();
   destroyFrameBuffer();
   destroyDefaultPipeline();
   destroyDescriptorSets();
@@ -76,7 +137,12 @@ void Renderer::destroy() {
   destroyRenderPass();
   destroySwapchain();
   destroyDepthImages();
+  // the texture streamer frees its batches into the pool
   destroyTextures();
+
+  m_residency.destroy();
+  m_stagingRing.destroy();
+  m_transientCmdPool.destroy(*m_application);
 }
 
 void Renderer::recreateSwapchain() {
@@ -101,6 +167,10 @@ void Renderer::recreateSwapchain() {
   createRenderPass(true);
   createDefaultPipeline();
   createFrameBuffer(true);
+  m_depthPyramid.resize(m_depthImageView, {m_window.m_width, m_window.m_height},
+                        m_sampleCount);
+  m_gpuCuller.setPyramid(m_depthPyramid);
+  invalidateRecordings();
 }
 
 void Renderer::prepare() {}
@@ -132,8 +202,26 @@ void Renderer::render() {
     return;
   }
 
+  // the fence above covers the frame that last used this slot
+  readFrameStats(m_frameBuffer.frameCount);
+
   m_window.updateNormalCamera(m_state.camera);
 
+  // the sets go with the frame slot, the image acquired may still be drawn
+  // to by a frame of another slot that bound its set
+  u32 frameSlot = (u32)(m_frameBuffer.frameCount % m_uniformSets.size());
+  if (m_textureStreamer.update())
+    std::fill(m_staleTextureSets.begin(), m_staleTextureSets.end(), 1);
+  if (m_staleTextureSets[frameSlot]) {
+    writeTextureDescriptor(frameSlot);
+    m_staleTextureSets[frameSlot] = 0;
+  }
+
+  m_geometry.update();
+  if (m_streamLoader.isActive() || !m_meshUploads.empty()) {
+    uploadStreamedMeshes();
+  }
+
   VkClearValue colorClear{
       .color = {{0.f, 0.f, 0.f, 0.f}},
   };
@@ -158,33 +246,226 @@ void Renderer::render() {
       .pClearValues    = clearValue,
   };
 
-  // automatically set cmdBuffer to initial
-  currentData.cmdBuffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-  currentData.cmdBuffer
-      .beginRenderPass(&renderPassBI, VK_SUBPASS_CONTENTS_INLINE)
-      .bindPipelineGraphic(m_defaultPipeline);
-
   g_uniformData.model = glm::mat4{1.f};
   g_uniformData.view  = m_state.camera.viewMat();
   g_uniformData.proj =
       m_state.camera.projMat((float)m_window.m_width / m_window.m_height);
-  m_uniformBuffer.transferMemory(m_application->m_allocator, &g_uniformData,
-                                 sizeof(g_uniformData));
-
-  currentData.cmdBuffer
-      .bindDescriptorSetNoDynamic(VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                  m_defaultPipelineLayout, 0, 1,
-                                  &m_uniformSets[swapchainImgIdx])
+  glm::mat4 viewProj =
+      g_uniformData.proj * g_uniformData.view * g_uniformData.model;
+  updateResidency(viewProj);
+  g_uniformData.posOffset = glm::vec4{m_testModelQuantization.offset, 0.f};
+  g_uniformData.posScale  = glm::vec4{m_testModelQuantization.scale, 1.f};
+
+  auto frustum           = data::Frustum::FromMatrix(viewProj);
+  bool sceneLoaded       = m_sceneIndexRange != data::GeometryBuffer::kInvalid;
+  u32  sceneFirstIndex   = 0;
+  i32  sceneVertexOffset = 0;
+  if (sceneLoaded) {
+    sceneFirstIndex   = m_geometry.first(m_sceneIndexRange);
+    sceneVertexOffset = (i32)m_geometry.first(m_sceneVertexRange);
+    u32 interval      = m_options.gpuCullingValidationInterval;
+    if (interval && m_frameBuffer.frameCount % interval == 0) {
+      auto stats =
+          m_gpuCuller.validate(frustum, sceneFirstIndex, sceneVertexOffset);
+      LOG_INFO("culled {} objects, gpu kept {} in {} ms with the submit, cpu "
+               "kept {} in {} ms",
+               m_gpuCuller.objectCount(), stats.gpuVisible, stats.gpuMs,
+               stats.cpuVisible, stats.cpuMs);
+    }
+  }
 
-      .bindVertexBuffer(m_testModelVertexBuf.buffer)
-      .bindIndexBuffer(m_testModelIndexBuf.buffer, VK_INDEX_TYPE_UINT32)
+  // the benchmark turns it on every other occlusionBenchmarkFrames frames
+  u32  benchmarkFrames = m_options.occlusionBenchmarkFrames;
+  bool occlusion       = m_options.occlusionCulling;
+  if (benchmarkFrames)
+    occlusion = m_frameBuffer.frameCount / benchmarkFrames % 2 == 1;
+  occlusion = occlusion && sceneLoaded &&
+              m_options.sceneCulling == SceneCulling::eGpu;
+  if (occlusion)
+    renderPassBI.renderPass = m_earlyRenderPass;
 
-      .drawIndexed((u32)m_testModel.indices.size(), 1, 0, 0, 0)
+  // automatically set cmdBuffer to initial
+  currentData.cmdBuffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  m_gpuTimer.begin(currentData.cmdBuffer.cmdBuffer, m_frameBuffer.frameCount);
+
+  // the culling writes the draws, which a render pass may not do
+  if (sceneLoaded && m_options.sceneCulling != SceneCulling::eCpu)
+    m_gpuCuller.record(currentData.cmdBuffer.cmdBuffer, frustum, viewProj,
+                       m_options.sceneCulling == SceneCulling::eGpu, occlusion,
+                       sceneFirstIndex, sceneVertexOffset);
+  m_lightClusters.record(currentData.cmdBuffer.cmdBuffer, g_uniformData.view,
+                         g_uniformData.proj,
+                         {m_window.m_width, m_window.m_height},
+                         data::Camera::kNear, data::Camera::kFar,
+                         lightCount(m_frameBuffer.frameCount),
+                         m_frameBuffer.frameCount);
+
+  // the fence above covers the frame that last wrote this slice
+  m_uniformRing.beginFrame(m_frameBuffer.frameCount);
+  auto uniformOffset = m_uniformRing.push(g_uniformData);
+
+  // what to draw is collected first and then recorded, inline or on threads
+  FrameDraws& frameDraws   = m_frameDraws;
+  frameDraws.pipeline      = m_defaultPipeline;
+  frameDraws.indexType     = VK_INDEX_TYPE_UINT32;
+  frameDraws.descriptorSet = m_uniformSets[frameSlot];
+  frameDraws.uniformOffset = uniformOffset.value_or(0);
+  frameDraws.vertexBuffer  = m_geometry.vertexBuffer();
+  frameDraws.indexBuffer   = m_geometry.indexBuffer();
+  frameDraws.gpuCulled     = false;
+  frameDraws.draws.clear();
+
+  // every mesh lives in the shared buffers, draws only differ in offsets
+  u32 drawnIndexCount = 0;
+  if (sceneLoaded) {
+    if (m_options.sceneCulling == SceneCulling::eCpu) {
+      drawnIndexCount =
+          cullSceneOnCpu(frustum, sceneFirstIndex, sceneVertexOffset);
+    } else {
+      // what is left after culling only the GPU knows
+      frameDraws.gpuCulled = true;
+      drawnIndexCount      = m_sceneInstancedIndexCount;
+    }
+  } else if (!m_streamedMeshes.empty()) {
+    for (auto& mesh : m_streamedMeshes) {
+      frameDraws.draws.push_back({mesh.indexCount, 1,
+                                  m_geometry.first(mesh.indexRange),
+                                  (i32)m_geometry.first(mesh.vertexRange), 0});
+      drawnIndexCount += mesh.indexCount;
+    }
+  } else if (m_testModelIndexRange != data::GeometryBuffer::kInvalid) {
+    auto lodLevels = m_testModel.lodLevels();
+    u32  lod       = 0;
+    if (m_options.lod && !lodLevels.empty()) {
+      glm::vec3 center = (m_testModel.boundsMin + m_testModel.boundsMax) * .5f;
+      float     radius =
+          glm::length(m_testModel.boundsMax - m_testModel.boundsMin) * .5f;
+      float distance = glm::length(m_state.camera.m_eye - center) - radius;
+      m_lodSelector.pixelError = m_options.lodPixelError;
+      lod = m_lodSelector.select(lodLevels, g_uniformData.proj,
+                                 (float)m_window.m_height, distance);
+    }
+    m_state.lodLevel = lod;
+
+    m_drawRanges.clear();
+    if (lod > 0) {
+      // distant levels are small and mostly on screen, they skip culling
+      m_drawRanges.push_back(
+          {lodLevels[lod - 1].firstIndex, lodLevels[lod - 1].indexCount, 0});
+    } else if (m_options.meshletCulling && !m_testModelMeshlets.empty()) {
+      data::MeshletCuller::Cull(m_testModelMeshlets, frustum,
+                                m_state.camera.m_eye,
+                                m_options.backfaceCulling, m_drawRanges);
+    } else {
+      for (const auto& chunk : m_testModelIndices.chunks)
+        m_drawRanges.push_back(
+            {chunk.firstIndex, chunk.indexCount, chunk.vertexOffset});
+    }
+
+    if (m_options.vertexFormat == data::VertexFormat::ePacked)
+      frameDraws.pipeline = m_packedPipeline;
+    u32 indexRange       = m_testModelIndexRange;
+    frameDraws.indexType = m_testModelIndices.type;
+    if (lod > 0) {
+      indexRange           = m_testModelLodIndexRange;
+      frameDraws.indexType = m_testModelLodIndexType;
+    }
+    u32 firstIndex   = m_geometry.first(indexRange);
+    i32 vertexOffset = (i32)m_geometry.first(m_testModelVertexRange);
+    for (const auto& range : m_drawRanges) {
+      frameDraws.draws.push_back({range.indexCount, 1,
+                                  firstIndex + range.firstIndex,
+                                  vertexOffset + range.vertexOffset, 0});
+      drawnIndexCount += range.indexCount;
+    }
+  }
+  // without its uniforms the frame draws nothing rather than garbage
+  if (!uniformOffset) {
+    frameDraws.draws.clear();
+    frameDraws.gpuCulled = false;
+    drawnIndexCount      = 0;
+  }
+  m_state.drawnTriangles = drawnIndexCount / 3;
+
+  bool reuse         = m_options.reuseRecording;
+  u32  recordThreads = m_options.recordThreads;
+  if (m_options.recordBenchmarkFrames)
+    recordThreads = m_recordBenchmark.threads;
+  // only secondary buffers can be kept
+  if (reuse)
+    recordThreads = std::max(recordThreads, 1u);
+  auto recordStart        = std::chrono::steady_clock::now();
+  m_state.recordingReused = false;
+  if (recordThreads > 0) {
+    FrameDraws& recorded = m_recordedDraws[m_frameBuffer.frameCount %
+                                           m_recordedDraws.size()];
+    if (reuse && sameDraws(recorded, frameDraws) &&
+        m_recorder.reuse(m_frameBuffer.frameCount)) {
+      m_state.recordingReused = true;
+    } else {
+      // the slot's next frame may render to another image
+      VkCommandBufferInheritanceInfo inheritance{
+          .sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+          .pNext       = nullptr,
+          .renderPass  = m_renderPass,
+          .subpass     = 0,
+          .framebuffer = reuse ? VK_NULL_HANDLE
+                               : m_frameBuffer.framebuffers[swapchainImgIdx],
+      };
+      m_recorder.record(m_frameBuffer.frameCount, inheritance,
+                        (u32)frameDraws.draws.size(), recordThreads, reuse,
+                        [this](VkCommandBuffer cmd, u32 begin, u32 end) {
+                          recordDraws(cmd, begin, end);
+                        });
+      if (reuse)
+        recorded = frameDraws;
+    }
+    currentData.cmdBuffer.beginRenderPass(
+        &renderPassBI, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    m_recorder.execute(currentData.cmdBuffer.cmdBuffer);
+  } else {
+    currentData.cmdBuffer.beginRenderPass(&renderPassBI,
+                                          VK_SUBPASS_CONTENTS_INLINE);
+    recordDraws(currentData.cmdBuffer.cmdBuffer, 0,
+                (u32)frameDraws.draws.size());
+  }
+  m_state.recordMs = std::chrono::duration<float, std::milli>(
+                         std::chrono::steady_clock::now() - recordStart)
+                         .count();
+
+  if (m_options.recordBenchmarkFrames) {
+    RecordBenchmark& benchmark = m_recordBenchmark;
+    benchmark.totalMs += m_state.recordMs;
+    if (++benchmark.frames == m_options.recordBenchmarkFrames) {
+      LOG_INFO("recording {} draws on {} threads: {} ms per frame",
+               frameDraws.draws.size(), benchmark.threads,
+               benchmark.totalMs / benchmark.frames);
+      benchmark = {benchmark.threads % m_recorder.maxThreads() + 1};
+    }
+  }
 
-      .endRenderPass();
+  currentData.cmdBuffer.endRenderPass();
+
+  // what the early draws hid is skipped, the rest is drawn over them
+  if (occlusion) {
+    m_depthPyramid.record(currentData.cmdBuffer.cmdBuffer);
+    m_gpuCuller.recordLate(currentData.cmdBuffer.cmdBuffer);
+    renderPassBI.renderPass = m_lateRenderPass;
+    currentData.cmdBuffer.beginRenderPass(&renderPassBI,
+                                          VK_SUBPASS_CONTENTS_INLINE);
+    if (uniformOffset) {
+      bindDrawState(currentData.cmdBuffer.cmdBuffer);
+      m_gpuCuller.drawLate(currentData.cmdBuffer.cmdBuffer);
+    }
+    currentData.cmdBuffer.endRenderPass();
+  }
 
+  if (sceneLoaded && m_options.sceneCulling != SceneCulling::eCpu)
+    m_gpuCuller.copyCounts(currentData.cmdBuffer.cmdBuffer,
+                           m_frameBuffer.frameCount);
+  m_gpuTimer.end(currentData.cmdBuffer.cmdBuffer);
   currentData.cmdBuffer.end();
+  m_uniformRing.endFrame();
 
   VkPipelineStageFlags waitStage =
       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -215,6 +496,14 @@ void Renderer::render() {
 
   vkQueuePresentKHR(m_graphicQueue, &presentInfo);
   m_frameBuffer.frameCount++;
+
+  if (!m_firstPixelLogged && drawnIndexCount > 0) {
+    m_firstPixelLogged = true;
+    LOG_INFO("time to first pixel: {} ms",
+             std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - m_createTime)
+                 .count());
+  }
 }
 
 bool Renderer::windowShouldClose() {
@@ -263,7 +552,9 @@ void Renderer::createDepthImages() {
       .arrayLayers = 1,
       .samples     = m_sampleCount,
       .tiling      = VK_IMAGE_TILING_OPTIMAL,
-      .usage       = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+      // the depth pyramid samples it
+      .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+               VK_IMAGE_USAGE_SAMPLED_BIT,
   };
 
   VmaAllocationCreateInfo depthImageAllocInfo{
@@ -384,6 +675,57 @@ void Renderer::createRenderPass(bool includeDepth, bool clear) {
       vkCreateRenderPass(*m_application, &renderPassCI, nullptr, &m_renderPass);
   assert(result == VK_SUCCESS);
 
+  // the early pass of occlusion culling leaves the depth to compute shaders
+  attachments[1].storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+  attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+  VkSubpassDependency earlyDependencies[2] = {dependency, {}};
+  earlyDependencies[1].srcSubpass   = 0;
+  earlyDependencies[1].dstSubpass   = VK_SUBPASS_EXTERNAL;
+  earlyDependencies[1].srcStageMask =
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  earlyDependencies[1].srcAccessMask =
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  earlyDependencies[1].dstStageMask  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  earlyDependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  renderPassCI.dependencyCount = 2;
+  renderPassCI.pDependencies   = earlyDependencies;
+  result = vkCreateRenderPass(*m_application, &renderPassCI, nullptr,
+                              &m_earlyRenderPass);
+  assert(result == VK_SUCCESS);
+
+  // the late pass draws over the early one once the pyramid was read
+  attachments[0].loadOp        = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  attachments[1].loadOp        = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[1].storeOp       = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachments[1].initialLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDependency lateDependency{};
+  lateDependency.srcSubpass   = VK_SUBPASS_EXTERNAL;
+  lateDependency.dstSubpass   = 0;
+  lateDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  lateDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  lateDependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  lateDependency.dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  renderPassCI.dependencyCount = 1;
+  renderPassCI.pDependencies   = &lateDependency;
+  result = vkCreateRenderPass(*m_application, &renderPassCI, nullptr,
+                              &m_lateRenderPass);
+  assert(result == VK_SUCCESS);
+
   VkImageCreateInfo resolveImageCI{
       .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
       .pNext       = nullptr,
@@ -428,6 +770,8 @@ void Renderer::destroyRenderPass() {
   vkDestroyImageView(*m_application, m_resolveView, nullptr);
   m_application->m_allocator.destroyImage(m_resolveImage);
   vkDestroyRenderPass(*m_application, m_renderPass, nullptr);
+  vkDestroyRenderPass(*m_application, m_earlyRenderPass, nullptr);
+  vkDestroyRenderPass(*m_application, m_lateRenderPass, nullptr);
 }
 
 void Renderer::createFrameBuffer(bool includeDepth) {
@@ -463,6 +807,39 @@ void Renderer::createShaders() {
                   vertResult.value());
   m_shaders[mainVert.m_name] = std::move(mainVert);
 
+  auto packedVertResult = ezvk::readFromFile("shaders/packed.vert.spv", "rb");
+  assert(packedVertResult.has_value());
+
+  ezvk::Shader packedVert;
+  packedVert.create(*m_application, "packedVert", VK_SHADER_STAGE_VERTEX_BIT,
+                    packedVertResult.value());
+  m_shaders[packedVert.m_name] = std::move(packedVert);
+
+  auto cullResult = ezvk::readFromFile("shaders/cull.comp.spv", "rb");
+  assert(cullResult.has_value());
+
+  ezvk::Shader cullComp;
+  cullComp.create(*m_application, "cullComp", VK_SHADER_STAGE_COMPUTE_BIT,
+                  cullResult.value());
+  m_shaders[cullComp.m_name] = std::move(cullComp);
+
+  auto pyramidResult =
+      ezvk::readFromFile("shaders/depthpyramid.comp.spv", "rb");
+  assert(pyramidResult.has_value());
+
+  ezvk::Shader depthPyramidComp;
+  depthPyramidComp.create(*m_application, "depthPyramidComp",
+                          VK_SHADER_STAGE_COMPUTE_BIT, pyramidResult.value());
+  m_shaders[depthPyramidComp.m_name] = std::move(depthPyramidComp);
+
+  auto lightCullResult = ezvk::readFromFile("shaders/lightcull.comp.spv", "rb");
+  assert(lightCullResult.has_value());
+
+  ezvk::Shader lightCullComp;
+  lightCullComp.create(*m_application, "lightCullComp",
+                       VK_SHADER_STAGE_COMPUTE_BIT, lightCullResult.value());
+  m_shaders[lightCullComp.m_name] = std::move(lightCullComp);
+
   auto fragResult = ezvk::readFromFile("shaders/main.frag.spv", "rb");
   assert(fragResult.has_value());
 
@@ -493,53 +870,72 @@ void Renderer::createDefaultPipeline() {
   vkCreatePipelineLayout(m_application->getVkDevice(), &defaultPipelineLayoutCI,
                          nullptr, &m_defaultPipelineLayout);
 
-  m_defaultPipelineBuilder.reset(new ezvk::GraphicPipelineBuilder{});
   VkDynamicState dynamicState[] = {VK_DYNAMIC_STATE_VIEWPORT,
                                    VK_DYNAMIC_STATE_SCISSOR};
 
-  auto vertexDescription = data::Vertex::GetDescription();
-
-  auto [defaultPipeline, defaultPipelineCache] =
-      m_defaultPipelineBuilder
-          ->setShader({m_shaders["mainVert"].m_shaderInfo,
-                       m_shaders["mainFrag"].m_shaderInfo})
-          // .setVertexInput()
-          .setVertexAttributes(std::move(vertexDescription.attributes))
-          .setVertexBindings(std::move(vertexDescription.bindings))
-          .setInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE)
-          .setRasterization(VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL,
-                            VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE,
-                            VK_FALSE, 0, 0, 0, 1)
-          .setDynamic({})
-          .noColorBlend(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT)
-          .setViewPortAndScissor(
-              {{
-                  .x        = 0.f,
-                  .y        = 0.f,
-                  .width    = (float)m_window.m_width,
-                  .height   = (float)m_window.m_height,
-                  .minDepth = 0.f,
-                  .maxDepth = 1.f,
-              }},
-              {{
-                  .offset{0, 0},
-                  .extent = {m_window.m_width, m_window.m_height},
-              }})
-          .setDeepNoStencil(VK_TRUE, VK_COMPARE_OP_LESS, VK_FALSE, 0, 1)
-          .setMultisample(m_sampleCount, VK_FALSE, 1.f, nullptr, VK_FALSE,
-                          VK_FALSE)
-          .buildWithCache(*m_application, m_renderPass,
-                          m_defaultPipelineLayout);
+  // the pipelines only differ in their vertex layout and vertex shader
+  auto buildPipeline = [&](ezvk::GraphicPipelineBuilder& builder,
+                           data::VertexInputDescription  vertexDescription,
+                           const std::string&            vertexShader) {
+    return builder
+        .setShader({m_shaders[vertexShader].m_shaderInfo,
+                    m_shaders["mainFrag"].m_shaderInfo})
+        // .setVertexInput()
+        .setVertexAttributes(std::move(vertexDescription.attributes))
+        .setVertexBindings(std::move(vertexDescription.bindings))
+        .setInputAssembly(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE)
+        // obj faces are counter clockwise, the projection's y flip keeps
+        // them that way on screen
+        .setRasterization(VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL,
+                          m_options.backfaceCulling ? VK_CULL_MODE_BACK_BIT
+                                                    : VK_CULL_MODE_NONE,
+                          m_options.backfaceCulling
+                              ? VK_FRONT_FACE_COUNTER_CLOCKWISE
+                              : VK_FRONT_FACE_CLOCKWISE,
+                          VK_FALSE, 0, 0, 0, 1)
+        .setDynamic({})
+        .noColorBlend(VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT)
+        .setViewPortAndScissor(
+            {{
+                .x        = 0.f,
+                .y        = 0.f,
+                .width    = (float)m_window.m_width,
+                .height   = (float)m_window.m_height,
+                .minDepth = 0.f,
+                .maxDepth = 1.f,
+            }},
+            {{
+                .offset{0, 0},
+                .extent = {m_window.m_width, m_window.m_height},
+            }})
+        .setDeepNoStencil(VK_TRUE, VK_COMPARE_OP_LESS, VK_FALSE, 0, 1)
+        .setMultisample(m_sampleCount, VK_FALSE, 1.f, nullptr, VK_FALSE,
+                        VK_FALSE)
+        .buildWithCache(*m_application, m_renderPass, m_defaultPipelineLayout);
+  };
 
+  m_defaultPipelineBuilder.reset(new ezvk::GraphicPipelineBuilder{});
+  auto [defaultPipeline, defaultPipelineCache] = buildPipeline(
+      *m_defaultPipelineBuilder, data::Vertex::GetDescription(), "mainVert");
   m_defaultPipeline      = defaultPipeline;
   m_defaultPipelineCache = defaultPipelineCache;
+
+  m_packedPipelineBuilder.reset(new ezvk::GraphicPipelineBuilder{});
+  auto [packedPipeline, packedPipelineCache] =
+      buildPipeline(*m_packedPipelineBuilder,
+                    data::GetVertexDescription<data::PackedVertex>(),
+                    "packedVert");
+  m_packedPipeline      = packedPipeline;
+  m_packedPipelineCache = packedPipelineCache;
 }
 
 void Renderer::destroyDefaultPipeline() {
   vkDestroyPipelineLayout(*m_application, m_defaultPipelineLayout, nullptr);
   vkDestroyPipelineCache(*m_application, m_defaultPipelineCache, nullptr);
   vkDestroyPipeline(*m_application, m_defaultPipeline, nullptr);
+  vkDestroyPipelineCache(*m_application, m_packedPipelineCache, nullptr);
+  vkDestroyPipeline(*m_application, m_packedPipeline, nullptr);
 }
 
 void Renderer::getGraphicQueueAndQueueIndex() {
@@ -549,25 +945,551 @@ void Renderer::getGraphicQueueAndQueueIndex() {
   m_graphicQueue = device.get_queue(vkb::QueueType::graphics).value();
 }
 
-void Renderer::createMesh() {
+void Renderer::createMesh(data::UploadBatch& upload) {
   ezvk::BufferAllocator& allocator = m_application->m_allocator;
-  m_testModel = data::ObjModel("assets/space_shuttle/space-shuttle.obj");
-  m_testModelVertexBuf = m_testModel.allocateVertices(allocator);
-  m_testModelIndexBuf  = m_testModel.allocateIndices(allocator);
+
+  m_geometry.create(allocator, m_options.vertexBufferSize,
+                    m_options.indexBufferSize);
+  loadMesh(upload);
+
+  // the scene's instances stay when the mesh is evicted, a reload brings
+  // back the same ones
+  std::vector<data::InstanceData> instances{
+      data::InstanceData::Create(glm::mat4{1.f}, 0)};
+  for (const auto& instance : m_scene.instances) {
+    instances.push_back(data::InstanceData::Create(
+        instance.transform, m_scene.meshes[instance.mesh].materialIndex));
+  }
+  m_instanceBuffer = upload.uploadBuffer(
+      instances.data(), instances.size() * sizeof(data::InstanceData),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+  // one draw per distinct mesh, the culler counts in its instances
+  std::vector<VkDrawIndexedIndirectCommand> draws;
+  m_sceneInstancedIndexCount = 0;
+  for (const auto& mesh : m_scene.meshes) {
+    draws.push_back({
+        .indexCount    = mesh.indexCount,
+        .instanceCount = 0,
+        .firstIndex    = mesh.firstIndex,
+        .vertexOffset  = mesh.vertexOffset,
+        .firstInstance = kFirstSceneInstance + mesh.firstInstance,
+    });
+    m_sceneInstancedIndexCount += mesh.indexCount * mesh.instanceCount;
+  }
+  std::vector<data::GpuCuller::Object> objects;
+  for (u32 i = 0; i < m_scene.instances.size(); ++i) {
+    const auto& instance = m_scene.instances[i];
+    objects.push_back({
+        .boundsMin = instance.boundsMin,
+        .draw      = instance.mesh,
+        .boundsMax = instance.boundsMax,
+        .instance  = kFirstSceneInstance + i,
+    });
+  }
+  m_gpuCuller.setScene(upload, objects, draws, (u32)instances.size());
+
+  if (m_options.sceneCulling == SceneCulling::eCpu) {
+    auto                   buildStart = std::chrono::steady_clock::now();
+    std::vector<glm::vec3> boundsMin, boundsMax;
+    for (const auto& instance : m_scene.instances) {
+      boundsMin.push_back(instance.boundsMin);
+      boundsMax.push_back(instance.boundsMax);
+    }
+    m_sceneBvh.build(boundsMin, boundsMax);
+    LOG_INFO("built a bvh of {} nodes over {} instances in {} ms",
+             m_sceneBvh.nodeCount(), m_scene.instances.size(),
+             std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - buildStart)
+                 .count());
+
+    VkDeviceSize visibleSize =
+        instances.size() * sizeof(u32) * m_swapchainObj->getImageCount();
+    VkBufferCreateInfo visibleCI{
+        .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext       = nullptr,
+        .flags       = 0,
+        .size        = visibleSize,
+        .usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    VmaAllocationCreateInfo visibleAI{.usage = VMA_MEMORY_USAGE_CPU_TO_GPU};
+    m_cpuVisibleBuffer = allocator.createBuffer(&visibleCI, &visibleAI);
+    void* mapped;
+    vmaMapMemory(allocator, m_cpuVisibleBuffer.allocation, &mapped);
+    m_cpuVisible = (u32*)mapped;
+    // entry 0 is what draws with firstInstance 0 read
+    std::fill_n(m_cpuVisible, visibleSize / sizeof(u32), 0);
+    vmaFlushAllocation(allocator, m_cpuVisibleBuffer.allocation, 0,
+                       VK_WHOLE_SIZE);
+  }
+
+  for (u32 i = 0; i < m_uniformSets.size(); ++i)
+    writeInstanceDescriptor(i);
 
   g_axisVertexBuf = allocator.createBuffer(
       g_axis, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
   g_axisIndexBuf =
       allocator.createBuffer(g_axisIndices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                              VMA_MEMORY_USAGE_CPU_TO_GPU);
-  LOG_INFO("{} {}", m_testModel.indices.size(), m_testModel.vertices.size());
+}
+
+void Renderer::loadMesh(data::UploadBatch& upload) {
+  if (!streamMesh())
+    uploadMesh(upload, ParseMesh(m_options.modelPath));
+}
+
+bool Renderer::streamMesh() {
+  ccstr modelPath = m_options.modelPath.c_str();
+  if (!std::filesystem::path(modelPath).extension().string().ends_with(
+          ".obj") ||
+      !m_options.streamingLoad || data::MeshCache::IsCurrent(modelPath))
+    return false;
+
+  // grown by every chunk, the mesh is tracked once the last one is in
+  m_modelBoundsMin = glm::vec3{std::numeric_limits<float>::max()};
+  m_modelBoundsMax = glm::vec3{std::numeric_limits<float>::lowest()};
+  m_streamLoader.start(modelPath);
+  return true;
+}
+
+ParsedMesh Renderer::ParseMesh(const std::string& modelPath) {
+  ParsedMesh ret;
+  if (!std::filesystem::path(modelPath).extension().string().ends_with(
+          ".obj")) {
+    ret.scene = data::Model(modelPath.c_str());
+    return ret;
+  }
+
+  ret.model = data::ObjModel(modelPath.c_str());
+  LOG_INFO("{} {}", ret.model.indexData().size(),
+           ret.model.vertexData().size());
+  ret.meshlets = data::MeshletBuilder::Build(ret.model.vertexData(),
+                                             ret.model.indexData());
+  ret.indices  = data::CompactIndices::Build(
+      ret.model.indexData(), ret.model.vertexData().size(), ret.meshlets);
+  return ret;
+}
+
+void Renderer::uploadMesh(data::UploadBatch& upload, ParsedMesh&& mesh) {
+  if (!mesh.scene.empty()) {
+    m_scene = std::move(mesh.scene);
+    m_sceneVertexRange =
+        m_scene.allocateVerticesUsingStaging(m_geometry, upload);
+    m_sceneIndexRange = m_scene.allocateIndicesUsingStaging(m_geometry, upload);
+    m_modelBoundsMin  = m_scene.boundsMin;
+    m_modelBoundsMax  = m_scene.boundsMax;
+    if (!m_options.keepCpuGeometry)
+      m_scene.releaseGeometry();
+    trackMesh();
+    return;
+  }
+  if (mesh.model.vertexData().empty())
+    return;
+
+  m_testModel         = std::move(mesh.model);
+  m_testModelMeshlets = std::move(mesh.meshlets);
+  m_testModelIndices  = std::move(mesh.indices);
+
+  const auto& remap = m_testModelIndices.vertexRemap;
+  size_t      uploadedVertexCount =
+      remap.empty() ? m_testModel.vertexData().size() : remap.size();
+  if (m_options.vertexFormat == data::VertexFormat::ePacked) {
+    m_testModelQuantization = m_testModel.quantization();
+    m_testModelVertexRange  = m_testModel.allocatePackedVerticesUsingStaging(
+        m_geometry, upload, remap);
+  } else {
+    m_testModelVertexRange =
+        m_testModel.allocateVerticesUsingStaging(m_geometry, upload, remap);
+  }
+
+  if (!m_testModel.lodIndexData().empty()) {
+    std::vector<u32> lodIndices = data::RemapIndices(
+        m_testModel.lodIndexData(), remap, m_testModel.vertexData().size());
+    if (uploadedVertexCount <= (1 << 16)) {
+      std::vector<u16> lodIndices16(lodIndices.begin(), lodIndices.end());
+      m_testModelLodIndexType  = VK_INDEX_TYPE_UINT16;
+      m_testModelLodIndexRange = m_geometry.addIndices(
+          upload, lodIndices16.data(), lodIndices16.size() * sizeof(u16),
+          VK_INDEX_TYPE_UINT16);
+    } else {
+      m_testModelLodIndexType  = VK_INDEX_TYPE_UINT32;
+      m_testModelLodIndexRange = m_geometry.addIndices(
+          upload, lodIndices.data(), lodIndices.size() * sizeof(u32),
+          VK_INDEX_TYPE_UINT32);
+    }
+  }
+  m_testModelIndices.vertexRemap = {};
+
+  if (m_testModelIndices.type == VK_INDEX_TYPE_UINT16) {
+    auto& indices16       = m_testModelIndices.indices16;
+    m_testModelIndexRange = m_geometry.addIndices(
+        upload, indices16.data(), indices16.size() * sizeof(u16),
+        VK_INDEX_TYPE_UINT16);
+    indices16 = {};
+  } else {
+    m_testModelIndexRange =
+        m_testModel.allocateIndicesUsingStaging(m_geometry, upload);
+  }
+  LOG_INFO("build {} meshlets, {} bit indices in {} chunks, {} lod levels",
+           m_testModelMeshlets.size(), m_testModelIndices.indexSize() * 8,
+           m_testModelIndices.chunks.size(), m_testModel.lodLevels().size());
+
+  m_modelBoundsMin = m_testModel.boundsMin;
+  m_modelBoundsMax = m_testModel.boundsMax;
+  if (!m_options.keepCpuGeometry)
+    m_testModel.releaseGeometry();
+  trackMesh();
+}
+
+void Renderer::unloadMesh() {
+  m_residency.untrack(m_meshAsset);
+  m_meshAsset = data::ResidencyManager::kInvalid;
+
+  for (u32* range : {&m_sceneVertexRange, &m_sceneIndexRange,
+                     &m_testModelVertexRange, &m_testModelIndexRange,
+                     &m_testModelLodIndexRange}) {
+    m_geometry.remove(*range);
+    *range = data::GeometryBuffer::kInvalid;
+  }
+  for (const auto& mesh : m_streamedMeshes) {
+    m_geometry.remove(mesh.vertexRange);
+    m_geometry.remove(mesh.indexRange);
+  }
+  m_streamedMeshes.clear();
+  m_scene     = {};
+  m_testModel = {};
+  m_lodSelector.reset();
+  m_testModelMeshlets.clear();
+  m_testModelIndices = {};
+
+  // give the freed space back to the device
+  data::UploadBatch& upload = m_meshUploads.emplace_back();
+  upload.begin(m_application->m_allocator, *m_application, m_transientCmdPool,
+               m_graphicQueue, m_stagingRing);
+  m_geometry.trim(upload);
+  upload.submit();
+}
+
+void Renderer::trackMesh() {
+  VkDeviceSize bytes = 0;
+  for (u32 range : {m_sceneVertexRange, m_sceneIndexRange,
+                    m_testModelVertexRange, m_testModelIndexRange,
+                    m_testModelLodIndexRange}) {
+    if (range != data::GeometryBuffer::kInvalid)
+      bytes += m_geometry.size(range);
+  }
+  for (const auto& mesh : m_streamedMeshes)
+    bytes += m_geometry.size(mesh.vertexRange) +
+             m_geometry.size(mesh.indexRange);
+
+  m_meshAsset = m_residency.track(m_options.modelPath, bytes, [this] {
+    m_meshAsset = data::ResidencyManager::kInvalid;
+    unloadMesh();
+    m_meshEvicted = true;
+  });
+  // the bounds of a streamed model are only known now
+  placeLights();
+}
+
+void Renderer::updateResidency(const glm::mat4& viewProj) {
+  auto frustum = data::Frustum::FromMatrix(viewProj);
+  if (frustum.intersectsBox(m_modelBoundsMin, m_modelBoundsMax)) {
+    if (m_meshEvicted && !m_meshReload.valid()) {
+      if (streamMesh())
+        m_meshEvicted = false;
+      else if (ThreadPool::GetGlobal().size() > 0)
+        m_meshReload = ThreadPool::GetGlobal().submit(
+            [modelPath = m_options.modelPath] { return ParseMesh(modelPath); });
+      // a pool without workers runs what is submitted right away
+      else
+        m_meshReload = std::async(std::launch::async,
+                                  [modelPath = m_options.modelPath] {
+                                    return ParseMesh(modelPath);
+                                  });
+    }
+    if (m_textureEvicted) {
+      m_textureStreamer.reload(m_testTexture);
+      m_textureEvicted = false;
+    }
+    m_residency.touch(m_meshAsset);
+    m_residency.touch(m_textureAsset);
+  }
+  if (m_meshReload.valid() &&
+      m_meshReload.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+    data::UploadBatch& upload = m_meshUploads.emplace_back();
+    upload.begin(m_application->m_allocator, *m_application,
+                 m_transientCmdPool, m_graphicQueue, m_stagingRing);
+    uploadMesh(upload, m_meshReload.get());
+    upload.submit();
+    m_meshEvicted = false;
+  }
+
+  // a texture counts once its image exists, it may still be streaming in
+  VkDeviceSize textureBytes = m_textureStreamer.memorySize(m_testTexture);
+  if (m_textureAsset == data::ResidencyManager::kInvalid && textureBytes) {
+    m_textureAsset = m_residency.track(
+        "texture " + std::to_string(m_testTexture), textureBytes, [this] {
+          m_textureAsset = data::ResidencyManager::kInvalid;
+          m_textureStreamer.evict(m_testTexture);
+          m_textureEvicted = true;
+        });
+  }
+
+  m_residency.update();
+}
+
+void Renderer::uploadStreamedMeshes() {
+  // spread the uploads over frames so the window stays responsive
+  constexpr u32 kMaxChunksPerFrame = 2;
+
+  std::erase_if(m_meshUploads, [](data::UploadBatch& upload) {
+    if (!upload.finished())
+      return false;
+    upload.release();
+    return true;
+  });
+
+  data::ObjStreamChunk chunk;
+  data::UploadBatch*   upload = nullptr;
+  for (u32 i = 0; i < kMaxChunksPerFrame && m_streamLoader.poll(chunk); ++i) {
+    if (!upload) {
+      upload = &m_meshUploads.emplace_back();
+      upload->begin(m_application->m_allocator, *m_application,
+                    m_transientCmdPool, m_graphicQueue, m_stagingRing);
+    }
+    StreamedMesh mesh;
+    mesh.vertexRange = m_geometry.addVertices(
+        *upload, chunk.vertices.data(),
+        chunk.vertices.size() * sizeof(data::Vertex), sizeof(data::Vertex));
+    mesh.indexRange = m_geometry.addIndices(
+        *upload, chunk.indices.data(), chunk.indices.size() * sizeof(u32),
+        VK_INDEX_TYPE_UINT32);
+    mesh.indexCount = (u32)chunk.indices.size();
+    m_streamedMeshes.push_back(mesh);
+    for (const auto& vertex : chunk.vertices) {
+      m_modelBoundsMin = glm::min(m_modelBoundsMin, vertex.pos);
+      m_modelBoundsMax = glm::max(m_modelBoundsMax, vertex.pos);
+    }
+  }
+  if (upload)
+    upload->submit();
+
+  if (m_streamLoader.isActive() && m_streamLoader.isFinished()) {
+    m_streamLoader.stop();
+    LOG_INFO("streamed {} in {} chunks", m_options.modelPath,
+             m_streamedMeshes.size());
+    trackMesh();
+  }
+}
+
+u32 Renderer::cullSceneOnCpu(const data::Frustum& frustum, u32 firstIndex,
+                             i32 vertexOffset) {
+  auto cullStart = std::chrono::steady_clock::now();
+  m_visibleObjects.clear();
+  m_sceneBvh.cull(frustum, m_visibleObjects);
+
+  // instances are grouped by mesh, counting the visible ones of each mesh
+  // gives every mesh one run of the list and one draw
+  const auto& meshes    = m_scene.meshes;
+  const auto& instances = m_scene.instances;
+  m_meshVisibleEnds.assign(meshes.size() + 1, 0);
+  for (u32 object : m_visibleObjects)
+    ++m_meshVisibleEnds[instances[object].mesh + 1];
+  for (u32 i = 1; i <= meshes.size(); ++i)
+    m_meshVisibleEnds[i] += m_meshVisibleEnds[i - 1];
+  // the fence of this frame covers the one that last wrote the slice
+  u32 slice = (u32)(m_frameBuffer.frameCount % m_swapchainObj->getImageCount());
+  u32 base  = slice * (kFirstSceneInstance + (u32)instances.size()) +
+             kFirstSceneInstance;
+  for (u32 object : m_visibleObjects) {
+    u32& run                   = m_meshVisibleEnds[instances[object].mesh];
+    m_cpuVisible[base + run++] = kFirstSceneInstance + object;
+  }
+  vmaFlushAllocation(m_application->m_allocator,
+                     m_cpuVisibleBuffer.allocation, base * sizeof(u32),
+                     m_visibleObjects.size() * sizeof(u32));
+  m_state.cullMs = std::chrono::duration<float, std::milli>(
+                       std::chrono::steady_clock::now() - cullStart)
+                       .count();
+  m_state.visibleObjects = (u32)m_visibleObjects.size();
+
+  u32 drawnIndexCount = 0;
+  u32 runBegin        = 0;
+  m_state.sceneDraws  = 0;
+  for (u32 i = 0; i < meshes.size(); ++i) {
+    u32 runEnd = m_meshVisibleEnds[i];
+    if (runEnd > runBegin) {
+      m_frameDraws.draws.push_back({meshes[i].indexCount, runEnd - runBegin,
+                                    firstIndex + meshes[i].firstIndex,
+                                    vertexOffset + meshes[i].vertexOffset,
+                                    base + runBegin});
+      drawnIndexCount += meshes[i].indexCount * (runEnd - runBegin);
+      ++m_state.sceneDraws;
+    }
+    runBegin = runEnd;
+  }
+  return drawnIndexCount;
+}
+
+void Renderer::bindDrawState(VkCommandBuffer cmd) const {
+  const FrameDraws& frameDraws = m_frameDraws;
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, frameDraws.pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          m_defaultPipelineLayout, 0, 1,
+                          &frameDraws.descriptorSet, 1,
+                          &frameDraws.uniformOffset);
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(cmd, 0, 1, &frameDraws.vertexBuffer, &offset);
+  vkCmdBindIndexBuffer(cmd, frameDraws.indexBuffer, 0, frameDraws.indexType);
+}
+
+void Renderer::recordDraws(VkCommandBuffer cmd, u32 begin, u32 end) const {
+  const FrameDraws& frameDraws = m_frameDraws;
+  bindDrawState(cmd);
+  for (u32 i = begin; i < end; ++i) {
+    const VkDrawIndexedIndirectCommand& draw = frameDraws.draws[i];
+    vkCmdDrawIndexed(cmd, draw.indexCount, draw.instanceCount, draw.firstIndex,
+                     draw.vertexOffset, draw.firstInstance);
+  }
+  if (frameDraws.gpuCulled && end == frameDraws.draws.size())
+    m_gpuCuller.draw(cmd);
+}
+
+void Renderer::readFrameStats(u64 frame) {
+  bool sceneLoaded = m_sceneIndexRange != data::GeometryBuffer::kInvalid;
+  if (sceneLoaded && m_options.sceneCulling != SceneCulling::eCpu) {
+    if (auto counts = m_gpuCuller.counts(frame)) {
+      m_state.visibleObjects       = counts->drawnEarly + counts->drawnLate;
+      m_state.frustumCulledObjects = counts->frustumCulled;
+      m_state.occludedObjects      = counts->occluded;
+    }
+  }
+  if (auto dropped = m_lightClusters.droppedLights(frame))
+    m_state.droppedLights = *dropped;
+  auto gpuMs = m_gpuTimer.ms(frame);
+  if (gpuMs)
+    m_state.gpuMs = (float)*gpuMs;
+
+  // the frame read is the one a slot count before this one
+  u64 slotCount = m_recordedDraws.size();
+  if (!gpuMs || frame < slotCount)
+    return;
+  u64 measured = frame - slotCount;
+
+  u32 benchmarkFrames = m_options.occlusionBenchmarkFrames;
+  if (benchmarkFrames) {
+    u32                 phase     = (u32)(measured / benchmarkFrames % 2);
+    OcclusionBenchmark& benchmark = m_occlusionBenchmark;
+    benchmark.frames[phase]++;
+    benchmark.totalMs[phase] += *gpuMs;
+    if (phase == 1)
+      benchmark.occluded += m_state.occludedObjects;
+    if ((measured + 1) % (2 * benchmarkFrames) == 0 && benchmark.frames[0] &&
+        benchmark.frames[1]) {
+      double offMs = benchmark.totalMs[0] / benchmark.frames[0];
+      double onMs  = benchmark.totalMs[1] / benchmark.frames[1];
+      LOG_INFO("occlusion culling: {} ms per frame off, {} ms on, {} ms "
+               "saved, {} instances occluded",
+               offMs, onMs, offMs - onMs,
+               benchmark.occluded / benchmark.frames[1]);
+      benchmark = {};
+    }
+  }
+
+  u32 lightFrames = m_options.lightBenchmarkFrames;
+  if (lightFrames) {
+    LightBenchmark& benchmark = m_lightBenchmark;
+    benchmark.frames++;
+    benchmark.totalMs += *gpuMs;
+    if ((measured + 1) % lightFrames == 0) {
+      LOG_INFO("{} lights in {} clusters: {} ms per frame, {} dropped",
+               std::min(lightCount(measured), m_lightClusters.lightCount()),
+               data::LightClusters::kClusterCount,
+               benchmark.totalMs / benchmark.frames, m_state.droppedLights);
+      benchmark = {};
+    }
+  }
+}
+
+void Renderer::placeLights() {
+  // the same lights every run, so that runs compare
+  std::mt19937                          random{7};
+  std::uniform_real_distribution<float> unit{0.f, 1.f};
+
+  glm::vec3 boundsMin = m_modelBoundsMin;
+  glm::vec3 boundsMax = m_modelBoundsMax;
+  // a model still streaming has no bounds yet
+  if (glm::any(glm::greaterThan(boundsMin, boundsMax))) {
+    boundsMin = glm::vec3{-10.f};
+    boundsMax = glm::vec3{10.f};
+  }
+  if (m_lightClusters.lightCount() > 0 && boundsMin == m_lightBoundsMin &&
+      boundsMax == m_lightBoundsMax)
+    return;
+  m_lightBoundsMin = boundsMin;
+  m_lightBoundsMax = boundsMax;
+  float radius     = glm::length(boundsMax - boundsMin) * .05f;
+
+  std::vector<data::Light> lights(m_lightClusters.maxLights());
+  lights[0] = g_light;
+  for (u32 i = 1; i < lights.size(); ++i) {
+    glm::vec3 at{unit(random), unit(random), unit(random)};
+    lights[i] = {
+        glm::mix(boundsMin, boundsMax, at),
+        radius,
+        {unit(random), unit(random), unit(random)},
+    };
+  }
+  m_lightClusters.setLights(lights);
+}
+
+u32 Renderer::lightCount(u64 frame) const {
+  u32 lightFrames = m_options.lightBenchmarkFrames;
+  if (!lightFrames)
+    return m_options.lightCount;
+  return kLightBenchmarkCounts[frame / lightFrames %
+                               std::size(kLightBenchmarkCounts)];
+}
+
+void Renderer::invalidateRecordings() {
+  m_recorder.invalidate();
 }
 
 void Renderer::destroyMesh() {
   ezvk::BufferAllocator& allocator = m_application->m_allocator;
-  allocator.destroyBuffer(m_testModelVertexBuf);
-  allocator.destroyBuffer(m_testModelIndexBuf);
-
+  m_streamLoader.stop();
+  if (m_meshReload.valid())
+    m_meshReload.get();
+  for (auto& upload : m_meshUploads)
+    upload.release();
+  m_meshUploads.clear();
+  m_streamedMeshes.clear();
+  m_scene = {};
+
+  m_residency.untrack(m_meshAsset);
+  m_meshAsset = data::ResidencyManager::kInvalid;
+
+  // every range goes with the buffers
+  m_geometry.destroy();
+  m_sceneVertexRange       = data::GeometryBuffer::kInvalid;
+  m_sceneIndexRange        = data::GeometryBuffer::kInvalid;
+  m_testModelVertexRange   = data::GeometryBuffer::kInvalid;
+  m_testModelIndexRange    = data::GeometryBuffer::kInvalid;
+  m_testModelLodIndexRange = data::GeometryBuffer::kInvalid;
+  m_lodSelector.reset();
+  m_testModelMeshlets.clear();
+  m_testModelIndices = {};
+
+  allocator.destroyBuffer(m_instanceBuffer);
+  if (m_cpuVisible) {
+    vmaUnmapMemory(allocator, m_cpuVisibleBuffer.allocation);
+    allocator.destroyBuffer(m_cpuVisibleBuffer);
+    m_cpuVisible = nullptr;
+  }
+  m_sceneBvh.clear();
+  invalidateRecordings();
   allocator.destroyBuffer(g_axisIndexBuf);
   allocator.destroyBuffer(g_axisVertexBuf);
 }
@@ -577,10 +1499,13 @@ void Renderer::createDescriptorSets() {
 
   ezvk::DescriptorPoolSizeList sizeList;
   sizeList
-      .add(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_swapchainObj->getImageCount())
+      .add(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+           m_swapchainObj->getImageCount())
       .add(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
            m_swapchainObj->getImageCount())
-      .add(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_swapchainObj->getImageCount());
+      .add(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_swapchainObj->getImageCount())
+      .add(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+           4 * m_swapchainObj->getImageCount());
 
   m_descPool.create(*m_application,
                     VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
@@ -588,10 +1513,17 @@ void Renderer::createDescriptorSets() {
 
   ezvk::DescriptorSetLayoutBindingList bindingList;
   bindingList
-      .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT)
+      .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
+           VK_SHADER_STAGE_VERTEX_BIT)
       .add(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
            VK_SHADER_STAGE_FRAGMENT_BIT)
-      .add(2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+      .add(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+           VK_SHADER_STAGE_FRAGMENT_BIT)
+      .add(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT)
+      .add(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT)
+      .add(5, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+           VK_SHADER_STAGE_FRAGMENT_BIT)
+      .add(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
            VK_SHADER_STAGE_FRAGMENT_BIT);
 
   m_uniformLayout.create(*m_application, bindingList.bindings);
@@ -599,45 +1531,38 @@ void Renderer::createDescriptorSets() {
                                                 m_uniformLayout.setLayout);
   m_uniformSets = m_descPool.allocSets(*m_application, mvpLayouts);
 
-  VkBufferCreateInfo uniformBufferCI{
-      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-      .pNext       = nullptr,
-      .flags       = 0,
-      .size        = sizeof(g_uniformData),
-      .usage       = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-  };
-  VmaAllocationCreateInfo uniformBufferAI{.usage = VMA_MEMORY_USAGE_CPU_TO_GPU};
-  m_uniformBuffer = allocator.createBuffer(&uniformBufferCI, &uniformBufferAI);
-
-  VkBufferCreateInfo lightCI{
-      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-      .pNext       = nullptr,
-      .flags       = 0,
-      .size        = sizeof(g_light),
-      .usage       = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-  };
-  VmaAllocationCreateInfo lightAI{.usage = VMA_MEMORY_USAGE_CPU_TO_GPU};
-  m_lightBuffer = allocator.createBuffer(&lightCI, &lightAI);
-  m_lightBuffer.transferMemory(allocator, (void*)&g_light, lightCI.size);
-
-  VkDescriptorBufferInfo lightBufferInfo{
-      .buffer = m_lightBuffer.buffer,
-      .offset = 0,
-      .range  = VK_WHOLE_SIZE,
+  // the frame buffer keeps at most one frame in flight per swapchain image
+  m_uniformRing.create(allocator, *m_application, m_options.uniformFrameSize,
+                       m_swapchainObj->getImageCount());
+
+  // the lights, the view they are binned for and the clusters' lists
+  VkDescriptorBufferInfo lightBufferInfos[3]{
+      {
+          .buffer = m_lightClusters.lightBuffer(),
+          .offset = 0,
+          .range  = VK_WHOLE_SIZE,
+      },
+      {
+          .buffer = m_lightClusters.viewBuffer(),
+          .offset = 0,
+          .range  = VK_WHOLE_SIZE,
+      },
+      {
+          .buffer = m_lightClusters.clusterBuffer(),
+          .offset = 0,
+          .range  = VK_WHOLE_SIZE,
+      },
   };
+  u32              lightBindings[3] = {2, 5, 6};
+  VkDescriptorType lightTypes[3]    = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
 
+  // one block, the dynamic offset picks which
   VkDescriptorBufferInfo uniformBufferInfo{
-      .buffer = m_uniformBuffer.buffer,
+      .buffer = m_uniformRing.buffer(),
       .offset = 0,
-      .range  = VK_WHOLE_SIZE,
-  };
-
-  VkDescriptorImageInfo imageInfo{
-      .sampler     = m_testTextureSampler.sampler,
-      .imageView   = m_testTextureImageView.imageView,
-      .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      .range  = sizeof(UniformBufferObject),
   };
 
   for (u32 i = 0; i < m_uniformSets.size(); ++i) {
@@ -648,39 +1573,83 @@ void Renderer::createDescriptorSets() {
         .dstBinding      = bindingList.bindings[0].binding,
         .dstArrayElement = 0,
         .descriptorCount = 1,
-        .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
         .pBufferInfo     = &uniformBufferInfo,
     };
 
     vkUpdateDescriptorSets(*m_application, 1, &writeSet, 0, nullptr);
-    VkWriteDescriptorSet samplerWriteSet{
-        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .pNext           = nullptr,
-        .dstSet          = m_uniformSets[i],
-        .dstBinding      = bindingList.bindings[1].binding,
-        .dstArrayElement = 0,
-        .descriptorCount = 1,
-        .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .pImageInfo      = &imageInfo,
-    };
-    vkUpdateDescriptorSets(*m_application, 1, &samplerWriteSet, 0, nullptr);
-    VkWriteDescriptorSet lightWriteSet{
-        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .pNext           = nullptr,
-        .dstSet          = m_uniformSets[i],
-        .dstBinding      = bindingList.bindings[2].binding,
-        .dstArrayElement = 0,
-        .descriptorCount = 1,
-        .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .pBufferInfo     = &lightBufferInfo,
-    };
-    vkUpdateDescriptorSets(*m_application, 1, &lightWriteSet, 0, nullptr);
+    writeTextureDescriptor(i);
+    VkWriteDescriptorSet lightWriteSets[3];
+    for (u32 j = 0; j < 3; ++j) {
+      lightWriteSets[j] = {
+          .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .pNext           = nullptr,
+          .dstSet          = m_uniformSets[i],
+          .dstBinding      = lightBindings[j],
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType  = lightTypes[j],
+          .pBufferInfo     = &lightBufferInfos[j],
+      };
+    }
+    vkUpdateDescriptorSets(*m_application, 3, lightWriteSets, 0, nullptr);
   }
+  m_staleTextureSets.assign(m_uniformSets.size(), 0);
+}
+
+void Renderer::writeInstanceDescriptor(u32 set) {
+  invalidateRecordings();
+  // the instances and the culler's list of the visible ones
+  VkDescriptorBufferInfo instanceBufferInfos[2]{
+      {
+          .buffer = m_instanceBuffer.buffer,
+          .offset = 0,
+          .range  = VK_WHOLE_SIZE,
+      },
+      {
+          .buffer = m_options.sceneCulling == SceneCulling::eCpu
+                        ? m_cpuVisibleBuffer.buffer
+                        : m_gpuCuller.visibleBuffer(),
+          .offset = 0,
+          .range  = VK_WHOLE_SIZE,
+      },
+  };
+  VkWriteDescriptorSet instanceWriteSet{
+      .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .pNext           = nullptr,
+      .dstSet          = m_uniformSets[set],
+      .dstBinding      = 3,
+      .dstArrayElement = 0,
+      .descriptorCount = 2,
+      .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      .pBufferInfo     = instanceBufferInfos,
+  };
+  vkUpdateDescriptorSets(*m_application, 1, &instanceWriteSet, 0, nullptr);
+}
+
+void Renderer::writeTextureDescriptor(u32 set) {
+  // recordings that bound the set are invalid once it is updated
+  invalidateRecordings();
+  VkDescriptorImageInfo imageInfo{
+      .sampler     = m_testTextureSampler.sampler,
+      .imageView   = m_textureStreamer.view(m_testTexture),
+      .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+  };
+  VkWriteDescriptorSet samplerWriteSet{
+      .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .pNext           = nullptr,
+      .dstSet          = m_uniformSets[set],
+      .dstBinding      = 1,
+      .dstArrayElement = 0,
+      .descriptorCount = 1,
+      .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .pImageInfo      = &imageInfo,
+  };
+  vkUpdateDescriptorSets(*m_application, 1, &samplerWriteSet, 0, nullptr);
 }
 
 void Renderer::destroyDescriptorSets() {
-  m_application->m_allocator.destroyBuffer(m_uniformBuffer);
-  m_application->m_allocator.destroyBuffer(m_lightBuffer);
+  m_uniformRing.destroy();
 
   m_uniformLayout.destroy(*m_application);
   m_descPool.freeSets(*m_application, m_uniformSets);
@@ -688,29 +1657,26 @@ void Renderer::destroyDescriptorSets() {
 }
 
 void Renderer::createTextures() {
-  m_testTexture.create(m_application->m_allocator, m_transientCmdPool,
-                       "assets/space_shuttle/ShuttleDiffuseMap.jpg",
-                       m_graphicQueue, *m_application);
-
-  m_testTextureImageView.create(
-      *m_application, m_testTexture.image.image, VK_IMAGE_VIEW_TYPE_2D,
-      VK_FORMAT_R8G8B8A8_SRGB, {},
-      ezvk::defaultImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT));
+  m_textureStreamer.create(m_application->m_allocator, *m_application,
+                           *m_application, m_transientCmdPool,
+                           m_graphicQueue, m_stagingRing);
+  m_testTexture = m_textureStreamer.request(
+      "assets/space_shuttle/ShuttleDiffuseMap.jpg", !m_options.streamTextures);
 
   auto maxAnisotropy =
       m_application->m_deviceObj->m_gpu.properties.limits.maxSamplerAnisotropy;
 
+  // views of a streaming texture grow by levels, the sampler does not clamp
   m_testTextureSampler.create(
       *m_application, VK_FILTER_LINEAR, VK_FILTER_LINEAR,
       VK_SAMPLER_MIPMAP_MODE_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT,
       VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT, 0.f,
-      VK_FALSE, maxAnisotropy, VK_FALSE, VK_COMPARE_OP_ALWAYS, 0.f, 0.f,
-      VK_BORDER_COLOR_INT_OPAQUE_BLACK, VK_FALSE);
+      VK_TRUE, maxAnisotropy, VK_FALSE, VK_COMPARE_OP_ALWAYS, 0.f,
+      VK_LOD_CLAMP_NONE, VK_BORDER_COLOR_INT_OPAQUE_BLACK, VK_FALSE);
 }
 
 void Renderer::destroyTextures() {
   m_testTextureSampler.destroy(*m_application);
-  m_testTextureImageView.destroy(*m_application);
-  m_testTexture.destroy(m_application->m_allocator);
+  m_textureStreamer.destroy();
 }
 } // namespace myvk
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "DataType/Bvh.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MYVK_BVH_SSE
+#endif
+
+namespace myvk::data {
+
+namespace {
+// nodes with at least this many boxes build their halves in parallel
+constexpr u32 kParallelThreshold = 4096;
+
+float halfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+  glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3{0.f});
+  return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+u32 binOf(float center, float centerMin, float scale) {
+  return std::min((u32)((center - centerMin) * scale), Bvh::kBinCount - 1);
+}
+
+#ifdef MYVK_BVH_SSE
+// plane dotted with four points
+__m128 planeDistance(const glm::vec4& plane, __m128 x, __m128 y, __m128 z) {
+  __m128 xy = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x),
+                         _mm_mul_ps(_mm_set1_ps(plane.y), y));
+  __m128 zw = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), z),
+                         _mm_set1_ps(plane.w));
+  return _mm_add_ps(xy, zw);
+}
+#endif
+} // namespace
+
+void Bvh::build(std::span<const glm::vec3> boundsMin,
+                std::span<const glm::vec3> boundsMax) {
+  clear();
+  u32 count = (u32)boundsMin.size();
+  if (count == 0)
+    return;
+
+  BuildState state;
+  state.boundsMin = boundsMin;
+  state.boundsMax = boundsMax;
+  state.centers.resize(count);
+  for (u32 i = 0; i < count; ++i)
+    state.centers[i] = (boundsMin[i] + boundsMax[i]) * .5f;
+  // a binary tree with count leaves at most has 2 * count - 1 nodes
+  state.nodes.resize(2 * count - 1);
+  state.nodeCount = 1;
+
+  m_indices.resize(count);
+  for (u32 i = 0; i < count; ++i)
+    m_indices[i] = i;
+  buildNode(state, 0, 0, count, 0);
+
+  m_nodes.reserve(state.nodeCount / 2 + 1);
+  collapse(state, 0);
+}
+
+void Bvh::clear() {
+  m_nodes.clear();
+  m_indices.clear();
+}
+
+void Bvh::cull(const Frustum& frustum, std::vector<u32>& visible) const {
+  if (m_nodes.empty())
+    return;
+
+  std::vector<u32> stack{0};
+  while (!stack.empty()) {
+    const Node& node = m_nodes[stack.back()];
+    stack.pop_back();
+
+    u32 outside, inside;
+    TestChildren(node, frustum, outside, inside);
+    for (u32 i = 0; i < node.childCount; ++i) {
+      if (outside & (1 << i))
+        continue;
+      if (node.leafSize[i]) {
+        auto first = m_indices.begin() + node.child[i];
+        visible.insert(visible.end(), first, first + node.leafSize[i]);
+      } else if (inside & (1 << i)) {
+        appendSubtree(node.child[i], visible);
+      } else {
+        stack.push_back(node.child[i]);
+      }
+    }
+  }
+}
+
+void Bvh::buildNode(BuildState& state, u32 node, u32 first, u32 count,
+                    u32 depth) {
+  constexpr float kMax = std::numeric_limits<float>::max();
+
+  glm::vec3 boundsMin{kMax}, boundsMax{-kMax};
+  glm::vec3 centerMin{kMax}, centerMax{-kMax};
+  for (u32 i = first; i < first + count; ++i) {
+    u32 box   = m_indices[i];
+    boundsMin = glm::min(boundsMin, state.boundsMin[box]);
+    boundsMax = glm::max(boundsMax, state.boundsMax[box]);
+    centerMin = glm::min(centerMin, state.centers[box]);
+    centerMax = glm::max(centerMax, state.centers[box]);
+  }
+  // the nodes are allocated up front, the reference stays valid
+  BuildNode& out = state.nodes[node];
+  out            = {boundsMin, boundsMax, 0, 0, first, count};
+  if (count <= kMaxLeafSize)
+    return;
+
+  struct Bin {
+    glm::vec3 boundsMin{kMax}, boundsMax{-kMax};
+    u32       count{0};
+
+    void grow(const glm::vec3& min, const glm::vec3& max, u32 n) {
+      boundsMin = glm::min(boundsMin, min);
+      boundsMax = glm::max(boundsMax, max);
+      count += n;
+    }
+  };
+
+  // the cheapest split between bins on any axis, by surface area
+  float bestCost  = kMax;
+  int   bestAxis  = -1;
+  u32   bestSplit = 0;
+  for (int axis = 0; axis < 3 && depth < kMaxSahDepth; ++axis) {
+    float extent = centerMax[axis] - centerMin[axis];
+    if (extent <= 0.f)
+      continue;
+    float scale = kBinCount / extent;
+
+    Bin bins[kBinCount];
+    for (u32 i = first; i < first + count; ++i) {
+      u32 box = m_indices[i];
+      u32 bin = binOf(state.centers[box][axis], centerMin[axis], scale);
+      bins[bin].grow(state.boundsMin[box], state.boundsMax[box], 1);
+    }
+
+    float rightCost[kBinCount];
+    Bin   right;
+    for (u32 bin = kBinCount - 1; bin > 0; --bin) {
+      right.grow(bins[bin].boundsMin, bins[bin].boundsMax, bins[bin].count);
+      rightCost[bin] = halfArea(right.boundsMin, right.boundsMax) * right.count;
+    }
+    Bin left;
+    for (u32 bin = 0; bin + 1 < kBinCount; ++bin) {
+      left.grow(bins[bin].boundsMin, bins[bin].boundsMax, bins[bin].count);
+      if (left.count == 0 || left.count == count)
+        continue;
+      float cost = halfArea(left.boundsMin, left.boundsMax) * left.count +
+                   rightCost[bin + 1];
+      if (cost < bestCost) {
+        bestCost  = cost;
+        bestAxis  = axis;
+        bestSplit = bin + 1;
+      }
+    }
+  }
+
+  u32 middle = first + count / 2;
+  if (bestAxis >= 0) {
+    float scale = kBinCount / (centerMax[bestAxis] - centerMin[bestAxis]);
+    auto  split = std::partition(
+        m_indices.begin() + first, m_indices.begin() + first + count,
+        [&](u32 box) {
+          return binOf(state.centers[box][bestAxis], centerMin[bestAxis],
+                       scale) < bestSplit;
+        });
+    middle = (u32)(split - m_indices.begin());
+  } else {
+    // too deep for SAH, or all centers are in one point
+    glm::vec3 extent = centerMax - centerMin;
+    int       axis   = 0;
+    for (int i = 1; i < 3; ++i) {
+      if (extent[i] > extent[axis])
+        axis = i;
+    }
+    std::nth_element(m_indices.begin() + first, m_indices.begin() + middle,
+                     m_indices.begin() + first + count, [&](u32 a, u32 b) {
+                       return state.centers[a][axis] < state.centers[b][axis];
+                     });
+  }
+
+  // each half has its own run of m_indices and its own nodes
+  u32 left  = state.nodeCount.fetch_add(2);
+  out.left  = left;
+  out.right = left + 1;
+  auto buildHalf = [&](u32 half) {
+    if (half == 0)
+      buildNode(state, left, first, middle - first, depth + 1);
+    else
+      buildNode(state, left + 1, middle, first + count - middle, depth + 1);
+  };
+  if (count >= kParallelThreshold) {
+    ThreadPool::GetGlobal().parallelFor(2, buildHalf);
+  } else {
+    buildHalf(0);
+    buildHalf(1);
+  }
+}
+
+u32 Bvh::collapse(const BuildState& state, u32 node) {
+  auto isLeaf = [&](u32 child) {
+    return state.nodes[child].left == state.nodes[child].right;
+  };
+
+  // opens the largest binary node among the children until there are four
+  u32 children[kWidth] = {node};
+  u32 childCount       = 1;
+  while (childCount < kWidth) {
+    int   largest     = -1;
+    float largestArea = -1.f;
+    for (u32 i = 0; i < childCount; ++i) {
+      const BuildNode& child = state.nodes[children[i]];
+      float            area  = halfArea(child.boundsMin, child.boundsMax);
+      if (!isLeaf(children[i]) && area > largestArea) {
+        largest     = (int)i;
+        largestArea = area;
+      }
+    }
+    if (largest < 0)
+      break;
+    const BuildNode& opened  = state.nodes[children[largest]];
+    children[largest]        = opened.left;
+    children[childCount++]   = opened.right;
+  }
+
+  u32 index = (u32)m_nodes.size();
+  m_nodes.emplace_back();
+  Node ret{};
+  ret.childCount = childCount;
+  for (u32 i = 0; i < childCount; ++i) {
+    const BuildNode& child = state.nodes[children[i]];
+    ret.minX[i]            = child.boundsMin.x;
+    ret.minY[i]            = child.boundsMin.y;
+    ret.minZ[i]            = child.boundsMin.z;
+    ret.maxX[i]            = child.boundsMax.x;
+    ret.maxY[i]            = child.boundsMax.y;
+    ret.maxZ[i]            = child.boundsMax.z;
+    if (isLeaf(children[i])) {
+      ret.child[i]    = child.first;
+      ret.leafSize[i] = child.count;
+    } else {
+      ret.child[i] = collapse(state, children[i]);
+    }
+  }
+  m_nodes[index] = ret;
+  return index;
+}
+
+void Bvh::TestChildren(const Node& node, const Frustum& frustum, u32& outside,
+                       u32& inside) {
+  // a box is outside when its corner furthest along a plane's normal is
+  // behind the plane, and inside when its nearest corner is in front of all
+#ifdef MYVK_BVH_SSE
+  __m128 minX = _mm_load_ps(node.minX);
+  __m128 minY = _mm_load_ps(node.minY);
+  __m128 minZ = _mm_load_ps(node.minZ);
+  __m128 maxX = _mm_load_ps(node.maxX);
+  __m128 maxY = _mm_load_ps(node.maxY);
+  __m128 maxZ = _mm_load_ps(node.maxZ);
+  __m128 zero = _mm_setzero_ps();
+  __m128 out = zero, partial = zero;
+  for (const glm::vec4& plane : frustum.planes) {
+    __m128 far =
+        planeDistance(plane, plane.x > 0.f ? maxX : minX,
+                      plane.y > 0.f ? maxY : minY, plane.z > 0.f ? maxZ : minZ);
+    __m128 near =
+        planeDistance(plane, plane.x > 0.f ? minX : maxX,
+                      plane.y > 0.f ? minY : maxY, plane.z > 0.f ? minZ : maxZ);
+    out     = _mm_or_ps(out, _mm_cmplt_ps(far, zero));
+    partial = _mm_or_ps(partial, _mm_cmplt_ps(near, zero));
+  }
+  outside = (u32)_mm_movemask_ps(out);
+  inside  = ~(u32)_mm_movemask_ps(partial) & 0xf;
+#else
+  outside = 0;
+  inside  = 0;
+  for (u32 i = 0; i < node.childCount; ++i) {
+    glm::vec3 boundsMin{node.minX[i], node.minY[i], node.minZ[i]};
+    glm::vec3 boundsMax{node.maxX[i], node.maxY[i], node.maxZ[i]};
+    bool      isOutside = false, isInside = true;
+    for (const glm::vec4& plane : frustum.planes) {
+      glm::vec3 normal{plane};
+      glm::vec3 far  = glm::mix(boundsMin, boundsMax,
+                                glm::greaterThan(normal, glm::vec3{0.f}));
+      glm::vec3 near = boundsMin + boundsMax - far;
+      isOutside |= glm::dot(normal, far) + plane.w < 0.f;
+      isInside &= glm::dot(normal, near) + plane.w >= 0.f;
+    }
+    outside |= (u32)isOutside << i;
+    inside |= (u32)isInside << i;
+  }
+#endif
+}
+
+void Bvh::appendSubtree(u32 node, std::vector<u32>& visible) const {
+  const Node& current = m_nodes[node];
+  for (u32 i = 0; i < current.childCount; ++i) {
+    if (current.leafSize[i]) {
+      auto first = m_indices.begin() + current.child[i];
+      visible.insert(visible.end(), first, first + current.leafSize[i]);
+    } else {
+      appendSubtree(current.child[i], visible);
+    }
+  }
+}
+
+} // namespace myvk::data
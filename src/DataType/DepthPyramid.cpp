@@ -0,0 +1,306 @@
+#include "DataType/DepthPyramid.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace myvk::data {
+
+namespace {
+constexpr u32 kBindingCount = 3;
+
+u32 groupCount(u32 count) {
+  return (count + DepthPyramid::kGroupSize - 1) / DepthPyramid::kGroupSize;
+}
+} // namespace
+
+void DepthPyramid::create(ezvk::BufferAllocator& allocator, VkDevice device,
+                          const VkPipelineShaderStageCreateInfo& shader) {
+  m_allocator = &allocator;
+  m_device    = device;
+
+  // the multisampled depth, the level below and the level written
+  VkDescriptorSetLayoutBinding bindings[kBindingCount] = {
+      {
+          .binding            = 0,
+          .descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          .descriptorCount    = 1,
+          .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+          .pImmutableSamplers = nullptr,
+      },
+      {
+          .binding            = 1,
+          .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+          .descriptorCount    = 1,
+          .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+          .pImmutableSamplers = nullptr,
+      },
+      {
+          .binding            = 2,
+          .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+          .descriptorCount    = 1,
+          .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+          .pImmutableSamplers = nullptr,
+      },
+  };
+  VkDescriptorSetLayoutCreateInfo setLayoutCI{
+      .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .pNext        = nullptr,
+      .flags        = 0,
+      .bindingCount = kBindingCount,
+      .pBindings    = bindings,
+  };
+  vkCreateDescriptorSetLayout(m_device, &setLayoutCI, nullptr, &m_setLayout);
+
+  VkPushConstantRange pushConstantRange{
+      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      .offset     = 0,
+      .size       = sizeof(Params),
+  };
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .pNext                  = nullptr,
+      .flags                  = 0,
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_setLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstantRange,
+  };
+  vkCreatePipelineLayout(m_device, &pipelineLayoutCI, nullptr,
+                         &m_pipelineLayout);
+
+  VkComputePipelineCreateInfo pipelineCI{
+      .sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .pNext              = nullptr,
+      .flags              = 0,
+      .stage              = shader,
+      .layout             = m_pipelineLayout,
+      .basePipelineHandle = VK_NULL_HANDLE,
+      .basePipelineIndex  = -1,
+  };
+  vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr,
+                           &m_pipeline);
+
+  // the shaders only texelFetch, which ignores filtering
+  VkSamplerCreateInfo samplerCI{
+      .sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .pNext                   = nullptr,
+      .flags                   = 0,
+      .magFilter               = VK_FILTER_NEAREST,
+      .minFilter               = VK_FILTER_NEAREST,
+      .mipmapMode              = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      .addressModeU            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeV            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeW            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .mipLodBias              = 0.f,
+      .anisotropyEnable        = VK_FALSE,
+      .maxAnisotropy           = 1.f,
+      .compareEnable           = VK_FALSE,
+      .compareOp               = VK_COMPARE_OP_ALWAYS,
+      .minLod                  = 0.f,
+      .maxLod                  = VK_LOD_CLAMP_NONE,
+      .borderColor             = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+      .unnormalizedCoordinates = VK_FALSE,
+  };
+  vkCreateSampler(m_device, &samplerCI, nullptr, &m_sampler);
+}
+
+void DepthPyramid::destroy() {
+  destroyImage();
+  vkDestroySampler(m_device, m_sampler, nullptr);
+  vkDestroyPipeline(m_device, m_pipeline, nullptr);
+  vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+}
+
+void DepthPyramid::resize(VkImageView depthView, VkExtent2D depthExtent,
+                          VkSampleCountFlagBits samples) {
+  destroyImage();
+  m_depthExtent = depthExtent;
+  m_sampleCount = (u32)samples;
+  m_extent      = {std::bit_floor(std::max(depthExtent.width, 1u)),
+                   std::bit_floor(std::max(depthExtent.height, 1u))};
+  u32 levelCount =
+      (u32)std::bit_width(std::max(m_extent.width, m_extent.height));
+
+  VkImageCreateInfo imageCI{
+      .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .pNext       = nullptr,
+      .imageType   = VK_IMAGE_TYPE_2D,
+      .format      = VK_FORMAT_R32_SFLOAT,
+      .extent      = {m_extent.width, m_extent.height, 1},
+      .mipLevels   = levelCount,
+      .arrayLayers = 1,
+      .samples     = VK_SAMPLE_COUNT_1_BIT,
+      .tiling      = VK_IMAGE_TILING_OPTIMAL,
+      .usage       = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+  };
+  VmaAllocationCreateInfo imageAI{.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+  m_image = m_allocator->createImage(&imageCI, &imageAI);
+
+  auto createView = [&](u32 baseLevel, u32 count) {
+    VkImageViewCreateInfo viewCI{
+        .sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext    = nullptr,
+        .image    = m_image.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format   = VK_FORMAT_R32_SFLOAT,
+        .subresourceRange =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel   = baseLevel,
+                .levelCount     = count,
+                .baseArrayLayer = 0,
+                .layerCount     = 1,
+            },
+    };
+    VkImageView view;
+    vkCreateImageView(m_device, &viewCI, nullptr, &view);
+    return view;
+  };
+  m_view = createView(0, levelCount);
+  m_levelViews.resize(levelCount);
+  for (u32 level = 0; level < levelCount; ++level)
+    m_levelViews[level] = createView(level, 1);
+
+  VkDescriptorPoolSize poolSizes[2] = {
+      {
+          .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          .descriptorCount = levelCount,
+      },
+      {
+          .type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+          .descriptorCount = 2 * levelCount,
+      },
+  };
+  VkDescriptorPoolCreateInfo poolCI{
+      .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .pNext         = nullptr,
+      .flags         = 0,
+      .maxSets       = levelCount,
+      .poolSizeCount = 2,
+      .pPoolSizes    = poolSizes,
+  };
+  vkCreateDescriptorPool(m_device, &poolCI, nullptr, &m_descPool);
+  std::vector<VkDescriptorSetLayout> setLayouts(levelCount, m_setLayout);
+  VkDescriptorSetAllocateInfo        setAI{
+      .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext              = nullptr,
+      .descriptorPool     = m_descPool,
+      .descriptorSetCount = levelCount,
+      .pSetLayouts        = setLayouts.data(),
+  };
+  m_levelSets.resize(levelCount);
+  vkAllocateDescriptorSets(m_device, &setAI, m_levelSets.data());
+
+  for (u32 level = 0; level < levelCount; ++level) {
+    // level 0 reads the depth only, its source is a valid placeholder
+    VkDescriptorImageInfo imageInfos[kBindingCount] = {
+        {
+            .sampler     = m_sampler,
+            .imageView   = depthView,
+            .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+        },
+        {
+            .sampler     = VK_NULL_HANDLE,
+            .imageView   = m_levelViews[level > 0 ? level - 1 : 0],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        },
+        {
+            .sampler     = VK_NULL_HANDLE,
+            .imageView   = m_levelViews[level],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        },
+    };
+    VkWriteDescriptorSet writeSets[kBindingCount];
+    for (u32 i = 0; i < kBindingCount; ++i) {
+      writeSets[i] = {
+          .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .pNext           = nullptr,
+          .dstSet          = m_levelSets[level],
+          .dstBinding      = i,
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType  = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+                                    : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+          .pImageInfo      = &imageInfos[i],
+      };
+    }
+    vkUpdateDescriptorSets(m_device, kBindingCount, writeSets, 0, nullptr);
+  }
+}
+
+void DepthPyramid::record(VkCommandBuffer cmd) {
+  u32 levelCount = (u32)m_levelViews.size();
+
+  // every level is rebuilt, what the last frame's culling read is dropped
+  VkImageMemoryBarrier imageBarrier{
+      .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .pNext               = nullptr,
+      .srcAccessMask       = 0,
+      .dstAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+      .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image               = m_image.image,
+      .subresourceRange =
+          {
+              .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+              .baseMipLevel   = 0,
+              .levelCount     = levelCount,
+              .baseArrayLayer = 0,
+              .layerCount     = 1,
+          },
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &imageBarrier);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+  // each level reads the one before, and the culling the last one
+  VkMemoryBarrier levelBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+  };
+  VkExtent2D src = m_depthExtent;
+  for (u32 level = 0; level < levelCount; ++level) {
+    VkExtent2D dst{std::max(m_extent.width >> level, 1u),
+                   std::max(m_extent.height >> level, 1u)};
+    Params     params{
+        .srcWidth    = src.width,
+        .srcHeight   = src.height,
+        .dstWidth    = dst.width,
+        .dstHeight   = dst.height,
+        .level       = level,
+        .sampleCount = m_sampleCount,
+    };
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            m_pipelineLayout, 0, 1, &m_levelSets[level], 0,
+                            nullptr);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(Params), &params);
+    vkCmdDispatch(cmd, groupCount(dst.width), groupCount(dst.height), 1);
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &levelBarrier, 0, nullptr, 0, nullptr);
+    src = dst;
+  }
+}
+
+void DepthPyramid::destroyImage() {
+  if (!m_image.image)
+    return;
+  vkDestroyDescriptorPool(m_device, m_descPool, nullptr);
+  for (VkImageView view : m_levelViews)
+    vkDestroyImageView(m_device, view, nullptr);
+  vkDestroyImageView(m_device, m_view, nullptr);
+  m_allocator->destroyImage(m_image);
+  m_levelViews.clear();
+  m_levelSets.clear();
+  m_image = {};
+  m_view  = VK_NULL_HANDLE;
+}
+
+} // namespace myvk::data
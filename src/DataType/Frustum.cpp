@@ -0,0 +1,37 @@
+#include "DataType/Frustum.hpp"
+
+namespace myvk::data {
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProj) {
+  // rows of the matrix, glm is column major
+  glm::vec4 row[4];
+  for (int i = 0; i < 4; ++i)
+    row[i] = {viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]};
+
+  // glm's default clip space has z in [-w, w]
+  Frustum ret;
+  ret.planes[eLeft]   = row[3] + row[0];
+  ret.planes[eRight]  = row[3] - row[0];
+  ret.planes[eBottom] = row[3] + row[1];
+  ret.planes[eTop]    = row[3] - row[1];
+  ret.planes[eNear]   = row[3] + row[2];
+  ret.planes[eFar]    = row[3] - row[2];
+  for (glm::vec4& plane : ret.planes)
+    plane /= glm::length(glm::vec3(plane));
+  return ret;
+}
+
+bool Frustum::intersectsBox(const glm::vec3& boxMin,
+                            const glm::vec3& boxMax) const {
+  for (const glm::vec4& plane : planes) {
+    // the corner furthest along the plane normal
+    glm::vec3 corner{plane.x > 0.f ? boxMax.x : boxMin.x,
+                     plane.y > 0.f ? boxMax.y : boxMin.y,
+                     plane.z > 0.f ? boxMax.z : boxMin.z};
+    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.f)
+      return false;
+  }
+  return true;
+}
+
+} // namespace myvk::data
@@ -0,0 +1,236 @@
+#include "DataType/GeometryBuffer.hpp"
+
+#include <algorithm>
+
+namespace myvk::data {
+
+namespace {
+constexpr VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Vulkan has no empty buffers, so a pool never starts smaller
+constexpr VkDeviceSize kMinPoolCapacity = 64 << 10;
+} // namespace
+
+void RangeAllocator::reset(VkDeviceSize capacity) {
+  m_capacity  = capacity;
+  m_freeBytes = capacity;
+  m_free.clear();
+  if (capacity > 0)
+    m_free.emplace(0, capacity);
+}
+
+std::optional<VkDeviceSize> RangeAllocator::allocate(VkDeviceSize size,
+                                                     VkDeviceSize alignment) {
+  auto         best      = m_free.end();
+  VkDeviceSize bestSlack = 0;
+  for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+    auto [offset, freeSize] = *it;
+    VkDeviceSize start      = alignUp(offset, alignment);
+    if (start + size > offset + freeSize)
+      continue;
+    VkDeviceSize slack = freeSize - size;
+    if (best == m_free.end() || slack < bestSlack) {
+      best      = it;
+      bestSlack = slack;
+    }
+  }
+  if (best == m_free.end())
+    return std::nullopt;
+
+  // the padding in front and the rest behind stay free
+  auto [offset, freeSize] = *best;
+  VkDeviceSize start      = alignUp(offset, alignment);
+  m_free.erase(best);
+  if (start > offset)
+    m_free.emplace(offset, start - offset);
+  if (offset + freeSize > start + size)
+    m_free.emplace(start + size, offset + freeSize - start - size);
+  m_freeBytes -= size;
+  return start;
+}
+
+void RangeAllocator::free(VkDeviceSize offset, VkDeviceSize size) {
+  m_freeBytes += size;
+  auto next = m_free.lower_bound(offset);
+  if (next != m_free.end() && offset + size == next->first) {
+    size += next->second;
+    next = m_free.erase(next);
+  }
+  if (next != m_free.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      prev->second += size;
+      return;
+    }
+  }
+  m_free.emplace(offset, size);
+}
+
+void GeometryBuffer::create(ezvk::BufferAllocator& allocator,
+                            VkDeviceSize           vertexCapacity,
+                            VkDeviceSize           indexCapacity) {
+  m_allocator                      = &allocator;
+  m_pools[kVertexPool].usage       = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+  m_pools[kIndexPool].usage        = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+  m_pools[kVertexPool].minCapacity = std::max(vertexCapacity, kMinPoolCapacity);
+  m_pools[kIndexPool].minCapacity  = std::max(indexCapacity, kMinPoolCapacity);
+  createPool(kVertexPool, m_pools[kVertexPool].minCapacity);
+  createPool(kIndexPool, m_pools[kIndexPool].minCapacity);
+}
+
+void GeometryBuffer::destroy() {
+  for (RetiredBuffer& retired : m_retired)
+    m_allocator->destroyBuffer(retired.buffer);
+  m_retired.clear();
+  for (Pool& pool : m_pools)
+    m_allocator->destroyBuffer(pool.buffer);
+  m_ranges.clear();
+  m_freeHandles.clear();
+}
+
+u32 GeometryBuffer::addVertices(UploadBatch& batch, const void* data,
+                                VkDeviceSize size, u32 stride) {
+  return add(batch, kVertexPool, data, size, stride);
+}
+
+u32 GeometryBuffer::addIndices(UploadBatch& batch, const void* data,
+                               VkDeviceSize size, VkIndexType type) {
+  return add(batch, kIndexPool, data, size,
+             type == VK_INDEX_TYPE_UINT16 ? sizeof(u16) : sizeof(u32));
+}
+
+void GeometryBuffer::remove(u32 range) {
+  if (range == kInvalid)
+    return;
+  Range& removed = m_ranges[range];
+  m_pools[removed.pool].ranges.free(removed.offset, removed.size);
+  removed.live = false;
+  m_freeHandles.push_back(range);
+}
+
+void GeometryBuffer::trim(UploadBatch& batch) {
+  // halving only down to half full leaves room before the next move
+  for (u32 pool : {kVertexPool, kIndexPool}) {
+    const RangeAllocator& ranges   = m_pools[pool].ranges;
+    VkDeviceSize          used     = packedSize(pool);
+    VkDeviceSize          capacity = ranges.capacity();
+    while (capacity / 2 >= m_pools[pool].minCapacity && used <= capacity / 4)
+      capacity /= 2;
+    if (capacity < ranges.capacity())
+      relocate(batch, pool, capacity);
+  }
+}
+
+void GeometryBuffer::update() {
+  ++m_updateCount;
+  std::erase_if(m_retired, [&](RetiredBuffer& retired) {
+    if (retired.destroyAt > m_updateCount)
+      return false;
+    m_allocator->destroyBuffer(retired.buffer);
+    return true;
+  });
+}
+
+u32 GeometryBuffer::add(UploadBatch& batch, u32 pool, const void* data,
+                        VkDeviceSize size, VkDeviceSize elementSize) {
+  RangeAllocator&             ranges = m_pools[pool].ranges;
+  std::optional<VkDeviceSize> offset = ranges.allocate(size, elementSize);
+  if (!offset) {
+    // compacting is enough when the free bytes are only scattered
+    VkDeviceSize needed   = packedSize(pool, size, elementSize);
+    VkDeviceSize capacity = ranges.capacity();
+    if (needed > capacity)
+      capacity = std::max(capacity * 2, needed);
+    relocate(batch, pool, capacity);
+    offset = ranges.allocate(size, elementSize);
+  }
+
+  u32 handle;
+  if (m_freeHandles.empty()) {
+    handle = (u32)m_ranges.size();
+    m_ranges.emplace_back();
+  } else {
+    handle = m_freeHandles.back();
+    m_freeHandles.pop_back();
+  }
+  m_ranges[handle] = {pool, *offset, size, elementSize, true};
+  batch.copyToBuffer(data, size, m_pools[pool].buffer.buffer, *offset);
+  return handle;
+}
+
+void GeometryBuffer::createPool(u32 pool, VkDeviceSize capacity) {
+  VkBufferCreateInfo bufferCI{
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size  = capacity,
+      .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+               VK_BUFFER_USAGE_TRANSFER_DST_BIT | m_pools[pool].usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo bufferAI{.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+  m_pools[pool].buffer = m_allocator->createBuffer(&bufferCI, &bufferAI);
+  m_pools[pool].ranges.reset(capacity);
+}
+
+std::vector<u32> GeometryBuffer::liveRanges(u32 pool) const {
+  std::vector<u32> live;
+  for (u32 i = 0; i < m_ranges.size(); ++i) {
+    if (m_ranges[i].live && m_ranges[i].pool == pool)
+      live.push_back(i);
+  }
+  std::sort(live.begin(), live.end(), [&](u32 a, u32 b) {
+    return m_ranges[a].offset < m_ranges[b].offset;
+  });
+  return live;
+}
+
+VkDeviceSize GeometryBuffer::packedSize(u32 pool, VkDeviceSize extra,
+                                        VkDeviceSize extraAlignment) const {
+  // relocate() allocates them one after another from an empty buffer
+  VkDeviceSize end = 0;
+  for (u32 i : liveRanges(pool))
+    end = alignUp(end, m_ranges[i].elementSize) + m_ranges[i].size;
+  return alignUp(end, extraAlignment) + extra;
+}
+
+void GeometryBuffer::relocate(UploadBatch& batch, u32 pool,
+                              VkDeviceSize capacity) {
+  ezvk::AllocatedBuffer old = m_pools[pool].buffer;
+  createPool(pool, capacity);
+
+  // in offset order, ranges that were added together stay together
+  std::vector<u32>          live = liveRanges(pool);
+  std::vector<VkBufferCopy> regions;
+  for (u32 i : live) {
+    Range&       range = m_ranges[i];
+    VkDeviceSize offset =
+        *m_pools[pool].ranges.allocate(range.size, range.elementSize);
+    regions.push_back({range.offset, offset, range.size});
+    range.offset = offset;
+  }
+
+  if (!regions.empty()) {
+    // earlier copies into the old buffer may still be in this batch
+    VkMemoryBarrier barrier{
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext         = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+    };
+    vkCmdPipelineBarrier(batch.cmd().cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                         nullptr, 0, nullptr);
+    vkCmdCopyBuffer(batch.cmd().cmdBuffer, old.buffer,
+                    m_pools[pool].buffer.buffer, (u32)regions.size(),
+                    regions.data());
+  }
+  m_retired.push_back({old, m_updateCount + kRetireDelay});
+
+  LOG_INFO("moved {} {} ranges into a {} byte buffer", live.size(),
+           pool == kVertexPool ? "vertex" : "index", capacity);
+}
+
+} // namespace myvk::data
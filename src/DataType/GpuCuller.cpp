@@ -0,0 +1,611 @@
+#include "DataType/GpuCuller.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace myvk::data {
+
+namespace {
+// in the order of the bindings in cull.comp, the pyramid last
+constexpr u32 kBufferBindingCount = 12;
+constexpr u32 kViewBinding        = 11;
+constexpr u32 kPyramidBinding     = 12;
+constexpr u32 kBindingCount       = 13;
+
+u32 groupCount(u32 count) {
+  return (count + GpuCuller::kGroupSize - 1) / GpuCuller::kGroupSize;
+}
+
+VkDescriptorType bindingType(u32 binding) {
+  if (binding == kViewBinding)
+    return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  if (binding == kPyramidBinding)
+    return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+}
+} // namespace
+
+void GpuCuller::create(ezvk::BufferAllocator& allocator, VkDevice device,
+                       VkPhysicalDevice gpu, VkCommandPool cmdPool,
+                       VkQueue queue, u32 frameCount,
+                       const VkPipelineShaderStageCreateInfo& shader) {
+  m_allocator = &allocator;
+  m_device    = device;
+  m_cmdPool   = cmdPool;
+  m_queue     = queue;
+
+  // a desired extension, enabled whenever the device has it
+  u32 extensionCount;
+  vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extensionCount,
+                                       nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extensionCount,
+                                       extensions.data());
+  bool drawIndirectCount = std::any_of(
+      extensions.begin(), extensions.end(), [](const auto& extension) {
+        return std::strcmp(extension.extensionName,
+                           VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0;
+      });
+  if (drawIndirectCount) {
+    m_drawIndexedIndirectCount =
+        (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(
+            device, "vkCmdDrawIndexedIndirectCountKHR");
+  }
+  LOG_INFO("gpu culling draws through {}",
+           m_drawIndexedIndirectCount ? "vkCmdDrawIndexedIndirectCountKHR"
+                                      : "vkCmdDrawIndexedIndirect");
+
+  createPipeline(shader);
+
+  VkBufferCreateInfo viewCI{
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size  = sizeof(View),
+      .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo gpuAI{.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+  m_view = m_allocator->createBuffer(&viewCI, &gpuAI);
+
+  VkBufferCreateInfo countsCI{
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size  = sizeof(Counts),
+      .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  m_counts = m_allocator->createBuffer(&countsCI, &gpuAI);
+
+  VkBufferCreateInfo readbackCI{
+      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext       = nullptr,
+      .flags       = 0,
+      .size        = sizeof(Counts) * frameCount,
+      .usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo readbackAI{.usage = VMA_MEMORY_USAGE_GPU_TO_CPU};
+  m_countsReadback = m_allocator->createBuffer(&readbackCI, &readbackAI);
+  void* mapped;
+  vmaMapMemory(*m_allocator, m_countsReadback.allocation, &mapped);
+  m_countsMapped = (const Counts*)mapped;
+  m_countsWritten.assign(frameCount, 0);
+  writeDescriptors();
+}
+
+void GpuCuller::destroy() {
+  destroyBuffers();
+  vmaUnmapMemory(*m_allocator, m_countsReadback.allocation);
+  m_countsMapped = nullptr;
+  m_countsWritten.clear();
+  for (ezvk::AllocatedBuffer* buffer : {&m_view, &m_counts, &m_countsReadback})
+    m_allocator->destroyBuffer(*buffer);
+  vkDestroyPipeline(m_device, m_pipeline, nullptr);
+  vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+  vkDestroyDescriptorPool(m_device, m_descPool, nullptr);
+  vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+  m_objects.clear();
+  m_drawCount = 0;
+}
+
+void GpuCuller::setPyramid(const DepthPyramid& pyramid) {
+  m_pyramidExtent = pyramid.extent();
+  VkDescriptorImageInfo imageInfo{
+      .sampler     = pyramid.sampler(),
+      .imageView   = pyramid.view(),
+      .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+  };
+  VkWriteDescriptorSet writeSet{
+      .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .pNext           = nullptr,
+      .dstSet          = m_set,
+      .dstBinding      = kPyramidBinding,
+      .dstArrayElement = 0,
+      .descriptorCount = 1,
+      .descriptorType  = bindingType(kPyramidBinding),
+      .pImageInfo      = &imageInfo,
+  };
+  vkUpdateDescriptorSets(m_device, 1, &writeSet, 0, nullptr);
+}
+
+void GpuCuller::setScene(UploadBatch&                                  batch,
+                         std::span<const Object>                       objects,
+                         std::span<const VkDrawIndexedIndirectCommand> draws,
+                         u32 visibleCount) {
+  destroyBuffers();
+  m_objects.assign(objects.begin(), objects.end());
+  m_drawCount = (u32)draws.size();
+
+  // storage buffers may not be empty
+  auto bufferSize = [](size_t size) {
+    return std::max<VkDeviceSize>(size, sizeof(u32));
+  };
+  auto createBuffer = [&](VkDeviceSize size, VkBufferUsageFlags usage) {
+    VkBufferCreateInfo bufferCI{
+        .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext       = nullptr,
+        .flags       = 0,
+        .size        = bufferSize(size),
+        .usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    VmaAllocationCreateInfo bufferAI{.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+    return m_allocator->createBuffer(&bufferCI, &bufferAI);
+  };
+
+  Object noObject{};
+  m_objectBuffer = batch.uploadBuffer(
+      objects.empty() ? &noObject : objects.data(),
+      bufferSize(objects.size_bytes()), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  VkDrawIndexedIndirectCommand noDraw{};
+  m_templates = batch.uploadBuffer(draws.empty() ? &noDraw : draws.data(),
+                                   bufferSize(draws.size_bytes()),
+                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  std::vector<u32> visible(std::max(visibleCount, 1u), 0);
+  m_visible = batch.uploadBuffer(visible.data(), visible.size() * sizeof(u32),
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  // nothing was visible before the first frame, it is all drawn late
+  std::vector<u32> visibility(std::max<size_t>(objects.size(), 1), 0);
+  m_visibility =
+      batch.uploadBuffer(visibility.data(), visibility.size() * sizeof(u32),
+                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+  VkDeviceSize drawBytes = draws.size_bytes();
+  m_draws = createBuffer(drawBytes, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  m_compacted = createBuffer(drawBytes, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+  m_count     = createBuffer(sizeof(u32), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                              VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  m_lateDraws = createBuffer(drawBytes, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+  m_lateCompacted =
+      createBuffer(drawBytes, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+  m_lateCount = createBuffer(sizeof(u32), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+  writeDescriptors();
+}
+
+void GpuCuller::record(VkCommandBuffer cmd, const Frustum& frustum,
+                       const glm::mat4& viewProj, bool frustumCulling,
+                       bool occlusionCulling, u32 firstIndex,
+                       i32 vertexOffset) {
+  // the draws, culling and copies of earlier frames read what the reset and
+  // the view update overwrite
+  VkMemoryBarrier readBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = 0,
+      .dstAccessMask = 0,
+  };
+  vkCmdPipelineBarrier(
+      cmd,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+          VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+      1, &readBarrier, 0, nullptr, 0, nullptr);
+
+  if (occlusionCulling) {
+    View view{
+        .viewProj    = viewProj,
+        .pyramidSize = {m_pyramidExtent.width, m_pyramidExtent.height},
+    };
+    vkCmdUpdateBuffer(cmd, m_view.buffer, 0, sizeof(View), &view);
+    VkMemoryBarrier viewBarrier{
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext         = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT,
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &viewBarrier, 0, nullptr, 0, nullptr);
+  }
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+
+  m_params = {
+      .objectCount      = objectCount(),
+      .drawCount        = m_drawCount,
+      .frustumCulling   = frustumCulling,
+      .firstIndex       = firstIndex,
+      .vertexOffset     = vertexOffset,
+      .occlusionCulling = occlusionCulling,
+  };
+  std::copy(std::begin(frustum.planes), std::end(frustum.planes),
+            m_params.planes);
+  dispatch(cmd, m_params, eReset, m_drawCount);
+  dispatch(cmd, m_params, eCull, objectCount());
+  if (drawCountSupported())
+    dispatch(cmd, m_params, eCompact, m_drawCount);
+
+  VkMemoryBarrier drawBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask =
+          VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                       0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCuller::draw(VkCommandBuffer cmd) const {
+  if (m_drawCount == 0)
+    return;
+  if (drawCountSupported()) {
+    m_drawIndexedIndirectCount(cmd, m_compacted.buffer, 0, m_count.buffer, 0,
+                               m_drawCount,
+                               sizeof(VkDrawIndexedIndirectCommand));
+  } else {
+    vkCmdDrawIndexedIndirect(cmd, m_draws.buffer, 0, m_drawCount,
+                             sizeof(VkDrawIndexedIndirectCommand));
+  }
+}
+
+void GpuCuller::recordLate(VkCommandBuffer cmd) {
+  // the late cull adds to the draws the early ones read
+  VkMemoryBarrier cullBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(cmd,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                           VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &cullBarrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+  dispatch(cmd, m_params, eLateReset, m_drawCount);
+  dispatch(cmd, m_params, eLateCull, objectCount());
+  dispatch(cmd, m_params, eLateCompact, m_drawCount);
+
+  VkMemoryBarrier drawBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask =
+          VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                       0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCuller::drawLate(VkCommandBuffer cmd) const {
+  if (m_drawCount == 0)
+    return;
+  if (drawCountSupported()) {
+    m_drawIndexedIndirectCount(cmd, m_lateCompacted.buffer, 0,
+                               m_lateCount.buffer, 0, m_drawCount,
+                               sizeof(VkDrawIndexedIndirectCommand));
+  } else {
+    vkCmdDrawIndexedIndirect(cmd, m_lateDraws.buffer, 0, m_drawCount,
+                             sizeof(VkDrawIndexedIndirectCommand));
+  }
+}
+
+void GpuCuller::copyCounts(VkCommandBuffer cmd, u64 frame) {
+  u32             slot = (u32)(frame % m_countsWritten.size());
+  VkMemoryBarrier copyBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &copyBarrier, 0,
+                       nullptr, 0, nullptr);
+  VkBufferCopy countsCopy{
+      .srcOffset = 0,
+      .dstOffset = slot * sizeof(Counts),
+      .size      = sizeof(Counts),
+  };
+  vkCmdCopyBuffer(cmd, m_counts.buffer, m_countsReadback.buffer, 1,
+                  &countsCopy);
+  VkMemoryBarrier hostBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0,
+                       nullptr, 0, nullptr);
+  m_countsWritten[slot] = 1;
+}
+
+std::optional<GpuCuller::Counts> GpuCuller::counts(u64 frame) const {
+  u32 slot = (u32)(frame % m_countsWritten.size());
+  if (!m_countsWritten[slot])
+    return std::nullopt;
+  vmaInvalidateAllocation(*m_allocator, m_countsReadback.allocation,
+                          slot * sizeof(Counts), sizeof(Counts));
+  return m_countsMapped[slot];
+}
+
+GpuCuller::Stats GpuCuller::validate(const Frustum& frustum, u32 firstIndex,
+                                     i32 vertexOffset) {
+  using Clock = std::chrono::steady_clock;
+  Stats stats{};
+
+  auto cpuStart = Clock::now();
+  for (const Object& object : m_objects)
+    stats.cpuVisible += frustum.intersectsBox(object.boundsMin,
+                                              object.boundsMax);
+  stats.cpuMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - cpuStart)
+          .count();
+
+  // the instance count of every draw, then the compacted draw count
+  VkDeviceSize drawBytes = m_drawCount * sizeof(VkDrawIndexedIndirectCommand);
+  VkBufferCreateInfo readbackCI{
+      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext       = nullptr,
+      .flags       = 0,
+      .size        = drawBytes + sizeof(u32),
+      .usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo readbackAI{.usage = VMA_MEMORY_USAGE_GPU_TO_CPU};
+  ezvk::AllocatedBuffer   readback =
+      m_allocator->createBuffer(&readbackCI, &readbackAI);
+
+  ezvk::CommandBuffer cmd;
+  cmd.alloc(m_device, m_cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+  cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  record(cmd.cmdBuffer, frustum, glm::mat4{1.f}, true, false, firstIndex,
+         vertexOffset);
+  VkMemoryBarrier copyBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmd.cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &copyBarrier, 0,
+                       nullptr, 0, nullptr);
+  VkBufferCopy drawCopy{.srcOffset = 0, .dstOffset = 0, .size = drawBytes};
+  VkBufferCopy countCopy{
+      .srcOffset = 0, .dstOffset = drawBytes, .size = sizeof(u32)};
+  if (drawBytes > 0)
+    vkCmdCopyBuffer(cmd.cmdBuffer, m_draws.buffer, readback.buffer, 1,
+                    &drawCopy);
+  vkCmdCopyBuffer(cmd.cmdBuffer, m_count.buffer, readback.buffer, 1,
+                  &countCopy);
+  cmd.end();
+
+  VkFenceCreateInfo fenceCI{
+      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+  };
+  VkFence fence;
+  vkCreateFence(m_device, &fenceCI, nullptr, &fence);
+  VkSubmitInfo submitInfo{
+      .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext              = nullptr,
+      .commandBufferCount = 1,
+      .pCommandBuffers    = &cmd.cmdBuffer,
+  };
+  auto gpuStart = Clock::now();
+  vkQueueSubmit(m_queue, 1, &submitInfo, fence);
+  vkWaitForFences(m_device, 1, &fence, VK_TRUE,
+                  std::numeric_limits<u64>::max());
+  stats.gpuMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - gpuStart)
+          .count();
+  vkDestroyFence(m_device, fence, nullptr);
+  cmd.free(m_device, m_cmdPool);
+
+  void* mapped;
+  vmaMapMemory(*m_allocator, readback.allocation, &mapped);
+  vmaInvalidateAllocation(*m_allocator, readback.allocation, 0,
+                          VK_WHOLE_SIZE);
+  const auto* draws = (const VkDrawIndexedIndirectCommand*)mapped;
+  u32         nonEmptyDraws = 0;
+  for (u32 i = 0; i < m_drawCount; ++i) {
+    stats.gpuVisible += draws[i].instanceCount;
+    nonEmptyDraws += draws[i].instanceCount > 0;
+  }
+  u32 compactedCount;
+  std::memcpy(&compactedCount, (const u8*)mapped + drawBytes, sizeof(u32));
+  vmaUnmapMemory(*m_allocator, readback.allocation);
+  m_allocator->destroyBuffer(readback);
+
+  if (stats.gpuVisible != stats.cpuVisible)
+    LOG_ERR("gpu culling kept {} objects, the cpu {}", stats.gpuVisible,
+            stats.cpuVisible);
+  if (drawCountSupported() && compactedCount != nonEmptyDraws)
+    LOG_ERR("gpu culling compacted {} draws of {} with instances",
+            compactedCount, nonEmptyDraws);
+  return stats;
+}
+
+void GpuCuller::createPipeline(const VkPipelineShaderStageCreateInfo& shader) {
+  VkDescriptorSetLayoutBinding bindings[kBindingCount];
+  for (u32 i = 0; i < kBindingCount; ++i) {
+    bindings[i] = {
+        .binding            = i,
+        .descriptorType     = bindingType(i),
+        .descriptorCount    = 1,
+        .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+        .pImmutableSamplers = nullptr,
+    };
+  }
+  VkDescriptorSetLayoutCreateInfo setLayoutCI{
+      .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .pNext        = nullptr,
+      .flags        = 0,
+      .bindingCount = kBindingCount,
+      .pBindings    = bindings,
+  };
+  vkCreateDescriptorSetLayout(m_device, &setLayoutCI, nullptr, &m_setLayout);
+
+  VkDescriptorPoolSize poolSizes[3] = {
+      {
+          .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          .descriptorCount = kBufferBindingCount - 1,
+      },
+      {
+          .type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+          .descriptorCount = 1,
+      },
+      {
+          .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          .descriptorCount = 1,
+      },
+  };
+  VkDescriptorPoolCreateInfo poolCI{
+      .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .pNext         = nullptr,
+      .flags         = 0,
+      .maxSets       = 1,
+      .poolSizeCount = 3,
+      .pPoolSizes    = poolSizes,
+  };
+  vkCreateDescriptorPool(m_device, &poolCI, nullptr, &m_descPool);
+  VkDescriptorSetAllocateInfo setAI{
+      .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext              = nullptr,
+      .descriptorPool     = m_descPool,
+      .descriptorSetCount = 1,
+      .pSetLayouts        = &m_setLayout,
+  };
+  vkAllocateDescriptorSets(m_device, &setAI, &m_set);
+
+  VkPushConstantRange pushConstantRange{
+      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      .offset     = 0,
+      .size       = sizeof(Params),
+  };
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .pNext                  = nullptr,
+      .flags                  = 0,
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_setLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstantRange,
+  };
+  vkCreatePipelineLayout(m_device, &pipelineLayoutCI, nullptr,
+                         &m_pipelineLayout);
+
+  VkComputePipelineCreateInfo pipelineCI{
+      .sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .pNext              = nullptr,
+      .flags              = 0,
+      .stage              = shader,
+      .layout             = m_pipelineLayout,
+      .basePipelineHandle = VK_NULL_HANDLE,
+      .basePipelineIndex  = -1,
+  };
+  vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr,
+                           &m_pipeline);
+}
+
+void GpuCuller::writeDescriptors() {
+  // in the order of the bindings in cull.comp, only the last two exist
+  // before a scene is set
+  VkBuffer buffers[kBufferBindingCount] = {
+      m_objectBuffer.buffer, m_templates.buffer, m_draws.buffer,
+      m_visible.buffer,      m_compacted.buffer, m_count.buffer,
+      m_visibility.buffer,   m_lateDraws.buffer, m_lateCompacted.buffer,
+      m_lateCount.buffer,    m_counts.buffer,    m_view.buffer,
+  };
+  u32 first = m_objectBuffer.buffer ? 0 : kBufferBindingCount - 2;
+
+  VkDescriptorBufferInfo bufferInfos[kBufferBindingCount];
+  VkWriteDescriptorSet   writeSets[kBufferBindingCount];
+  for (u32 i = first; i < kBufferBindingCount; ++i) {
+    bufferInfos[i] = {
+        .buffer = buffers[i],
+        .offset = 0,
+        .range  = VK_WHOLE_SIZE,
+    };
+    writeSets[i] = {
+        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext           = nullptr,
+        .dstSet          = m_set,
+        .dstBinding      = i,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType  = bindingType(i),
+        .pBufferInfo     = &bufferInfos[i],
+    };
+  }
+  vkUpdateDescriptorSets(m_device, kBufferBindingCount - first,
+                         writeSets + first, 0, nullptr);
+}
+
+void GpuCuller::dispatch(VkCommandBuffer cmd, Params& params, Pass pass,
+                         u32 count) {
+  if (pass != eReset && pass != eLateReset) {
+    // each pass reads what the one before wrote
+    VkMemoryBarrier barrier{
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext         = nullptr,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier,
+                         0, nullptr, 0, nullptr);
+  }
+  params.pass = pass;
+  vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(Params), &params);
+  // the resets also clear the counts, so they run even without draws
+  u32 groups = groupCount(count);
+  if (pass == eReset || pass == eLateReset)
+    groups = std::max(groups, 1u);
+  vkCmdDispatch(cmd, groups, 1, 1);
+}
+
+void GpuCuller::destroyBuffers() {
+  // buffers of a scene that was never set are null
+  for (ezvk::AllocatedBuffer* buffer :
+       {&m_objectBuffer, &m_templates, &m_draws, &m_visible, &m_compacted,
+        &m_count, &m_visibility, &m_lateDraws, &m_lateCompacted,
+        &m_lateCount}) {
+    if (buffer->buffer)
+      m_allocator->destroyBuffer(*buffer);
+    *buffer = {};
+  }
+}
+
+} // namespace myvk::data
@@ -0,0 +1,66 @@
+#include "DataType/GpuTimer.hpp"
+
+namespace myvk::data {
+
+void GpuTimer::create(VkDevice device, VkPhysicalDevice gpu, u32 frameCount) {
+  m_device = device;
+  m_written.assign(frameCount, 0);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(gpu, &properties);
+  if (!properties.limits.timestampComputeAndGraphics) {
+    LOG_WARN("{} cannot write timestamps, frames are not timed",
+             properties.deviceName);
+    return;
+  }
+  m_period = properties.limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo poolCI{
+      .sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .pNext              = nullptr,
+      .flags              = 0,
+      .queryType          = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount         = 2 * frameCount,
+      .pipelineStatistics = 0,
+  };
+  vkCreateQueryPool(m_device, &poolCI, nullptr, &m_pool);
+}
+
+void GpuTimer::destroy() {
+  if (m_pool)
+    vkDestroyQueryPool(m_device, m_pool, nullptr);
+  m_pool = VK_NULL_HANDLE;
+  m_written.clear();
+}
+
+void GpuTimer::begin(VkCommandBuffer cmd, u64 frame) {
+  m_slot = (u32)(frame % m_written.size());
+  if (!m_pool)
+    return;
+  vkCmdResetQueryPool(cmd, m_pool, 2 * m_slot, 2);
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_pool,
+                      2 * m_slot);
+}
+
+void GpuTimer::end(VkCommandBuffer cmd) {
+  if (!m_pool)
+    return;
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_pool,
+                      2 * m_slot + 1);
+  m_written[m_slot] = 1;
+}
+
+std::optional<double> GpuTimer::ms(u64 frame) const {
+  u32 slot = (u32)(frame % m_written.size());
+  if (!m_pool || !m_written[slot])
+    return std::nullopt;
+  u64      ticks[2];
+  VkResult result = vkGetQueryPoolResults(
+      m_device, m_pool, 2 * slot, 2, sizeof(ticks), ticks, sizeof(u64),
+      VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS)
+    return std::nullopt;
+  return (double)(ticks[1] - ticks[0]) * m_period / 1e6;
+}
+
+} // namespace myvk::data
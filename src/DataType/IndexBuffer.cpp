@@ -0,0 +1,181 @@
+#include "DataType/IndexBuffer.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace myvk::data {
+
+namespace {
+// interleaves the low 10 bits of each coordinate
+u32 mortonKey(const glm::uvec3& cell) {
+  auto spread = [](u32 x) {
+    x &= 0x3FF;
+    x = (x | (x << 16)) & 0x030000FF;
+    x = (x | (x << 8)) & 0x0300F00F;
+    x = (x | (x << 4)) & 0x030C30C3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+  };
+  return spread(cell.x) | (spread(cell.y) << 1) | (spread(cell.z) << 2);
+}
+} // namespace
+
+CompactIndices CompactIndices::Build(std::span<const u32> indices,
+                                     size_t               vertexCount,
+                                     std::span<Meshlet>   meshlets) {
+  constexpr u32 kMaxChunkVertices = 1 << 16;
+
+  CompactIndices ret;
+  u32            indexCount = (u32)(indices.size() / 3 * 3);
+  if (indexCount == 0)
+    return ret;
+
+  ret.indices16.resize(indexCount);
+  for (Meshlet& meshlet : meshlets)
+    meshlet.vertexOffset = 0;
+
+  if (vertexCount <= kMaxChunkVertices) {
+    ret.type = VK_INDEX_TYPE_UINT16;
+    for (u32 i = 0; i < indexCount; ++i)
+      ret.indices16[i] = (u16)indices[i];
+    ret.chunks = {{0, indexCount, 0}};
+    return ret;
+  }
+
+  // Chunks grow one meshlet (or triangle) at a time. Meshlets are first
+  // put in Morton order of their centers, which keeps every chunk compact
+  // so few vertices are shared with other chunks.
+  u32 unitCount = meshlets.empty() ? indexCount / 3 : (u32)meshlets.size();
+  std::vector<u32> order(unitCount);
+  std::iota(order.begin(), order.end(), 0);
+  if (!meshlets.empty()) {
+    glm::vec3 boundsMin = meshlets[0].center, boundsMax = boundsMin;
+    for (const Meshlet& meshlet : meshlets) {
+      boundsMin = glm::min(boundsMin, meshlet.center);
+      boundsMax = glm::max(boundsMax, meshlet.center);
+    }
+    glm::vec3        extent = boundsMax - boundsMin;
+    float            scale  = 1023.f / std::max(
+                                   {extent.x, extent.y, extent.z, 1e-20f});
+    std::vector<u32> keys(unitCount);
+    for (u32 unit = 0; unit < unitCount; ++unit) {
+      glm::uvec3 cell = (meshlets[unit].center - boundsMin) * scale;
+      keys[unit]      = mortonKey(cell);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](u32 lhs, u32 rhs) { return keys[lhs] < keys[rhs]; });
+  }
+  auto unitRange = [&](u32 unit) -> std::pair<u32, u32> {
+    if (meshlets.empty())
+      return {unit * 3, 3};
+    return {meshlets[unit].firstIndex, meshlets[unit].indexCount};
+  };
+
+  std::vector<u32> chunkOf(vertexCount, ~0u), localIndex(vertexCount);
+  std::vector<Meshlet> sorted;
+  sorted.reserve(meshlets.size());
+  ret.vertexRemap.reserve(vertexCount + vertexCount / 8);
+  u32        chunkId = 0, chunkVertices = 0, out = 0;
+  IndexChunk chunk{0, 0, 0};
+  for (u32 unit : order) {
+    auto [first, count] = unitRange(unit);
+    // may count a vertex twice, which only ends the chunk a bit early
+    u32 added = 0;
+    for (u32 i = first; i < first + count; ++i)
+      added += chunkOf[indices[i]] != chunkId;
+
+    if (chunkVertices + added > kMaxChunkVertices) {
+      ret.chunks.push_back(chunk);
+      chunk = {out, 0, (i32)ret.vertexRemap.size()};
+      ++chunkId;
+      chunkVertices = 0;
+    }
+
+    if (!meshlets.empty()) {
+      sorted.push_back(meshlets[unit]);
+      sorted.back().firstIndex   = out;
+      sorted.back().vertexOffset = chunk.vertexOffset;
+    }
+    for (u32 i = first; i < first + count; ++i) {
+      u32 vertex = indices[i];
+      if (chunkOf[vertex] != chunkId) {
+        chunkOf[vertex]    = chunkId;
+        localIndex[vertex] = chunkVertices++;
+        ret.vertexRemap.push_back(vertex);
+      }
+      ret.indices16[out++] = (u16)localIndex[vertex];
+    }
+    chunk.indexCount += count;
+  }
+  ret.chunks.push_back(chunk);
+
+  // duplicated vertices have to cost less than the index bytes saved, the
+  // remap may also be shorter than vertexCount when vertices are unused
+  if (ret.vertexRemap.size() > vertexCount + vertexCount / 8) {
+    LOG_INFO("16 bit indices would upload {} copies of {} vertices",
+             ret.vertexRemap.size(), vertexCount);
+    ret        = {};
+    ret.chunks = {{0, indexCount, 0}};
+    return ret;
+  }
+  std::copy(sorted.begin(), sorted.end(), meshlets.begin());
+  ret.type = VK_INDEX_TYPE_UINT16;
+  return ret;
+}
+
+std::vector<u32> RemapIndices(std::span<const u32> indices,
+                              std::span<const u32> vertexRemap,
+                              size_t               vertexCount) {
+  if (vertexRemap.empty())
+    return {indices.begin(), indices.end()};
+
+  std::vector<u32> uploadedAt(vertexCount, ~0u);
+  for (u32 i = 0; i < vertexRemap.size(); ++i) {
+    if (uploadedAt[vertexRemap[i]] == ~0u)
+      uploadedAt[vertexRemap[i]] = i;
+  }
+  std::vector<u32> ret(indices.size());
+  for (size_t i = 0; i < indices.size(); ++i)
+    ret[i] = uploadedAt[indices[i]];
+  return ret;
+}
+
+std::vector<u8> EncodeIndices(std::span<const u32> indices) {
+  std::vector<u8> ret;
+  ret.reserve(indices.size() * 2);
+  u32 prev = 0;
+  for (u32 index : indices) {
+    i32 delta = (i32)(index - prev);
+    u32 value = ((u32)delta << 1) ^ (u32)(delta >> 31);
+    while (value >= 0x80) {
+      ret.push_back((u8)(value | 0x80));
+      value >>= 7;
+    }
+    ret.push_back((u8)value);
+    prev = index;
+  }
+  return ret;
+}
+
+bool DecodeIndices(std::span<const u8> encoded, std::span<u32> out) {
+  const u8* cur  = encoded.data();
+  const u8* end  = cur + encoded.size();
+  u32       prev = 0;
+  for (u32& index : out) {
+    u32 value = 0;
+    u32 shift = 0;
+    u8  byte;
+    do {
+      if (cur == end || shift > 28)
+        return false;
+      byte = *cur++;
+      value |= (u32)(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    prev += (value >> 1) ^ (0u - (value & 1));
+    index = prev;
+  }
+  return cur == end;
+}
+
+} // namespace myvk::data
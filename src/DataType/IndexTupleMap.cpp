@@ -0,0 +1,72 @@
+#include "DataType/IndexTupleMap.hpp"
+
+#include <bit>
+
+namespace myvk::data {
+
+namespace {
+// keep the load factor under 3/4
+inline size_t capacityFor(size_t count) {
+  return std::bit_ceil(std::max<size_t>(16, count + count / 3 + 1));
+}
+} // namespace
+
+u32 IndexTupleMap::Hash(const tinyobj::index_t& key) {
+  u32 h = (u32)key.vertex_index * 0x9E3779B1u;
+  h ^= (u32)key.texcoord_index * 0x85EBCA77u;
+  h ^= (u32)key.normal_index * 0xC2B2AE3Du;
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  h *= 0x846CA68Bu;
+  h ^= h >> 16;
+  return h;
+}
+
+void IndexTupleMap::reserve(size_t count) {
+  size_t capacity = capacityFor(count);
+  if (capacity > m_slots.size())
+    rehash(capacity);
+}
+
+void IndexTupleMap::clear() {
+  std::fill(m_slots.begin(), m_slots.end(), Slot{kEmpty, kEmpty, kEmpty, 0});
+  m_size = 0;
+}
+
+std::pair<u32, bool> IndexTupleMap::insert(const tinyobj::index_t& key,
+                                           u32                     value) {
+  if (capacityFor(m_size + 1) > m_slots.size())
+    rehash(capacityFor((m_size + 1) * 2));
+
+  size_t slot = Hash(key) & m_mask;
+  while (true) {
+    Slot& cur = m_slots[slot];
+    if (cur.vertex == kEmpty) {
+      cur = {key.vertex_index, key.texcoord_index, key.normal_index, value};
+      ++m_size;
+      return {value, true};
+    }
+    if (cur.vertex == key.vertex_index && cur.texcoord == key.texcoord_index &&
+        cur.normal == key.normal_index)
+      return {cur.value, false};
+    slot = (slot + 1) & m_mask;
+  }
+}
+
+void IndexTupleMap::rehash(size_t capacity) {
+  std::vector<Slot> old = std::move(m_slots);
+  m_slots.assign(capacity, Slot{kEmpty, kEmpty, kEmpty, 0});
+  m_mask = capacity - 1;
+
+  for (const Slot& cur : old) {
+    if (cur.vertex == kEmpty)
+      continue;
+    size_t slot = Hash({cur.vertex, cur.normal, cur.texcoord}) & m_mask;
+    while (m_slots[slot].vertex != kEmpty)
+      slot = (slot + 1) & m_mask;
+    m_slots[slot] = cur;
+  }
+}
+
+} // namespace myvk::data
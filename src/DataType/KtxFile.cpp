@@ -0,0 +1,290 @@
+#include "DataType/KtxFile.hpp"
+#include "Hash.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace myvk::data {
+
+namespace {
+constexpr u8 kIdentifier[12] = {0xAB, 'K',  'T',  'X',  ' ',  '2',
+                                '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct KtxHeader {
+  u8  identifier[12];
+  u32 vkFormat;
+  u32 typeSize;
+  u32 pixelWidth;
+  u32 pixelHeight;
+  u32 pixelDepth;
+  u32 layerCount;
+  u32 faceCount;
+  u32 levelCount;
+  u32 supercompressionScheme;
+  u32 dfdByteOffset;
+  u32 dfdByteLength;
+  u32 kvdByteOffset;
+  u32 kvdByteLength;
+  u64 sgdByteOffset;
+  u64 sgdByteLength;
+};
+
+struct KtxLevel {
+  u64 byteOffset;
+  u64 byteLength;
+  u64 uncompressedByteLength;
+};
+
+constexpr char kSourceKey[] = "myvk.source";
+
+struct SourceInfo {
+  u32 version;
+  u32 reserved;
+  u64 size;
+  i64 time;
+  u64 hash;
+};
+
+constexpr u64 alignUp(u64 value, u64 alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool statSource(ccstr sourcePath, u64& size, i64& time) {
+  std::error_code ec;
+  size = fs::file_size(sourcePath, ec);
+  if (ec)
+    return false;
+  time = fs::last_write_time(sourcePath, ec).time_since_epoch().count();
+  return !ec;
+}
+
+u64 hashSource(ccstr sourcePath) {
+  MappedFile source;
+  if (!source.open(sourcePath))
+    return 0;
+  return HashBytesParallel(source.data(), source.size());
+}
+
+bool isBakedFormat(VkFormat format) {
+  return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ||
+         format == VK_FORMAT_BC3_SRGB_BLOCK;
+}
+
+// Khronos basic data format descriptor of a baked format
+std::vector<u32> describeFormat(VkFormat format) {
+  bool bc3         = format == VK_FORMAT_BC3_SRGB_BLOCK;
+  u32  sampleCount = bc3 ? 2 : 1;
+  u32  blockSize   = 24 + 16 * sampleCount;
+  // model BC1A or BC3, BT.709 primaries, sRGB transfer, 4x4 texel blocks
+  std::vector<u32> ret{
+      4 + blockSize,
+      0,
+      2 | blockSize << 16,
+      (bc3 ? 130u : 128u) | 1 << 8 | 2 << 16,
+      3 | 3 << 8,
+      bc3 ? 16u : 8u,
+      0,
+  };
+  auto addSample = [&](u32 bitOffset, u32 channel) {
+    ret.insert(ret.end(), {bitOffset | 63 << 16 | channel << 24, 0, 0, ~0u});
+  };
+  // BC3 keeps its alpha block, stored linearly, ahead of the color block
+  if (bc3)
+    addSample(0, 0x1F);
+  addSample(bc3 ? 64 : 0, 0);
+  return ret;
+}
+} // namespace
+
+std::string KtxFile::PathFor(ccstr sourcePath) {
+  return std::string(sourcePath) + ".ktx2";
+}
+
+bool KtxFile::Write(ccstr sourcePath, const MipChain& levels) {
+  if (!isBakedFormat(levels.format) || levels.extents.empty())
+    return false;
+
+  SourceInfo source{.version = kVersion};
+  if (!statSource(sourcePath, source.size, source.time))
+    return false;
+  source.hash = hashSource(sourcePath);
+
+  u32              levelCount = (u32)levels.extents.size();
+  std::vector<u32> dfd        = describeFormat(levels.format);
+  u32              kvdEntry   = sizeof(kSourceKey) + sizeof(SourceInfo);
+
+  KtxHeader header{
+      .vkFormat      = (u32)levels.format,
+      .typeSize      = 1,
+      .pixelWidth    = levels.extents[0].width,
+      .pixelHeight   = levels.extents[0].height,
+      .faceCount     = 1,
+      .levelCount    = levelCount,
+      .dfdByteLength = (u32)(dfd.size() * sizeof(u32)),
+      .kvdByteLength = 4 + kvdEntry,
+  };
+  std::memcpy(header.identifier, kIdentifier, sizeof(kIdentifier));
+  header.dfdByteOffset =
+      (u32)(sizeof(KtxHeader) + levelCount * sizeof(KtxLevel));
+  header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+
+  // level data is aligned to the block size and stored smallest first, one
+  // texel rounds up to one block
+  u64 blockBytes = MipLevelSize(levels.format, {1, 1});
+  u64 offset = alignUp(header.kvdByteOffset + header.kvdByteLength, 4);
+  std::vector<KtxLevel> index(levelCount);
+  for (u32 level = levelCount; level-- > 0;) {
+    u64 size     = MipLevelSize(levels.format, levels.extents[level]);
+    offset       = alignUp(offset, blockBytes);
+    index[level] = {offset, size, size};
+    offset += size;
+  }
+
+  // write to a temporary file so a crash never leaves a torn cache behind
+  std::string path    = PathFor(sourcePath);
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+      return false;
+    char padding[16]{};
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)index.data(), index.size() * sizeof(KtxLevel));
+    out.write((const char*)dfd.data(), header.dfdByteLength);
+    out.write((const char*)&kvdEntry, sizeof(kvdEntry));
+    out.write(kSourceKey, sizeof(kSourceKey));
+    out.write((const char*)&source, sizeof(source));
+    u64 written = header.kvdByteOffset + header.kvdByteLength;
+    for (u32 level = levelCount; level-- > 0;) {
+      out.write(padding, index[level].byteOffset - written);
+      out.write((const char*)levels.pixels.data() + levels.offsets[level],
+                index[level].byteLength);
+      written = index[level].byteOffset + index[level].byteLength;
+    }
+    if (!out)
+      return false;
+  }
+
+  std::error_code ec;
+  fs::rename(tmpPath, path, ec);
+  if (ec) {
+    fs::remove(tmpPath, ec);
+    return false;
+  }
+  return true;
+}
+
+bool KtxFile::open(ccstr sourcePath) {
+  close();
+
+  u64 sourceSize;
+  i64 sourceTime;
+  if (!statSource(sourcePath, sourceSize, sourceTime))
+    return false;
+
+  std::string path = PathFor(sourcePath);
+  if (!m_file.open(path.c_str()))
+    return false;
+
+  auto reject = [&](ccstr reason) {
+    LOG_WARN("texture cache {} {}", path, reason);
+    close();
+    return false;
+  };
+
+  u64       fileSize = m_file.size();
+  KtxHeader header;
+  if (fileSize < sizeof(header))
+    return reject("is truncated");
+  std::memcpy(&header, m_file.data(), sizeof(header));
+  if (std::memcmp(header.identifier, kIdentifier, sizeof(kIdentifier)) != 0)
+    return reject("is not a KTX2 file");
+
+  VkFormat format = (VkFormat)header.vkFormat;
+  if (!isBakedFormat(format) || header.pixelDepth != 0 ||
+      header.layerCount > 1 || header.faceCount != 1 ||
+      header.supercompressionScheme != 0 ||
+      header.levelCount !=
+          MipLevelCount(header.pixelWidth, header.pixelHeight)) {
+    return reject("has an unsupported layout");
+  }
+  if ((u64)header.kvdByteOffset + header.kvdByteLength > fileSize ||
+      sizeof(header) + header.levelCount * sizeof(KtxLevel) > fileSize)
+    return reject("is truncated");
+
+  // the source entry is the only one that is read
+  SourceInfo source{};
+  u64        sourceOffset = 0;
+  for (u64 entry = header.kvdByteOffset,
+           end   = header.kvdByteOffset + header.kvdByteLength;
+       entry + 4 <= end;) {
+    u32 length;
+    std::memcpy(&length, m_file.data() + entry, sizeof(length));
+    if (length > end - entry - 4)
+      break;
+    if (length == sizeof(kSourceKey) + sizeof(SourceInfo) &&
+        std::memcmp(m_file.data() + entry + 4, kSourceKey,
+                    sizeof(kSourceKey)) == 0) {
+      sourceOffset = entry + 4 + sizeof(kSourceKey);
+      std::memcpy(&source, m_file.data() + sourceOffset, sizeof(source));
+      break;
+    }
+    entry = alignUp(entry + 4 + length, 4);
+  }
+  if (sourceOffset == 0 || source.version != kVersion ||
+      source.size != sourceSize) {
+    close();
+    return false;
+  }
+
+  if (source.time != sourceTime) {
+    // touched but maybe unchanged, fall back to the content hash
+    if (hashSource(sourcePath) != source.hash) {
+      close();
+      return false;
+    }
+    source.time = sourceTime;
+    std::fstream patch(path, std::ios::binary | std::ios::in | std::ios::out);
+    patch.seekp(sourceOffset + offsetof(SourceInfo, time));
+    patch.write((const char*)&source.time, sizeof(source.time));
+  }
+
+  // Texel data is not hashed, a damaged block only shows up as wrong colors.
+  // Sizes and offsets are checked since they drive the upload.
+  std::vector<KtxLevel> index(header.levelCount);
+  std::memcpy(index.data(), m_file.data() + sizeof(header),
+              index.size() * sizeof(KtxLevel));
+  m_dataOffset = index.back().byteOffset;
+  for (u32 level = 0; level < header.levelCount; ++level) {
+    VkExtent2D extent{std::max(header.pixelWidth >> level, 1u),
+                      std::max(header.pixelHeight >> level, 1u)};
+    if (index[level].byteLength != MipLevelSize(format, extent) ||
+        index[level].byteOffset < m_dataOffset ||
+        index[level].byteOffset > fileSize ||
+        index[level].byteLength > fileSize - index[level].byteOffset)
+      return reject("has invalid levels");
+    m_extents.push_back(extent);
+    m_offsets.push_back(index[level].byteOffset - m_dataOffset);
+  }
+  m_format = format;
+  return true;
+}
+
+void KtxFile::close() {
+  m_file.close();
+  m_format     = VK_FORMAT_UNDEFINED;
+  m_dataOffset = 0;
+  m_extents.clear();
+  m_offsets.clear();
+}
+
+std::span<const u8> KtxFile::levelData() const {
+  return {(const u8*)m_file.data() + m_dataOffset,
+          m_file.size() - m_dataOffset};
+}
+
+} // namespace myvk::data
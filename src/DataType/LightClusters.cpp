@@ -0,0 +1,303 @@
+#include "DataType/LightClusters.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace myvk::data {
+
+namespace {
+constexpr u32 kBindingCount = 3;
+// where Clusters in lightcull.comp keeps the dropped lights
+constexpr VkDeviceSize kDroppedOffset =
+    LightClusters::kClusterCount * sizeof(u32);
+// the view, the lights and the clusters' lists
+constexpr VkDescriptorType kBindingTypes[kBindingCount] = {
+    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+};
+} // namespace
+
+void LightClusters::create(ezvk::BufferAllocator& allocator, VkDevice device,
+                           u32 maxLights, u32 frameCount,
+                           const VkPipelineShaderStageCreateInfo& shader) {
+  m_allocator  = &allocator;
+  m_device     = device;
+  m_maxLights  = std::max(maxLights, 1u);
+  m_frameCount = frameCount;
+
+  VkDescriptorSetLayoutBinding bindings[kBindingCount];
+  for (u32 i = 0; i < kBindingCount; ++i) {
+    bindings[i] = {
+        .binding            = i,
+        .descriptorType     = kBindingTypes[i],
+        .descriptorCount    = 1,
+        .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT,
+        .pImmutableSamplers = nullptr,
+    };
+  }
+  VkDescriptorSetLayoutCreateInfo setLayoutCI{
+      .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .pNext        = nullptr,
+      .flags        = 0,
+      .bindingCount = kBindingCount,
+      .pBindings    = bindings,
+  };
+  vkCreateDescriptorSetLayout(m_device, &setLayoutCI, nullptr, &m_setLayout);
+
+  VkDescriptorPoolSize poolSizes[2] = {
+      {
+          .type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+          .descriptorCount = 1,
+      },
+      {
+          .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          .descriptorCount = 2,
+      },
+  };
+  VkDescriptorPoolCreateInfo poolCI{
+      .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .pNext         = nullptr,
+      .flags         = 0,
+      .maxSets       = 1,
+      .poolSizeCount = 2,
+      .pPoolSizes    = poolSizes,
+  };
+  vkCreateDescriptorPool(m_device, &poolCI, nullptr, &m_descPool);
+  VkDescriptorSetAllocateInfo setAI{
+      .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext              = nullptr,
+      .descriptorPool     = m_descPool,
+      .descriptorSetCount = 1,
+      .pSetLayouts        = &m_setLayout,
+  };
+  vkAllocateDescriptorSets(m_device, &setAI, &m_set);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .pNext                  = nullptr,
+      .flags                  = 0,
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_setLayout,
+      .pushConstantRangeCount = 0,
+      .pPushConstantRanges    = nullptr,
+  };
+  vkCreatePipelineLayout(m_device, &pipelineLayoutCI, nullptr,
+                         &m_pipelineLayout);
+
+  VkComputePipelineCreateInfo pipelineCI{
+      .sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .pNext              = nullptr,
+      .flags              = 0,
+      .stage              = shader,
+      .layout             = m_pipelineLayout,
+      .basePipelineHandle = VK_NULL_HANDLE,
+      .basePipelineIndex  = -1,
+  };
+  vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr,
+                           &m_pipeline);
+
+  // written by record() and read in place
+  VkBufferCreateInfo lightsCI{
+      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext       = nullptr,
+      .flags       = 0,
+      .size        = (VkDeviceSize)m_maxLights * frameCount * sizeof(Light),
+      .usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo lightsAI{.usage = VMA_MEMORY_USAGE_CPU_TO_GPU};
+  m_lights = m_allocator->createBuffer(&lightsCI, &lightsAI);
+  void* lightsMapped;
+  vmaMapMemory(*m_allocator, m_lights.allocation, &lightsMapped);
+  m_lightsMapped = (Light*)lightsMapped;
+  m_staleLights.assign(frameCount, 0);
+
+  VkBufferCreateInfo viewCI{
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size  = sizeof(View),
+      .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo gpuAI{.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+  m_view = m_allocator->createBuffer(&viewCI, &gpuAI);
+
+  VkBufferCreateInfo clustersCI{
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .size  = (kClusterCount * (1 + kMaxClusterLights) + 1) * sizeof(u32),
+      .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+               VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+               VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  m_clusters = m_allocator->createBuffer(&clustersCI, &gpuAI);
+
+  VkBufferCreateInfo readbackCI{
+      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext       = nullptr,
+      .flags       = 0,
+      .size        = sizeof(u32) * frameCount,
+      .usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo readbackAI{.usage = VMA_MEMORY_USAGE_GPU_TO_CPU};
+  m_droppedReadback = m_allocator->createBuffer(&readbackCI, &readbackAI);
+  void* mapped;
+  vmaMapMemory(*m_allocator, m_droppedReadback.allocation, &mapped);
+  m_droppedMapped = (const u32*)mapped;
+  m_droppedWritten.assign(frameCount, 0);
+
+  VkBuffer buffers[kBindingCount] = {m_view.buffer, m_lights.buffer,
+                                     m_clusters.buffer};
+  VkDescriptorBufferInfo bufferInfos[kBindingCount];
+  VkWriteDescriptorSet   writeSets[kBindingCount];
+  for (u32 i = 0; i < kBindingCount; ++i) {
+    bufferInfos[i] = {
+        .buffer = buffers[i],
+        .offset = 0,
+        .range  = VK_WHOLE_SIZE,
+    };
+    writeSets[i] = {
+        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext           = nullptr,
+        .dstSet          = m_set,
+        .dstBinding      = i,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType  = kBindingTypes[i],
+        .pBufferInfo     = &bufferInfos[i],
+    };
+  }
+  vkUpdateDescriptorSets(m_device, kBindingCount, writeSets, 0, nullptr);
+}
+
+void LightClusters::destroy() {
+  vmaUnmapMemory(*m_allocator, m_lights.allocation);
+  m_lightsMapped = nullptr;
+  m_pendingLights.clear();
+  m_staleLights.clear();
+  vmaUnmapMemory(*m_allocator, m_droppedReadback.allocation);
+  m_droppedMapped = nullptr;
+  m_droppedWritten.clear();
+  for (ezvk::AllocatedBuffer* buffer :
+       {&m_lights, &m_view, &m_clusters, &m_droppedReadback})
+    m_allocator->destroyBuffer(*buffer);
+  vkDestroyPipeline(m_device, m_pipeline, nullptr);
+  vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+  vkDestroyDescriptorPool(m_device, m_descPool, nullptr);
+  vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+  m_lightCount = 0;
+}
+
+void LightClusters::setLights(std::span<const Light> lights) {
+  m_lightCount = std::min((u32)lights.size(), m_maxLights);
+  m_pendingLights.assign(lights.begin(), lights.begin() + m_lightCount);
+  std::fill(m_staleLights.begin(), m_staleLights.end(), 1);
+}
+
+void LightClusters::record(VkCommandBuffer cmd, const glm::mat4& view,
+                           const glm::mat4& proj, VkExtent2D extent,
+                           float zNear, float zFar, u32 lightCount,
+                           u64 frame) {
+  // the binning, shading and copies of earlier frames read what is
+  // overwritten
+  VkMemoryBarrier readBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = 0,
+      .dstAccessMask = 0,
+  };
+  vkCmdPipelineBarrier(
+      cmd,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+      1, &readBarrier, 0, nullptr, 0, nullptr);
+
+  // the fence of frame covers the last frame that read the slot's lights
+  u32 slot = (u32)(frame % m_frameCount);
+  if (m_staleLights[slot]) {
+    VkDeviceSize first = (VkDeviceSize)slot * m_maxLights;
+    std::memcpy(m_lightsMapped + first, m_pendingLights.data(),
+                m_pendingLights.size() * sizeof(Light));
+    vmaFlushAllocation(*m_allocator, m_lights.allocation,
+                       first * sizeof(Light),
+                       m_pendingLights.size() * sizeof(Light));
+    m_staleLights[slot] = 0;
+  }
+
+  View clusterView{
+      .view       = view,
+      .invProj    = glm::inverse(proj),
+      .extent     = {extent.width, extent.height},
+      .zNear      = zNear,
+      .zFar       = zFar,
+      .lightCount = std::min(lightCount, m_lightCount),
+      .firstLight = slot * m_maxLights,
+  };
+  vkCmdUpdateBuffer(cmd, m_view.buffer, 0, sizeof(View), &clusterView);
+  // every cluster adds what it drops
+  vkCmdFillBuffer(cmd, m_clusters.buffer, kDroppedOffset, sizeof(u32), 0);
+  VkMemoryBarrier viewBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT |
+                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                       0, 1, &viewBarrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          m_pipelineLayout, 0, 1, &m_set, 0, nullptr);
+  vkCmdDispatch(cmd, kClusterCount, 1, 1);
+
+  VkMemoryBarrier clusterBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                           VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0, 1, &clusterBarrier, 0, nullptr, 0, nullptr);
+
+  VkBufferCopy droppedCopy{
+      .srcOffset = kDroppedOffset,
+      .dstOffset = slot * sizeof(u32),
+      .size      = sizeof(u32),
+  };
+  vkCmdCopyBuffer(cmd, m_clusters.buffer, m_droppedReadback.buffer, 1,
+                  &droppedCopy);
+  VkMemoryBarrier hostBarrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0,
+                       nullptr, 0, nullptr);
+  m_droppedWritten[slot] = 1;
+}
+
+std::optional<u32> LightClusters::droppedLights(u64 frame) const {
+  u32 slot = (u32)(frame % m_frameCount);
+  if (!m_droppedWritten[slot])
+    return std::nullopt;
+  vmaInvalidateAllocation(*m_allocator, m_droppedReadback.allocation,
+                          slot * sizeof(u32), sizeof(u32));
+  return m_droppedMapped[slot];
+}
+
+} // namespace myvk::data
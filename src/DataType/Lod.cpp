@@ -0,0 +1,64 @@
+#include "DataType/Lod.hpp"
+#include "DataType/MeshSimplifier.hpp"
+
+#include <cfloat>
+
+namespace myvk::data {
+
+LodChain LodChain::Build(std::span<const Vertex> vertices,
+                         std::span<const u32>    indices,
+                         const LodOptions&       options) {
+  LodChain             ret;
+  std::span<const u32> previous      = indices;
+  float                previousError = 0.f;
+  while (ret.levels.size() < options.maxLevels) {
+    size_t target = (size_t)(previous.size() / 3 * options.reduction) * 3;
+    if (target / 3 < options.minTriangles)
+      break;
+
+    float            error;
+    std::vector<u32> level =
+        MeshSimplifier::Simplify(vertices, previous, target, FLT_MAX, &error);
+    // stop once the simplifier runs into locked borders and seams
+    if (level.empty() ||
+        level.size() > previous.size() - (previous.size() - target) / 2)
+      break;
+
+    // simplifying a simplified level starts with fresh quadrics, so the
+    // errors add up
+    previousError += error;
+    ret.levels.push_back({
+        .firstIndex = (u32)ret.indices.size(),
+        .indexCount = (u32)level.size(),
+        .error      = previousError,
+    });
+    ret.indices.insert(ret.indices.end(), level.begin(), level.end());
+    previous = {ret.indices.data() + ret.levels.back().firstIndex,
+                level.size()};
+  }
+  return ret;
+}
+
+u32 LodSelector::select(std::span<const LodLevel> levels,
+                        const glm::mat4& proj, float viewportHeight,
+                        float distance) {
+  float pixelsPerUnit = std::abs(proj[1][1]) * viewportHeight * .5f /
+                        std::max(distance, 1e-4f);
+  // levels get coarser and their errors only grow
+  auto coarsestWithin = [&](float pixels) {
+    u32 ret = 0;
+    while (ret < levels.size() && levels[ret].error * pixelsPerUnit <= pixels)
+      ++ret;
+    return ret;
+  };
+
+  u32 allowed = coarsestWithin(pixelError);
+  if (allowed < m_level)
+    m_level = allowed;
+  else
+    m_level =
+        std::max(m_level, coarsestWithin(pixelError * (1.f - hysteresis)));
+  return m_level;
+}
+
+} // namespace myvk::data
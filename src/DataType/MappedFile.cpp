@@ -0,0 +1,126 @@
+#include "DataType/MappedFile.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace myvk::data {
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    m_data   = std::exchange(other.m_data, nullptr);
+    m_size   = std::exchange(other.m_size, 0);
+    m_isOpen = std::exchange(other.m_isOpen, false);
+#ifdef _WIN32
+    m_file    = std::exchange(other.m_file, nullptr);
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(ccstr filename) {
+  close();
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file   = file;
+  m_size   = (size_t)fileSize.QuadPart;
+  m_isOpen = true;
+  if (m_size == 0)
+    return true;
+
+  m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping)
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!m_data) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle(m_mapping);
+  if (m_file)
+    CloseHandle(m_file);
+  m_data    = nullptr;
+  m_mapping = nullptr;
+  m_file    = nullptr;
+  m_size    = 0;
+  m_isOpen  = false;
+}
+
+#else
+
+bool MappedFile::open(ccstr filename) {
+  close();
+  int fd = ::open(filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  m_size   = (size_t)st.st_size;
+  m_isOpen = true;
+  if (m_size > 0) {
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      m_size   = 0;
+      m_isOpen = false;
+      return false;
+    }
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = data;
+  }
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_data)
+    munmap(m_data, m_size);
+  m_data   = nullptr;
+  m_size   = 0;
+  m_isOpen = false;
+}
+
+#endif
+
+} // namespace myvk::data
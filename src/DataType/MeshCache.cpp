@@ -0,0 +1,416 @@
+#include "DataType/MeshCache.hpp"
+#include "DataType/IndexBuffer.hpp"
+#include "Hash.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+namespace fs = std::filesystem;
+
+namespace myvk::data {
+
+namespace {
+constexpr u64 kPayloadAlignment = 16;
+
+constexpr u64 alignUp(u64 value) {
+  return (value + kPayloadAlignment - 1) & ~(kPayloadAlignment - 1);
+}
+
+// The end of count elements of size bytes at offset, nothing if offset is
+// not aligned or they do not fit into the file. Header fields come from
+// disk, so this is written not to overflow for any of them.
+std::optional<u64> sectionEnd(u64 offset, u64 count, u64 size, u64 fileSize,
+                              u64 alignment = kPayloadAlignment) {
+  if (offset % alignment != 0 || offset > fileSize ||
+      count > (fileSize - offset) / size)
+    return std::nullopt;
+  return offset + count * size;
+}
+
+bool statSource(ccstr sourcePath, u64& size, i64& time) {
+  std::error_code ec;
+  size = fs::file_size(sourcePath, ec);
+  if (ec)
+    return false;
+  time = fs::last_write_time(sourcePath, ec).time_since_epoch().count();
+  return !ec;
+}
+} // namespace
+
+std::string MeshCache::PathFor(ccstr sourcePath) {
+  return std::string(sourcePath) + ".meshcache";
+}
+
+u64 MeshCache::HashPayload(std::span<const Vertex>    vertices,
+                           std::span<const std::byte> indexBytes,
+                           std::span<const std::byte> lodBytes) {
+  u64 hash = HashBytesParallel(vertices.data(), vertices.size_bytes());
+  hash     = HashBytesParallel(indexBytes.data(), indexBytes.size(), hash);
+  if (lodBytes.empty())
+    return hash;
+  return HashBytesParallel(lodBytes.data(), lodBytes.size(), hash);
+}
+
+u64 MeshCache::HashSource(ccstr sourcePath) {
+  MappedFile source;
+  if (!source.open(sourcePath))
+    return 0;
+  return HashBytesParallel(source.data(), source.size());
+}
+
+bool MeshCache::Write(ccstr sourcePath, u64 sourceHash,
+                      std::span<const Vertex> vertices,
+                      std::span<const u32> indices, const glm::vec3& boundsMin,
+                      const glm::vec3& boundsMax, u32 flags,
+                      const LodChain& lods) {
+  MeshCacheHeader header{
+      .magic        = kMagic,
+      .version      = kVersion,
+      .sourceHash   = sourceHash,
+      .vertexStride = sizeof(Vertex),
+      .flags        = flags,
+      .vertexCount  = vertices.size(),
+      .indexCount   = indices.size(),
+      .boundsMin    = boundsMin,
+      .boundsMax    = boundsMax,
+  };
+  if (!statSource(sourcePath, header.sourceSize, header.sourceTime))
+    return false;
+
+  std::vector<u8>            encoded;
+  std::span<const std::byte> indexBytes = std::as_bytes(indices);
+  if (flags & MeshCacheHeader::eCompressedIndices) {
+    encoded    = EncodeIndices(indices);
+    indexBytes = std::as_bytes(std::span<const u8>(encoded));
+  }
+
+  header.vertexOffset = alignUp(sizeof(MeshCacheHeader));
+  header.indexOffset  = alignUp(header.vertexOffset + vertices.size_bytes());
+  header.indexBytes   = indexBytes.size();
+
+  std::vector<std::byte> lodBytes;
+  if (flags & MeshCacheHeader::eLods) {
+    auto levels  = std::as_bytes(std::span(lods.levels));
+    auto indices = std::as_bytes(std::span(lods.indices));
+    lodBytes.assign(levels.begin(), levels.end());
+    lodBytes.insert(lodBytes.end(), indices.begin(), indices.end());
+    header.lodOffset     = alignUp(header.indexOffset + indexBytes.size());
+    header.lodIndexCount = lods.indices.size();
+    header.lodLevelCount = (u32)lods.levels.size();
+  }
+
+  header.payloadHash = HashPayload(vertices, indexBytes, lodBytes);
+
+  // write to a temporary file so a crash never leaves a torn cache behind
+  std::string path    = PathFor(sourcePath);
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+      return false;
+    char padding[kPayloadAlignment]{};
+    out.write((const char*)&header, sizeof(header));
+    out.write(padding, header.vertexOffset - sizeof(header));
+    out.write((const char*)vertices.data(), vertices.size_bytes());
+    out.write(padding, header.indexOffset - header.vertexOffset -
+                           vertices.size_bytes());
+    out.write((const char*)indexBytes.data(), indexBytes.size());
+    // pad even for a chain without levels, open expects the file to end at
+    // the aligned lodOffset
+    if (flags & MeshCacheHeader::eLods) {
+      out.write(padding, header.lodOffset - header.indexOffset -
+                             indexBytes.size());
+      out.write((const char*)lodBytes.data(), lodBytes.size());
+    }
+    if (!out)
+      return false;
+  }
+
+  std::error_code ec;
+  fs::rename(tmpPath, path, ec);
+  if (ec) {
+    fs::remove(tmpPath, ec);
+    return false;
+  }
+  return true;
+}
+
+bool MeshCache::IsCurrent(ccstr sourcePath) {
+  u64 sourceSize;
+  i64 sourceTime;
+  if (!statSource(sourcePath, sourceSize, sourceTime))
+    return false;
+
+  MeshCacheHeader header;
+  std::ifstream   in(PathFor(sourcePath), std::ios::binary);
+  if (!in.read((char*)&header, sizeof(header)))
+    return false;
+  return header.magic == kMagic && header.version == kVersion &&
+         header.vertexStride == sizeof(Vertex) &&
+         header.sourceSize == sourceSize && header.sourceTime == sourceTime;
+}
+
+bool MeshCache::open(ccstr sourcePath) {
+  close();
+
+  u64 sourceSize;
+  i64 sourceTime;
+  if (!statSource(sourcePath, sourceSize, sourceTime))
+    return false;
+
+  std::string     path = PathFor(sourcePath);
+  MeshCacheHeader header;
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.read((char*)&header, sizeof(header)))
+      return false;
+  }
+
+  if (header.magic != kMagic || header.version != kVersion ||
+      header.vertexStride != sizeof(Vertex) ||
+      header.sourceSize != sourceSize) {
+    return false;
+  }
+
+  if (header.sourceTime != sourceTime) {
+    // touched but maybe unchanged, fall back to the content hash
+    if (HashSource(sourcePath) != header.sourceHash)
+      return false;
+    header.sourceTime = sourceTime;
+    std::fstream patch(path, std::ios::binary | std::ios::in | std::ios::out);
+    patch.seekp(offsetof(MeshCacheHeader, sourceTime));
+    patch.write((const char*)&header.sourceTime, sizeof(header.sourceTime));
+  }
+
+  if (!m_file.open(path.c_str()))
+    return false;
+
+  bool compressed = header.flags & MeshCacheHeader::eCompressedIndices;
+  bool hasLods    = header.flags & MeshCacheHeader::eLods;
+  u64  fileSize   = m_file.size();
+  auto vertexEnd  = sectionEnd(header.vertexOffset, header.vertexCount,
+                               sizeof(Vertex), fileSize);
+  auto indexEnd   =
+      sectionEnd(header.indexOffset, header.indexBytes, 1, fileSize);
+  // the level table, then its indices right behind it
+  std::optional<u64> lodEnd = indexEnd;
+  if (hasLods) {
+    lodEnd = sectionEnd(header.lodOffset, header.lodLevelCount,
+                        sizeof(LodLevel), fileSize);
+    if (lodEnd)
+      lodEnd = sectionEnd(*lodEnd, header.lodIndexCount, sizeof(u32),
+                          fileSize, alignof(u32));
+  }
+  if (fileSize < sizeof(MeshCacheHeader) || !vertexEnd || !indexEnd ||
+      !lodEnd || header.vertexOffset < sizeof(MeshCacheHeader) ||
+      *vertexEnd > header.indexOffset ||
+      (hasLods && header.lodOffset < *indexEnd) || *lodEnd != fileSize ||
+      // every index takes at least one byte
+      header.indexCount > header.indexBytes ||
+      (!compressed && header.indexBytes != header.indexCount * sizeof(u32))) {
+    LOG_WARN("mesh cache {} is truncated", path);
+    close();
+    return false;
+  }
+  u64 lodBytes = hasLods ? *lodEnd - header.lodOffset : 0;
+
+  std::span<const std::byte> indexBytes{
+      reinterpret_cast<const std::byte*>(m_file.data() + header.indexOffset),
+      (size_t)header.indexBytes};
+  std::span<const std::byte> lodSection{
+      reinterpret_cast<const std::byte*>(m_file.data() + header.lodOffset),
+      (size_t)lodBytes};
+  if (HashPayload(vertices(), indexBytes, lodSection) != header.payloadHash) {
+    LOG_WARN("mesh cache {} is corrupt", path);
+    close();
+    return false;
+  }
+
+  for (const LodLevel& level : lodLevels()) {
+    if ((u64)level.firstIndex + level.indexCount > header.lodIndexCount) {
+      LOG_WARN("mesh cache {} has invalid lod levels", path);
+      close();
+      return false;
+    }
+  }
+
+  if (compressed) {
+    m_decodedIndices.resize(header.indexCount);
+    if (!DecodeIndices({(const u8*)indexBytes.data(), indexBytes.size()},
+                       m_decodedIndices)) {
+      LOG_WARN("mesh cache {} has invalid indices", path);
+      close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void MeshCache::close() {
+  m_file.close();
+  m_decodedIndices = {};
+}
+
+std::span<const Vertex> MeshCache::vertices() const {
+  const MeshCacheHeader& h = header();
+  return {reinterpret_cast<const Vertex*>(m_file.data() + h.vertexOffset),
+          (size_t)h.vertexCount};
+}
+
+std::span<const u32> MeshCache::indices() const {
+  const MeshCacheHeader& h = header();
+  if (h.flags & MeshCacheHeader::eCompressedIndices)
+    return m_decodedIndices;
+  return {reinterpret_cast<const u32*>(m_file.data() + h.indexOffset),
+          (size_t)h.indexCount};
+}
+
+std::span<const LodLevel> MeshCache::lodLevels() const {
+  const MeshCacheHeader& h = header();
+  if (!(h.flags & MeshCacheHeader::eLods))
+    return {};
+  return {reinterpret_cast<const LodLevel*>(m_file.data() + h.lodOffset),
+          (size_t)h.lodLevelCount};
+}
+
+std::span<const u32> MeshCache::lodIndices() const {
+  const MeshCacheHeader& h = header();
+  if (!(h.flags & MeshCacheHeader::eLods))
+    return {};
+  return {reinterpret_cast<const u32*>(m_file.data() + h.lodOffset +
+                                       h.lodLevelCount * sizeof(LodLevel)),
+          (size_t)h.lodIndexCount};
+}
+
+MeshCacheWriter::~MeshCacheWriter() {
+  abort();
+}
+
+bool MeshCacheWriter::begin(ccstr sourcePath) {
+  abort();
+  if (!statSource(sourcePath, m_sourceSize, m_sourceTime))
+    return false;
+
+  m_sourcePath = sourcePath;
+  m_vertexPath = MeshCache::PathFor(sourcePath) + ".tmp";
+  m_indexPath  = m_vertexPath + ".idx";
+  m_vertexOut.open(m_vertexPath, std::ios::binary | std::ios::trunc);
+  m_indexOut.open(m_indexPath, std::ios::binary | std::ios::trunc);
+  m_vertexCount = 0;
+  m_indexCount  = 0;
+  m_active      = true;
+  if (!m_vertexOut || !m_indexOut) {
+    abort();
+    return false;
+  }
+
+  // reserve the header, it is written once the counts are known
+  char placeholder[alignUp(sizeof(MeshCacheHeader))]{};
+  m_vertexOut.write(placeholder, sizeof(placeholder));
+  return true;
+}
+
+void MeshCacheWriter::appendVertices(std::span<const Vertex> vertices) {
+  m_vertexOut.write((const char*)vertices.data(), vertices.size_bytes());
+  m_vertexCount += vertices.size();
+}
+
+void MeshCacheWriter::appendIndices(std::span<const u32> indices, u32 base) {
+  const u32* data = indices.data();
+  if (base != 0) {
+    m_rebased.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+      m_rebased[i] = indices[i] + base;
+    data = m_rebased.data();
+  }
+  m_indexOut.write((const char*)data, indices.size_bytes());
+  m_indexCount += indices.size();
+}
+
+bool MeshCacheWriter::finish(const glm::vec3& boundsMin,
+                             const glm::vec3& boundsMax) {
+  if (!m_active)
+    return false;
+
+  MeshCacheHeader header{
+      .magic        = MeshCache::kMagic,
+      .version      = MeshCache::kVersion,
+      .sourceSize   = m_sourceSize,
+      .sourceTime   = m_sourceTime,
+      .sourceHash   = MeshCache::HashSource(m_sourcePath.c_str()),
+      .vertexStride = sizeof(Vertex),
+      .flags        = 0,
+      .vertexCount  = m_vertexCount,
+      .indexCount   = m_indexCount,
+      .vertexOffset = alignUp(sizeof(MeshCacheHeader)),
+      .indexBytes   = m_indexCount * sizeof(u32),
+      .boundsMin    = boundsMin,
+      .boundsMax    = boundsMax,
+  };
+  header.indexOffset =
+      alignUp(header.vertexOffset + m_vertexCount * sizeof(Vertex));
+
+  char padding[kPayloadAlignment]{};
+  m_vertexOut.write(padding, header.indexOffset - header.vertexOffset -
+                                 m_vertexCount * sizeof(Vertex));
+  m_indexOut.close();
+  {
+    std::ifstream     indexIn(m_indexPath, std::ios::binary);
+    std::vector<char> block(4 << 20);
+    while (indexIn.read(block.data(), block.size()) || indexIn.gcount() > 0)
+      m_vertexOut.write(block.data(), indexIn.gcount());
+  }
+  m_vertexOut.close();
+  if (!m_vertexOut) {
+    abort();
+    return false;
+  }
+
+  {
+    MappedFile written;
+    if (!written.open(m_vertexPath.c_str())) {
+      abort();
+      return false;
+    }
+    header.payloadHash = MeshCache::HashPayload(
+        {(const Vertex*)(written.data() + header.vertexOffset),
+         (size_t)m_vertexCount},
+        {(const std::byte*)(written.data() + header.indexOffset),
+         (size_t)header.indexBytes});
+  }
+
+  {
+    std::fstream patch(m_vertexPath,
+                       std::ios::binary | std::ios::in | std::ios::out);
+    patch.write((const char*)&header, sizeof(header));
+    if (!patch) {
+      abort();
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  fs::remove(m_indexPath, ec);
+  fs::rename(m_vertexPath, MeshCache::PathFor(m_sourcePath.c_str()), ec);
+  if (ec) {
+    abort();
+    return false;
+  }
+  m_active = false;
+  return true;
+}
+
+void MeshCacheWriter::abort() {
+  if (!m_active)
+    return;
+  m_vertexOut.close();
+  m_indexOut.close();
+  std::error_code ec;
+  fs::remove(m_vertexPath, ec);
+  fs::remove(m_indexPath, ec);
+  m_active = false;
+}
+
+} // namespace myvk::data
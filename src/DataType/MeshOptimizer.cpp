@@ -0,0 +1,373 @@
+#include "DataType/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace myvk::data {
+
+namespace {
+struct WeldKey {
+  i32 pos[3];
+  i32 norm[3];
+  i32 uv[2];
+
+  bool operator==(const WeldKey&) const = default;
+};
+
+inline i32 quantize(float value, float invEpsilon) {
+  // converting a float outside of i32 is undefined, so far out values are
+  // clamped to the floats at its ends and weld with each other
+  constexpr float kMin = -2147483648.f, kMax = 2147483520.f;
+  float           q    = std::floor(value * invEpsilon + 0.5f);
+  return std::isnan(q) ? 0 : (i32)std::clamp(q, kMin, kMax);
+}
+
+WeldKey weldKeyOf(const Vertex& vertex, float invPosEpsilon,
+                  float invAttrEpsilon) {
+  WeldKey key;
+  for (int i = 0; i < 3; ++i) {
+    key.pos[i]  = quantize(vertex.pos[i], invPosEpsilon);
+    key.norm[i] = quantize(vertex.norm[i], invAttrEpsilon);
+  }
+  key.uv[0] = quantize(vertex.uv[0], invAttrEpsilon);
+  key.uv[1] = quantize(vertex.uv[1], invAttrEpsilon);
+  return key;
+}
+
+u64 hashWeldKey(const WeldKey& key) {
+  const i32* words = reinterpret_cast<const i32*>(&key);
+  u64        h     = 0xCBF29CE484222325ull;
+  for (size_t i = 0; i < sizeof(WeldKey) / sizeof(i32); ++i) {
+    h ^= (u32)words[i];
+    h *= 0x100000001B3ull;
+  }
+  return h ^ (h >> 29);
+}
+
+// drops triangles that use the same vertex twice, returns the new length
+size_t removeDegenerates(std::vector<u32>& indices) {
+  size_t out = 0;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    u32 a = indices[i], b = indices[i + 1], c = indices[i + 2];
+    if (a == b || b == c || a == c)
+      continue;
+    indices[out++] = a;
+    indices[out++] = b;
+    indices[out++] = c;
+  }
+  indices.resize(out);
+  return out;
+}
+} // namespace
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(std::span<const u32> indices,
+                                                   size_t vertexCount,
+                                                   u32    cacheSize) {
+  VertexCacheStats stats{0.f, 0.f};
+  if (indices.empty() || vertexCount == 0)
+    return stats;
+
+  // FIFO cache: a vertex is resident while fewer than cacheSize vertices
+  // were inserted after it
+  std::vector<u32> insertedAt(vertexCount, 0);
+  u32              time   = cacheSize + 1;
+  size_t           misses = 0, used = 0;
+  for (u32 index : indices) {
+    if (insertedAt[index] == 0)
+      ++used;
+    if (time - insertedAt[index] > cacheSize) {
+      insertedAt[index] = time++;
+      ++misses;
+    }
+  }
+
+  stats.acmr = (float)misses / (float)(indices.size() / 3);
+  stats.atvr = (float)misses / (float)used;
+  return stats;
+}
+
+void MeshOptimizer::WeldVertices(std::vector<Vertex>& vertices,
+                                 std::vector<u32>& indices,
+                                 float positionEpsilon,
+                                 float attributeEpsilon) {
+  if (vertices.empty() || positionEpsilon <= 0.f || attributeEpsilon <= 0.f)
+    return;
+
+  glm::vec3 boundsMin = vertices[0].pos, boundsMax = vertices[0].pos;
+  for (const Vertex& vertex : vertices) {
+    boundsMin = glm::min(boundsMin, vertex.pos);
+    boundsMax = glm::max(boundsMax, vertex.pos);
+  }
+  float diagonal = glm::length(boundsMax - boundsMin);
+  if (diagonal <= 0.f)
+    return;
+  float invPosEpsilon  = 1.f / (positionEpsilon * diagonal);
+  float invAttrEpsilon = 1.f / attributeEpsilon;
+
+  // vertices that fall into the same quantization cell are merged into the
+  // first of them, sorting by hash keeps the memory flat
+  std::vector<std::pair<u64, u32>> order(vertices.size());
+  for (u32 i = 0; i < vertices.size(); ++i) {
+    order[i] = {hashWeldKey(weldKeyOf(vertices[i], invPosEpsilon,
+                                      invAttrEpsilon)),
+                i};
+  }
+  std::sort(order.begin(), order.end());
+
+  std::vector<u32> remap(vertices.size());
+  std::iota(remap.begin(), remap.end(), 0);
+  for (size_t begin = 0; begin < order.size();) {
+    size_t end = begin + 1;
+    while (end < order.size() && order[end].first == order[begin].first)
+      ++end;
+    for (size_t i = begin; i < end; ++i) {
+      u32 v = order[i].second;
+      if (remap[v] != v)
+        continue;
+      WeldKey key = weldKeyOf(vertices[v], invPosEpsilon, invAttrEpsilon);
+      for (size_t j = i + 1; j < end; ++j) {
+        u32 other = order[j].second;
+        if (remap[other] == other &&
+            weldKeyOf(vertices[other], invPosEpsilon, invAttrEpsilon) == key)
+          remap[other] = v;
+      }
+    }
+    begin = end;
+  }
+
+  for (u32& index : indices)
+    index = remap[index];
+  removeDegenerates(indices);
+  // the now unused vertices are dropped by OptimizeVertexFetch
+}
+
+std::vector<u32> MeshOptimizer::OptimizeVertexCache(std::vector<u32>& indices,
+                                                    size_t vertexCount,
+                                                    u32    cacheSize) {
+  std::vector<u32> clusters;
+  size_t           triangleCount = indices.size() / 3;
+  if (triangleCount == 0)
+    return clusters;
+
+  // vertex -> triangle adjacency
+  std::vector<u32> live(vertexCount, 0);
+  for (u32 index : indices)
+    ++live[index];
+  std::vector<u32> offsets(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; ++v)
+    offsets[v + 1] = offsets[v] + live[v];
+  std::vector<u32> adjacency(indices.size());
+  {
+    std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+      for (int k = 0; k < 3; ++k)
+        adjacency[fill[indices[t * 3 + k]]++] = (u32)t;
+  }
+
+  std::vector<u32>  cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<u32>  deadEnd, candidates;
+  std::vector<u32>  result;
+  result.reserve(indices.size());
+  deadEnd.reserve(indices.size());
+
+  u32    time   = cacheSize + 1;
+  size_t cursor = 0;
+  auto   skipDeadEnd = [&]() -> i64 {
+    while (!deadEnd.empty()) {
+      u32 v = deadEnd.back();
+      deadEnd.pop_back();
+      if (live[v] > 0)
+        return v;
+    }
+    for (; cursor < vertexCount; ++cursor)
+      if (live[cursor] > 0)
+        return (i64)cursor;
+    return -1;
+  };
+
+  i64 fanning = skipDeadEnd();
+  clusters.push_back(0);
+  while (fanning >= 0) {
+    // emit every remaining triangle around the fanning vertex
+    candidates.clear();
+    for (u32 a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+      u32 t = adjacency[a];
+      if (emitted[t])
+        continue;
+      emitted[t] = true;
+      for (int k = 0; k < 3; ++k) {
+        u32 v = indices[t * 3 + k];
+        result.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time - cacheTime[v] > cacheSize)
+          cacheTime[v] = time++;
+      }
+    }
+
+    // prefer a vertex that will still be cached after its fan is emitted
+    i64 best = -1, bestPriority = -1;
+    for (u32 v : candidates) {
+      if (live[v] == 0)
+        continue;
+      i64 priority = 0;
+      if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+        priority = time - cacheTime[v];
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        best         = v;
+      }
+    }
+    if (best < 0) {
+      best = skipDeadEnd();
+      u32 start = (u32)(result.size() / 3);
+      if (best >= 0 && start != clusters.back())
+        clusters.push_back(start);
+    }
+    fanning = best;
+  }
+
+  indices.swap(result);
+  return clusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw(const std::vector<Vertex>& vertices,
+                                     std::vector<u32>&          indices,
+                                     const std::vector<u32>&    clusters,
+                                     u32 cacheSize, float threshold) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0 || clusters.empty())
+    return;
+
+  // Split the cache clusters further wherever the miss ratio so far is
+  // already close to the whole mesh's, so reordering them costs little
+  // cache efficiency.
+  float target =
+      threshold * AnalyzeVertexCache(indices, vertices.size(), cacheSize).acmr;
+  std::vector<u32> splits;
+  {
+    std::vector<u32> insertedAt(vertices.size(), 0);
+    u32              time = cacheSize + 1;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+      u32 end = c + 1 < clusters.size() ? clusters[c + 1] : (u32)triangleCount;
+      splits.push_back(clusters[c]);
+      u32 misses = 0, triangles = 0;
+      time += cacheSize + 1;
+      for (u32 t = clusters[c]; t < end; ++t) {
+        for (int k = 0; k < 3; ++k) {
+          u32 v = indices[t * 3 + k];
+          if (time - insertedAt[v] > cacheSize) {
+            insertedAt[v] = time++;
+            ++misses;
+          }
+        }
+        ++triangles;
+        if (t + 1 < end && (float)misses <= target * (float)triangles) {
+          splits.push_back(t + 1);
+          misses = triangles = 0;
+          time += cacheSize + 1;
+        }
+      }
+    }
+  }
+
+  // clusters facing away from the mesh center are drawn first, they are
+  // the most likely to occlude the rest
+  struct Cluster {
+    u32       begin, end;
+    glm::vec3 centroid;
+    glm::vec3 normal;
+    float     area;
+    float     sortKey;
+  };
+  std::vector<Cluster> sorted(splits.size());
+  glm::vec3            meshCentroid{0.f};
+  float                meshArea = 0.f;
+  for (size_t c = 0; c < splits.size(); ++c) {
+    Cluster& cluster = sorted[c];
+    cluster.begin    = splits[c];
+    cluster.end = c + 1 < splits.size() ? splits[c + 1] : (u32)triangleCount;
+    cluster.centroid = cluster.normal = glm::vec3{0.f};
+    cluster.area                      = 0.f;
+    for (u32 t = cluster.begin; t < cluster.end; ++t) {
+      const glm::vec3& p0   = vertices[indices[t * 3 + 0]].pos;
+      const glm::vec3& p1   = vertices[indices[t * 3 + 1]].pos;
+      const glm::vec3& p2   = vertices[indices[t * 3 + 2]].pos;
+      glm::vec3        n    = glm::cross(p1 - p0, p2 - p0);
+      float            area = glm::length(n);
+      cluster.centroid += (p0 + p1 + p2) * (area / 3.f);
+      cluster.normal += n;
+      cluster.area += area;
+    }
+    meshCentroid += cluster.centroid;
+    meshArea += cluster.area;
+    if (cluster.area > 0.f)
+      cluster.centroid /= cluster.area;
+  }
+  if (meshArea > 0.f)
+    meshCentroid /= meshArea;
+
+  for (Cluster& cluster : sorted) {
+    float length    = glm::length(cluster.normal);
+    cluster.sortKey = length > 0.f ? glm::dot(cluster.centroid - meshCentroid,
+                                              cluster.normal / length)
+                                   : 0.f;
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Cluster& lhs, const Cluster& rhs) {
+                     return lhs.sortKey > rhs.sortKey;
+                   });
+
+  std::vector<u32> result;
+  result.reserve(indices.size());
+  for (const Cluster& cluster : sorted)
+    result.insert(result.end(), indices.begin() + cluster.begin * 3,
+                  indices.begin() + cluster.end * 3);
+  indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices,
+                                        std::vector<u32>&    indices) {
+  constexpr u32    kUnused = ~0u;
+  std::vector<u32> remap(vertices.size(), kUnused);
+  u32              next = 0;
+  for (u32& index : indices) {
+    if (remap[index] == kUnused)
+      remap[index] = next++;
+    index = remap[index];
+  }
+
+  std::vector<Vertex> result(next);
+  for (size_t v = 0; v < vertices.size(); ++v)
+    if (remap[v] != kUnused)
+      result[remap[v]] = vertices[v];
+  vertices.swap(result);
+}
+
+void MeshOptimizer::Optimize(std::vector<Vertex>& vertices,
+                             std::vector<u32>&    indices,
+                             const MeshOptimizeOptions& options) {
+  VertexCacheStats before =
+      AnalyzeVertexCache(indices, vertices.size(), options.cacheSize);
+  size_t vertexCount = vertices.size();
+
+  WeldVertices(vertices, indices, options.weldPositionEpsilon,
+               options.weldAttributeEpsilon);
+  std::vector<u32> clusters =
+      OptimizeVertexCache(indices, vertices.size(), options.cacheSize);
+  OptimizeOverdraw(vertices, indices, clusters, options.cacheSize,
+                   options.overdrawThreshold);
+  OptimizeVertexFetch(vertices, indices);
+
+  VertexCacheStats after =
+      AnalyzeVertexCache(indices, vertices.size(), options.cacheSize);
+  LOG_INFO("mesh optimize: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, "
+           "ATVR {:.3f} -> {:.3f}",
+           vertexCount, vertices.size(), before.acmr, after.acmr, before.atvr,
+           after.atvr);
+}
+
+} // namespace myvk::data
@@ -0,0 +1,313 @@
+#include "DataType/MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cstring>
+#include <numeric>
+
+namespace myvk::data {
+
+namespace {
+// sum of squared distances to a set of planes, weighted by triangle area
+struct Quadric {
+  float a00, a11, a22, a01, a02, a12;
+  float b0, b1, b2, c;
+  float weight;
+
+  Quadric& operator+=(const Quadric& other) {
+    a00 += other.a00, a11 += other.a11, a22 += other.a22;
+    a01 += other.a01, a02 += other.a02, a12 += other.a12;
+    b0 += other.b0, b1 += other.b1, b2 += other.b2;
+    c += other.c;
+    weight += other.weight;
+    return *this;
+  }
+};
+
+Quadric planeQuadric(const glm::vec3& n, float d, float weight) {
+  return {
+      weight * n.x * n.x, weight * n.y * n.y, weight * n.z * n.z,
+      weight * n.x * n.y, weight * n.x * n.z, weight * n.y * n.z,
+      weight * n.x * d,   weight * n.y * d,   weight * n.z * d,
+      weight * d * d,     weight,
+  };
+}
+
+// mean squared distance of p to the planes of q
+float quadricError(const Quadric& q, const glm::vec3& p) {
+  float r = q.a00 * p.x * p.x + q.a11 * p.y * p.y + q.a22 * p.z * p.z +
+            2.f * (q.a01 * p.x * p.y + q.a02 * p.x * p.z + q.a12 * p.y * p.z) +
+            2.f * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+  return std::abs(r) / std::max(q.weight, 1e-30f);
+}
+
+struct Collapse {
+  float cost;
+  u32   from, to;
+};
+
+u32 hashPosition(const glm::vec3& pos) {
+  u32 bits[3];
+  std::memcpy(bits, &pos, sizeof(bits));
+  u32 h =
+      bits[0] * 0x8DA6B343u ^ bits[1] * 0xD8163841u ^ bits[2] * 0xCB1AB31Fu;
+  return h ^ (h >> 15);
+}
+
+float attributeDistance(const Vertex& lhs, const Vertex& rhs) {
+  glm::vec3 dn  = lhs.norm - rhs.norm;
+  glm::vec2 duv = lhs.uv - rhs.uv;
+  return glm::dot(dn, dn) + glm::dot(duv, duv);
+}
+} // namespace
+
+std::vector<u32> MeshSimplifier::Simplify(std::span<const Vertex> vertices,
+                                          std::span<const u32>    indices,
+                                          size_t targetIndexCount,
+                                          float targetError,
+                                          float* resultError) {
+  std::vector<u32> ret(indices.begin(),
+                       indices.begin() + indices.size() / 3 * 3);
+  if (resultError)
+    *resultError = 0.f;
+  if (ret.size() <= targetIndexCount)
+    return ret;
+
+  // only the vertices in use take part and ret holds local ids until the
+  // end, coarse levels of a big mesh use a small part of its vertices
+  std::vector<u32> used;
+  {
+    std::vector<u32> local(vertices.size(), ~0u);
+    for (u32& index : ret) {
+      if (local[index] == ~0u) {
+        local[index] = (u32)used.size();
+        used.push_back(index);
+      }
+      index = local[index];
+    }
+  }
+  u32  vertexCount = (u32)used.size();
+  auto vertexAt    = [&](u32 v) -> const Vertex& {
+    return vertices[used[v]];
+  };
+
+  // vertices with the same position share a position id, the first of them,
+  // and are linked in a ring through nextCopy
+  std::vector<u32> positionId(vertexCount), nextCopy(vertexCount);
+  {
+    u32              tableSize = std::bit_ceil(vertexCount * 2);
+    std::vector<u32> table(tableSize, ~0u);
+    for (u32 v = 0; v < vertexCount; ++v) {
+      u32 slot = hashPosition(vertexAt(v).pos) & (tableSize - 1);
+      while (table[slot] != ~0u &&
+             vertexAt(table[slot]).pos != vertexAt(v).pos)
+        slot = (slot + 1) & (tableSize - 1);
+      if (table[slot] == ~0u) {
+        table[slot]   = v;
+        positionId[v] = v;
+        nextCopy[v]   = v;
+      } else {
+        u32 first       = table[slot];
+        positionId[v]   = first;
+        nextCopy[v]     = nextCopy[first];
+        nextCopy[first] = v;
+      }
+    }
+  }
+
+  // positions are scaled into the unit cube to keep the quadrics precise
+  glm::vec3 boundsMin = vertexAt(0).pos, boundsMax = boundsMin;
+  for (u32 v = 0; v < vertexCount; ++v) {
+    boundsMin = glm::min(boundsMin, vertexAt(v).pos);
+    boundsMax = glm::max(boundsMax, vertexAt(v).pos);
+  }
+  glm::vec3 extent = boundsMax - boundsMin;
+  float     scale  = std::max({extent.x, extent.y, extent.z, 1e-20f});
+  std::vector<glm::vec3> positions(vertexCount);
+  for (u32 v = 0; v < vertexCount; ++v)
+    positions[v] = (vertexAt(v).pos - boundsMin) / scale;
+
+  // triangles around every position id, rebuilt on every pass
+  std::vector<u32> adjacencyOffsets(vertexCount + 1), adjacency;
+  auto             buildAdjacency = [&]() {
+    std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+    for (u32 index : ret)
+      ++adjacencyOffsets[positionId[index] + 1];
+    for (u32 v = 0; v < vertexCount; ++v)
+      adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    adjacency.resize(ret.size());
+    std::vector<u32> fill(adjacencyOffsets.begin(),
+                          adjacencyOffsets.end() - 1);
+    for (u32 i = 0; i < ret.size(); ++i)
+      adjacency[fill[positionId[ret[i]]]++] = i / 3;
+  };
+  auto trianglesAround = [&](u32 position) {
+    return std::span<const u32>(adjacency.data() + adjacencyOffsets[position],
+                                adjacency.data() +
+                                    adjacencyOffsets[position + 1]);
+  };
+  buildAdjacency();
+
+  std::vector<Quadric> quadrics(vertexCount, Quadric{});
+  std::vector<u8>      locked(vertexCount, 0);
+  for (u32 i = 0; i < ret.size(); i += 3) {
+    u32 p[3] = {positionId[ret[i]], positionId[ret[i + 1]],
+                positionId[ret[i + 2]]};
+    glm::vec3 n = glm::cross(positions[p[1]] - positions[p[0]],
+                             positions[p[2]] - positions[p[0]]);
+    float     area2 = glm::length(n);
+    if (area2 > 0.f) {
+      n /= area2;
+      Quadric q = planeQuadric(n, -glm::dot(n, positions[p[0]]), area2 * .5f);
+      for (u32 k = 0; k < 3; ++k)
+        quadrics[p[k]] += q;
+    }
+
+    // a border edge has no twin running the other way
+    for (u32 k = 0; k < 3; ++k) {
+      u32  a = p[k], b = p[(k + 1) % 3];
+      bool twin = false;
+      for (u32 t : trianglesAround(b)) {
+        if (twin)
+          break;
+        for (u32 j = 0; j < 3 && !twin; ++j) {
+          twin = positionId[ret[t * 3 + j]] == b &&
+                 positionId[ret[t * 3 + (j + 1) % 3]] == a;
+        }
+      }
+      if (!twin)
+        locked[a] = locked[b] = 1;
+    }
+  }
+
+  // a collapse fails if it turns a remaining triangle around
+  auto flips = [&](u32 from, u32 to) {
+    for (u32 t : trianglesAround(from)) {
+      u32 p[3] = {positionId[ret[t * 3]], positionId[ret[t * 3 + 1]],
+                  positionId[ret[t * 3 + 2]]};
+      if (p[0] == to || p[1] == to || p[2] == to)
+        continue;
+      glm::vec3 before = glm::cross(positions[p[1]] - positions[p[0]],
+                                    positions[p[2]] - positions[p[0]]);
+      for (u32& position : p) {
+        if (position == from)
+          position = to;
+      }
+      glm::vec3 after = glm::cross(positions[p[1]] - positions[p[0]],
+                                   positions[p[2]] - positions[p[0]]);
+      if (glm::dot(before, after) <=
+          .25f * glm::length(before) * glm::length(after))
+        return true;
+    }
+    return false;
+  };
+
+  float maxCost = targetError / scale;
+  maxCost *= maxCost;
+  float worstCost = 0.f;
+
+  // where every vertex went, collapsed vertices are never referenced again
+  std::vector<u32> vertexMap(vertexCount);
+  std::iota(vertexMap.begin(), vertexMap.end(), 0);
+  std::vector<u8>       touched(vertexCount);
+  std::vector<Collapse> collapses;
+  for (;;) {
+    // every collapse removes about two triangles
+    size_t budget = (ret.size() - targetIndexCount) / 6 + 1;
+
+    collapses.clear();
+    for (u32 i = 0; i < ret.size(); ++i) {
+      u32 a = positionId[ret[i]];
+      u32 b = positionId[ret[i - i % 3 + (i % 3 + 1) % 3]];
+      // interior edges are seen once from either side
+      if (a >= b || (locked[a] && locked[b]))
+        continue;
+      Quadric q = quadrics[a];
+      q += quadrics[b];
+      float costAB = locked[a] ? FLT_MAX : quadricError(q, positions[b]);
+      float costBA = locked[b] ? FLT_MAX : quadricError(q, positions[a]);
+      if (costAB <= costBA)
+        collapses.push_back({costAB, a, b});
+      else
+        collapses.push_back({costBA, b, a});
+    }
+
+    // only the cheapest few have a chance to be done in this pass
+    auto byCost = [](const Collapse& lhs, const Collapse& rhs) {
+      return lhs.cost < rhs.cost;
+    };
+    size_t considered = std::min(collapses.size(), budget * 4);
+    std::nth_element(collapses.begin(), collapses.begin() + considered,
+                     collapses.end(), byCost);
+    collapses.resize(considered);
+    std::sort(collapses.begin(), collapses.end(), byCost);
+
+    std::fill(touched.begin(), touched.end(), 0);
+    size_t done = 0;
+    for (const Collapse& collapse : collapses) {
+      if (done == budget || collapse.cost > maxCost)
+        break;
+      if (touched[collapse.from] || touched[collapse.to] ||
+          flips(collapse.from, collapse.to))
+        continue;
+
+      // every copy of from moves to the copy of to that looks most like it
+      u32 copy = collapse.from;
+      do {
+        u32   best = collapse.to, candidate = collapse.to;
+        float bestDistance = FLT_MAX;
+        do {
+          float distance =
+              attributeDistance(vertexAt(copy), vertexAt(candidate));
+          if (distance < bestDistance) {
+            bestDistance = distance;
+            best         = candidate;
+          }
+          candidate = nextCopy[candidate];
+        } while (candidate != collapse.to);
+        vertexMap[copy] = best;
+        copy            = nextCopy[copy];
+      } while (copy != collapse.from);
+
+      quadrics[collapse.to] += quadrics[collapse.from];
+      // the triangles around both change, every vertex on them waits for
+      // the next pass so that the collapses of a pass stay independent
+      for (u32 position : {collapse.from, collapse.to}) {
+        for (u32 t : trianglesAround(position)) {
+          for (u32 k = 0; k < 3; ++k)
+            touched[positionId[ret[t * 3 + k]]] = 1;
+        }
+      }
+      worstCost = std::max(worstCost, collapse.cost);
+      ++done;
+    }
+    if (done == 0)
+      break;
+
+    size_t out = 0;
+    for (size_t i = 0; i < ret.size(); i += 3) {
+      u32 tri[3] = {vertexMap[ret[i]], vertexMap[ret[i + 1]],
+                    vertexMap[ret[i + 2]]};
+      u32 p0 = positionId[tri[0]], p1 = positionId[tri[1]],
+          p2 = positionId[tri[2]];
+      if (p0 == p1 || p1 == p2 || p0 == p2)
+        continue;
+      ret[out++] = tri[0];
+      ret[out++] = tri[1];
+      ret[out++] = tri[2];
+    }
+    ret.resize(out);
+    if (ret.size() <= targetIndexCount)
+      break;
+    buildAdjacency();
+  }
+
+  for (u32& index : ret)
+    index = used[index];
+  if (resultError)
+    *resultError = std::sqrt(worstCost) * scale;
+  return ret;
+}
+
+} // namespace myvk::data
@@ -0,0 +1,139 @@
+#include "DataType/Meshlet.hpp"
+
+namespace myvk::data {
+
+namespace {
+Meshlet finishMeshlet(std::span<const Vertex> vertices,
+                      std::span<const u32> indices, u32 firstIndex,
+                      u32 indexCount) {
+  Meshlet ret{
+      .firstIndex   = firstIndex,
+      .indexCount   = indexCount,
+      .vertexOffset = 0,
+  };
+  std::span<const u32> range = indices.subspan(firstIndex, indexCount);
+
+  glm::vec3 boxMin = vertices[range[0]].pos, boxMax = boxMin;
+  for (u32 index : range) {
+    boxMin = glm::min(boxMin, vertices[index].pos);
+    boxMax = glm::max(boxMax, vertices[index].pos);
+  }
+  ret.center = (boxMin + boxMax) * .5f;
+  float radius2 = 0.f;
+  for (u32 index : range) {
+    glm::vec3 d = vertices[index].pos - ret.center;
+    radius2     = std::max(radius2, glm::dot(d, d));
+  }
+  ret.radius = std::sqrt(radius2);
+
+  // the cone axis is the average face normal, its spread is the largest
+  // angle between the axis and a face normal
+  std::vector<glm::vec3> normals;
+  normals.reserve(indexCount / 3);
+  glm::vec3 axis{0.f};
+  for (u32 i = 0; i + 2 < indexCount; i += 3) {
+    const glm::vec3& p0 = vertices[range[i + 0]].pos;
+    const glm::vec3& p1 = vertices[range[i + 1]].pos;
+    const glm::vec3& p2 = vertices[range[i + 2]].pos;
+    glm::vec3        n  = glm::cross(p1 - p0, p2 - p0);
+    float            length = glm::length(n);
+    if (length == 0.f)
+      continue;
+    normals.push_back(n / length);
+    axis += normals.back();
+  }
+
+  ret.coneAxis   = glm::vec3{0.f, 0.f, 1.f};
+  ret.coneCutoff = 1.f;
+  float axisLength = glm::length(axis);
+  if (normals.empty() || axisLength == 0.f)
+    return ret;
+  axis /= axisLength;
+
+  float minDot = 1.f;
+  for (const glm::vec3& n : normals)
+    minDot = std::min(minDot, glm::dot(n, axis));
+  // a cone wider than about 85 degrees would hardly ever cull
+  if (minDot <= .1f)
+    return ret;
+
+  ret.coneAxis   = axis;
+  ret.coneCutoff = std::sqrt(1.f - minDot * minDot);
+  return ret;
+}
+} // namespace
+
+std::vector<Meshlet> MeshletBuilder::Build(std::span<const Vertex> vertices,
+                                           std::span<const u32>    indices,
+                                           u32 maxVertices,
+                                           u32 maxTriangles) {
+  std::vector<Meshlet> ret;
+  if (indices.size() < 3)
+    return ret;
+  ret.reserve(indices.size() / 3 / maxTriangles + 1);
+
+  // stamp of the last meshlet that used each vertex
+  std::vector<u32> usedBy(vertices.size(), ~0u);
+  u32              meshletId = 0, vertexCount = 0, firstIndex = 0;
+  u32              indexCount = (u32)(indices.size() / 3 * 3);
+  for (u32 i = 0; i < indexCount; i += 3) {
+    u32 added = 0;
+    for (u32 k = 0; k < 3; ++k)
+      added += usedBy[indices[i + k]] != meshletId;
+
+    // a triangle sharing no vertex usually starts another overdraw cluster
+    // somewhere else on the mesh, so it starts a new meshlet too
+    if (i - firstIndex == maxTriangles * 3 ||
+        vertexCount + added > maxVertices ||
+        (added == 3 && i != firstIndex)) {
+      ret.push_back(finishMeshlet(vertices, indices, firstIndex,
+                                  i - firstIndex));
+      ++meshletId;
+      vertexCount = 0;
+      firstIndex  = i;
+    }
+
+    for (u32 k = 0; k < 3; ++k) {
+      u32& stamp = usedBy[indices[i + k]];
+      if (stamp != meshletId) {
+        stamp = meshletId;
+        ++vertexCount;
+      }
+    }
+  }
+  ret.push_back(
+      finishMeshlet(vertices, indices, firstIndex, indexCount - firstIndex));
+  return ret;
+}
+
+u32 MeshletCuller::Cull(std::span<const Meshlet> meshlets,
+                        const Frustum& frustum, const glm::vec3& cameraPos,
+                        bool coneCulling, std::vector<DrawRange>& draws) {
+  u32 triangleCount = 0;
+  for (const Meshlet& meshlet : meshlets) {
+    if (!frustum.intersectsSphere(meshlet.center, meshlet.radius))
+      continue;
+
+    if (coneCulling) {
+      // the camera sees only the back of every triangle
+      glm::vec3 toCenter = meshlet.center - cameraPos;
+      if (glm::dot(toCenter, meshlet.coneAxis) >=
+          meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+        continue;
+    }
+
+    if (!draws.empty() &&
+        draws.back().firstIndex + draws.back().indexCount ==
+            meshlet.firstIndex &&
+        draws.back().vertexOffset == meshlet.vertexOffset) {
+      draws.back().indexCount += meshlet.indexCount;
+    } else {
+      draws.push_back(
+          {meshlet.firstIndex, meshlet.indexCount, meshlet.vertexOffset});
+    }
+    triangleCount += meshlet.indexCount / 3;
+  }
+  return triangleCount;
+}
+
+} // namespace myvk::data
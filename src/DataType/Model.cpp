@@ -1,152 +1,613 @@
 #include "DataType/Model.hpp"
+#include "Hash.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
 #include <string>
 #include <unordered_map>
+
 namespace myvk::data {
 
-ObjModel::ObjModel(ccstr filename) {
-  using namespace tinyobj;
-  attrib_t                attrib;
-  std::string             warn, err;
-  std::vector<shape_t>    shapes;
-  std::vector<material_t> material;
-  bool result = LoadObj(&attrib, &shapes, &material, &warn, &err, filename);
+namespace {
+ezvk::AllocatedBuffer createBuffer(ezvk::BufferAllocator& allocator,
+                                   VkDeviceSize size, VkBufferUsageFlags usage,
+                                   VmaMemoryUsage memoryUsage) {
+  VkBufferCreateInfo bufferCI{
+      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext       = nullptr,
+      .flags       = 0,
+      .size        = size,
+      .usage       = usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo bufferAI{.usage = memoryUsage};
+  return allocator.createBuffer(&bufferCI, &bufferAI);
+}
+
+// a mesh as placed by one node of the scene graph
+struct MeshPlacement {
+  const aiMesh* mesh;
+  aiMatrix4x4   transform;
+};
+
+void collectPlacements(const aiScene* scene, const aiNode* node,
+                       const aiMatrix4x4&          parent,
+                       std::vector<MeshPlacement>& placements) {
+  aiMatrix4x4 transform = parent * node->mTransformation;
+  for (u32 i = 0; i < node->mNumMeshes; ++i)
+    placements.push_back({scene->mMeshes[node->mMeshes[i]], transform});
+  for (u32 i = 0; i < node->mNumChildren; ++i)
+    collectPlacements(scene, node->mChildren[i], transform, placements);
+}
 
-  if (!warn.empty()) {
-    LOG_WARN("{}", warn);
+// the triangles of mesh, Triangulate leaves points and lines alone
+std::vector<u32> triangleIndices(const aiMesh* mesh) {
+  std::vector<u32> ret;
+  for (u32 f = 0; f < mesh->mNumFaces; ++f) {
+    const aiFace& face = mesh->mFaces[f];
+    if (face.mNumIndices == 3)
+      ret.insert(ret.end(), face.mIndices, face.mIndices + 3);
   }
-  if (!err.empty()) {
-    LOG_ERR("{}", err);
+  return ret;
+}
+
+// everything a mesh is converted from, which channels it has in the low bits
+u32 meshChannels(const aiMesh* mesh) {
+  return mesh->HasNormals() | mesh->HasTextureCoords(0) << 1 |
+         mesh->HasVertexColors(0) << 2;
+}
+
+bool sameArray(const void* a, const void* b, size_t size) {
+  return a == b || std::memcmp(a, b, size) == 0;
+}
+
+u64 hashMesh(const aiMesh* mesh, std::span<const u32> triangles) {
+  u32 n         = mesh->mNumVertices;
+  u32 header[3] = {mesh->mMaterialIndex, meshChannels(mesh), n};
+  u64 hash      = HashBytes(header, sizeof(header));
+  hash          = HashBytes(mesh->mVertices, n * sizeof(aiVector3D), hash);
+  if (mesh->HasNormals())
+    hash = HashBytes(mesh->mNormals, n * sizeof(aiVector3D), hash);
+  if (mesh->HasTextureCoords(0))
+    hash = HashBytes(mesh->mTextureCoords[0], n * sizeof(aiVector3D), hash);
+  if (mesh->HasVertexColors(0))
+    hash = HashBytes(mesh->mColors[0], n * sizeof(aiColor4D), hash);
+  return HashBytes(triangles.data(), triangles.size_bytes(), hash);
+}
+
+bool sameMesh(const aiMesh* a, std::span<const u32> aTriangles,
+              const aiMesh* b, std::span<const u32> bTriangles) {
+  u32 n = a->mNumVertices;
+  if (n != b->mNumVertices || a->mMaterialIndex != b->mMaterialIndex ||
+      meshChannels(a) != meshChannels(b) ||
+      aTriangles.size() != bTriangles.size())
+    return false;
+  return sameArray(a->mVertices, b->mVertices, n * sizeof(aiVector3D)) &&
+         (!a->HasNormals() ||
+          sameArray(a->mNormals, b->mNormals, n * sizeof(aiVector3D))) &&
+         (!a->HasTextureCoords(0) ||
+          sameArray(a->mTextureCoords[0], b->mTextureCoords[0],
+                    n * sizeof(aiVector3D))) &&
+         (!a->HasVertexColors(0) ||
+          sameArray(a->mColors[0], b->mColors[0], n * sizeof(aiColor4D))) &&
+         sameArray(aTriangles.data(), bTriangles.data(),
+                   aTriangles.size_bytes());
+}
+
+// assimp matrices are row major
+glm::mat4 toGlm(const aiMatrix4x4& m) {
+  return glm::transpose(glm::make_mat4(&m.a1));
+}
+
+glm::vec3 toGlm(const aiColor3D& c) {
+  return {c.r, c.g, c.b};
+}
+} // namespace
+
+ObjModel::ObjModel(ccstr filename, const ObjLoadOptions& options) {
+  using clock = std::chrono::steady_clock;
+
+  auto cacheBegin       = clock::now();
+  u64  sourceHash       = 0;
+  bool alreadyOptimized = false;
+  if (options.useCache && m_cache.open(filename)) {
+    const MeshCacheHeader& header = m_cache.header();
+    boundsMin                     = header.boundsMin;
+    boundsMax                     = header.boundsMax;
+    LOG_INFO("load {} from mesh cache: {} ms", filename,
+             std::chrono::duration<double, std::milli>(clock::now() -
+                                                       cacheBegin)
+                 .count());
+    bool optimized = header.flags & MeshCacheHeader::eOptimized;
+    bool hasLods   = header.flags & MeshCacheHeader::eLods;
+    if ((!options.optimize || optimized) && (!options.buildLods || hasLods))
+      return;
+
+    // cached before it was optimized or without lods, redo what is missing
+    // and replace the cache
+    auto cached = m_cache.vertices();
+    vertices.assign(cached.begin(), cached.end());
+    auto cachedIndices = m_cache.indices();
+    indices.assign(cachedIndices.begin(), cachedIndices.end());
+    sourceHash       = header.sourceHash;
+    alreadyOptimized = optimized;
+    m_cache.close();
+  } else {
+    auto      parseBegin = clock::now();
+    ObjParser parser;
+    bool      result = false;
+    if (options.loader == ObjLoader::eParallel) {
+      result = parser.parse(filename);
+      if (!result)
+        LOG_WARN("parallel obj parse of {} failed, falling back to tinyobj",
+                 filename);
+    }
+    if (!result) {
+      result = parser.parseWithTinyObj(filename);
+    }
+    // may run on a worker while the viewer is up, leave the model empty
+    if (!result) {
+      LOG_ERR("failed to load {}", filename);
+      return;
+    }
+    LOG_INFO("parse {}: {} ms", filename,
+             std::chrono::duration<double, std::milli>(clock::now() -
+                                                       parseBegin)
+                 .count());
+
+    auto dedupBegin = clock::now();
+    buildVertices(parser);
+    LOG_INFO("dedup {} indices into {} vertices: {} ms", indices.size(),
+             vertices.size(),
+             std::chrono::duration<double, std::milli>(clock::now() -
+                                                       dedupBegin)
+                 .count());
+
+    computeBounds();
+    if (options.useCache)
+      sourceHash = MeshCache::HashSource(filename);
   }
-  if (!result) {
-    exit(-1);
+
+  u32 cacheFlags = 0;
+  if (options.compressIndices)
+    cacheFlags |= MeshCacheHeader::eCompressedIndices;
+  if (options.optimize && alreadyOptimized) {
+    cacheFlags |= MeshCacheHeader::eOptimized;
+  } else if (options.optimize) {
+    auto optimizeBegin = clock::now();
+    MeshOptimizer::Optimize(vertices, indices, options.optimizer);
+    cacheFlags |= MeshCacheHeader::eOptimized;
+    LOG_INFO("optimize {}: {} ms", filename,
+             std::chrono::duration<double, std::milli>(clock::now() -
+                                                       optimizeBegin)
+                 .count());
   }
 
-  std::unordered_map<Vertex, u32> uniqueVertices{};
+  if (options.buildLods) {
+    auto lodBegin = clock::now();
+    lods          = LodChain::Build(vertices, indices, options.lod);
+    cacheFlags |= MeshCacheHeader::eLods;
+    LOG_INFO("build {} lod levels of {}: {} ms", lods.levels.size(), filename,
+             std::chrono::duration<double, std::milli>(clock::now() - lodBegin)
+                 .count());
+  }
 
-  for (auto& shape : shapes) {
-    for (const auto& index : shape.mesh.indices) {
-      Vertex vertex;
+  if (options.useCache &&
+      !MeshCache::Write(filename, sourceHash, vertices, indices, boundsMin,
+                        boundsMax, cacheFlags, lods)) {
+    LOG_WARN("failed to write mesh cache for {}", filename);
+  }
+}
 
-      vertex.pos = {
-          attrib.vertices[3 * index.vertex_index + 0],
-          attrib.vertices[3 * index.vertex_index + 1],
-          attrib.vertices[3 * index.vertex_index + 2],
-      };
+void ObjModel::computeBounds() {
+  if (vertices.empty())
+    return;
+  boundsMin = boundsMax = vertices[0].pos;
+  for (const Vertex& vertex : vertices) {
+    boundsMin = glm::min(boundsMin, vertex.pos);
+    boundsMax = glm::max(boundsMax, vertex.pos);
+  }
+}
 
-      if (index.texcoord_index > 0)
-        vertex.uv = {
-            attrib.texcoords[2 * index.texcoord_index + 0],
-            1 - attrib.texcoords[2 * index.texcoord_index + 1],
-        };
+void ObjModel::buildVertices(const ObjParser& parser) {
+  const std::vector<tinyobj::index_t>& tuples = parser.indices;
 
-      if (index.normal_index > 0)
-        vertex.norm = {
-            attrib.normals[3 * index.normal_index + 0],
-            attrib.normals[3 * index.normal_index + 1],
-            attrib.normals[3 * index.normal_index + 2],
-        };
+  // Vertices are deduplicated on their index tuple. Each shard owns a range
+  // of position blocks, so shards never see the same tuple and can run
+  // without locks. Blocks keep neighbouring positions in the same shard.
+  constexpr u32 kBlockShift = 10;
+  ThreadPool&   pool        = ThreadPool::GetGlobal();
+  u32           shardCount =
+      tuples.size() < (1 << 16) ? 1 : std::min<u32>(pool.size() + 1, 64);
+  auto shardOf = [&](const tinyobj::index_t& tuple) {
+    return ((u32)tuple.vertex_index >> kBlockShift) % shardCount;
+  };
 
+  // Tuples are bucketed by shard first, so each shard walks only its own.
+  // Every batch counts its tuples per shard, and a prefix sum over shards
+  // and then batches tells each batch where to put them. A bucket keeps the
+  // order of the tuples, so the vertex order does not depend on the shards.
+  // A single shard takes the tuples as they are and leaves order empty.
+  std::vector<u32> shardBegin{0, (u32)tuples.size()};
+  std::vector<u32> order;
+  if (shardCount > 1) {
+    constexpr size_t kBucketBatch = 1 << 20;
+    u32 batchCount = (u32)((tuples.size() + kBucketBatch - 1) / kBucketBatch);
+    std::vector<u32> batchOffsets((size_t)batchCount * shardCount);
+    pool.parallelFor(batchCount, [&](u32 batch) {
+      u32*   counts = batchOffsets.data() + (size_t)batch * shardCount;
+      size_t end    = std::min(tuples.size(), (batch + 1) * kBucketBatch);
+      for (size_t i = batch * kBucketBatch; i < end; ++i)
+        ++counts[shardOf(tuples[i])];
+    });
 
-      if (uniqueVertices.count(vertex) == 0) {
-        uniqueVertices[vertex] = static_cast<u32>(vertices.size());
-        vertices.push_back(vertex);
+    shardBegin.resize(shardCount + 1);
+    u32 bucketed = 0;
+    for (u32 shard = 0; shard < shardCount; ++shard) {
+      shardBegin[shard] = bucketed;
+      for (u32 batch = 0; batch < batchCount; ++batch) {
+        u32& offset = batchOffsets[(size_t)batch * shardCount + shard];
+        u32  count  = offset;
+        offset      = bucketed;
+        bucketed += count;
       }
+    }
+    shardBegin[shardCount] = bucketed;
 
-      indices.push_back(uniqueVertices[vertex]);
+    order.resize(tuples.size());
+    pool.parallelFor(batchCount, [&](u32 batch) {
+      u32*   offsets = batchOffsets.data() + (size_t)batch * shardCount;
+      size_t end     = std::min(tuples.size(), (batch + 1) * kBucketBatch);
+      for (size_t i = batch * kBucketBatch; i < end; ++i)
+        order[offsets[shardOf(tuples[i])]++] = (u32)i;
+    });
+  }
+
+  indices.resize(tuples.size());
+  std::vector<std::vector<tinyobj::index_t>> shardTuples(shardCount);
+
+  // The tuples of a position are chained from the first vertex that uses
+  // it. They are few, and faces refer to nearby positions, so a lookup
+  // mostly stays in cache where a hash of the tuple would not. Shards own
+  // disjoint positions, so they write disjoint entries of firstVertex.
+  constexpr u32    kNone = ~0u;
+  std::vector<u32> firstVertex(parser.attrib.vertices.size() / 3, kNone);
+  pool.parallelFor(shardCount, [&](u32 shard) {
+    auto&            uniqueTuples = shardTuples[shard];
+    std::vector<u32> nextVertex;
+    // a closed triangle mesh has about half as many vertices as faces
+    uniqueTuples.reserve(tuples.size() / 6 / shardCount);
+    nextVertex.reserve(tuples.size() / 6 / shardCount);
+
+    for (u32 k = shardBegin[shard]; k < shardBegin[shard + 1]; ++k) {
+      u32                     i     = order.empty() ? k : order[k];
+      const tinyobj::index_t& tuple = tuples[i];
+      u32*                    link  = &firstVertex[tuple.vertex_index];
+      while (*link != kNone &&
+             (uniqueTuples[*link].texcoord_index != tuple.texcoord_index ||
+              uniqueTuples[*link].normal_index != tuple.normal_index))
+        link = &nextVertex[*link];
+      u32 id = *link;
+      if (id == kNone) {
+        // link may be in nextVertex, it is written before that grows
+        id = *link = (u32)uniqueTuples.size();
+        uniqueTuples.push_back(tuple);
+        nextVertex.push_back(kNone);
+      }
+      indices[i] = id;
     }
+  });
+
+  std::vector<u32> shardBase(shardCount);
+  u32              vertexCount = 0;
+  for (u32 shard = 0; shard < shardCount; ++shard) {
+    shardBase[shard] = vertexCount;
+    vertexCount += (u32)shardTuples[shard].size();
   }
+
+  // fills in the vertices of each shard and rebases its indices to them
+  vertices.resize(vertexCount);
+  pool.parallelFor(shardCount, [&](u32 shard) {
+    Vertex* dst = vertices.data() + shardBase[shard];
+    for (const auto& tuple : shardTuples[shard]) {
+      *dst++ = parser.vertexAt(tuple);
+    }
+    shardTuples[shard] = {};
+
+    if (shardBase[shard] == 0)
+      return;
+    for (u32 k = shardBegin[shard]; k < shardBegin[shard + 1]; ++k)
+      indices[order[k]] += shardBase[shard];
+  });
 }
 
 ezvk::AllocatedBuffer
 ObjModel::allocateVertices(ezvk::BufferAllocator& allocator) {
-  ezvk::AllocatedBuffer ret = allocator.createBuffer(
-      vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-  ret.transferMemory(allocator, (void*)vertices.data(), ret.size);
+  auto                  data = vertexData();
+  ezvk::AllocatedBuffer ret  = createBuffer(
+      allocator, data.size_bytes(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+      VMA_MEMORY_USAGE_CPU_TO_GPU);
+  ret.transferMemory(allocator, (void*)data.data(), ret.size);
   return ret;
 }
 ezvk::AllocatedBuffer
 ObjModel::allocateIndices(ezvk::BufferAllocator& allocator) {
-  ezvk::AllocatedBuffer ret;
-  ret = allocator.createBuffer(indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                               VMA_MEMORY_USAGE_CPU_TO_GPU);
-  ret.transferMemory(allocator, (void*)indices.data(), ret.size);
+  auto                  data = indexData();
+  ezvk::AllocatedBuffer ret  = createBuffer(
+      allocator, data.size_bytes(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+      VMA_MEMORY_USAGE_CPU_TO_GPU);
+  ret.transferMemory(allocator, (void*)data.data(), ret.size);
   return ret;
 }
 
-ezvk::AllocatedBuffer
-ObjModel::allocateVerticesUsingStaging(ezvk::BufferAllocator& allocator,
-                                       ezvk::CommandPool&     cmdPool,
-                                       VkDevice device, VkQueue submitQueue) {
-  ezvk::AllocatedBuffer stagingBuf = allocator.createBuffer(
-      vertices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
-  stagingBuf.transferMemory(allocator, (void*)vertices.data(), stagingBuf.size);
-
-  ezvk::AllocatedBuffer retBuffer = allocator.createBuffer(
-      vertices,
-      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-      VMA_MEMORY_USAGE_GPU_ONLY);
-  stagingBuf.copyTo(retBuffer, device, cmdPool, submitQueue);
-
-  allocator.destroyBuffer(stagingBuf);
-  return retBuffer;
+u32 ObjModel::allocateVerticesUsingStaging(GeometryBuffer&      geometry,
+                                           UploadBatch&         batch,
+                                           std::span<const u32> remap) {
+  auto data = vertexData();
+  if (!remap.empty()) {
+    std::vector<Vertex> gathered(remap.size());
+    for (size_t i = 0; i < remap.size(); ++i)
+      gathered[i] = data[remap[i]];
+    return geometry.addVertices(batch, gathered.data(),
+                                gathered.size() * sizeof(Vertex),
+                                sizeof(Vertex));
+  }
+  // a cached model is copied straight from the mapped cache file
+  return geometry.addVertices(batch, data.data(), data.size_bytes(),
+                              sizeof(Vertex));
 }
-ezvk::AllocatedBuffer
-ObjModel::allocateIndicesUsingStaging(ezvk::BufferAllocator& allocator,
-                                      ezvk::CommandPool&     cmdPool,
-                                      VkDevice device, VkQueue submitQueue) {
-
-  ezvk::AllocatedBuffer stagingBuf = allocator.createBuffer(
-      indices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
-  stagingBuf.transferMemory(allocator, (void*)indices.data(), stagingBuf.size);
-
-  ezvk::AllocatedBuffer retBuffer = allocator.createBuffer(
-      indices,
-      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-      VMA_MEMORY_USAGE_GPU_ONLY);
-
-  stagingBuf.copyTo(retBuffer, device, cmdPool, submitQueue);
-
-  allocator.destroyBuffer(stagingBuf);
-  return retBuffer;
-}
-
-// VertexInputDescription Vertex::GetInputDescription() {
-//   VertexInputDescription ret;
-
-//   VkVertexInputBindingDescription binding{
-//       .binding   = 0,
-//       .stride    = sizeof(Vertex),
-//       .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-//   };
-
-//   ret.bindings.push_back(binding);
-
-//   VkVertexInputAttributeDescription posAttr{
-//       .location = 0,
-//       .binding  = 0,
-//       .format   = VK_FORMAT_R32G32B32_SFLOAT,
-//       .offset   = offsetof(Vertex, pos),
-//   };
-
-//   VkVertexInputAttributeDescription normAttr{
-//       .location = 1,
-//       .binding  = 0,
-//       .format   = VK_FORMAT_R32G32B32_SFLOAT,
-//       .offset   = offsetof(Vertex, norm),
-//   };
-
-//   VkVertexInputAttributeDescription uvAttr{
-//       .location = 2,
-//       .binding  = 0,
-//       .format   = VK_FORMAT_R32G32_SFLOAT,
-//       .offset   = offsetof(Vertex, uv),
-//   };
-
-//   ret.attributes.push_back(posAttr);
-//   ret.attributes.push_back(normAttr);
-//   ret.attributes.push_back(uvAttr);
-//   return ret;
-// }
+u32 ObjModel::allocatePackedVerticesUsingStaging(GeometryBuffer&      geometry,
+                                                 UploadBatch&         batch,
+                                                 std::span<const u32> remap) {
+  std::vector<PackedVertex> packed =
+      PackVertices(vertexData(), quantization(), remap);
+  return geometry.addVertices(batch, packed.data(),
+                              packed.size() * sizeof(PackedVertex),
+                              sizeof(PackedVertex));
+}
+u32 ObjModel::allocateIndicesUsingStaging(GeometryBuffer& geometry,
+                                          UploadBatch&    batch) {
+  auto data = indexData();
+  return geometry.addIndices(batch, data.data(), data.size_bytes(),
+                             VK_INDEX_TYPE_UINT32);
+}
+
+void ObjModel::releaseGeometry() {
+  if (m_cache.isOpen()) {
+    auto levels = m_cache.lodLevels();
+    lods.levels.assign(levels.begin(), levels.end());
+    m_cache.close();
+  }
+  vertices     = {};
+  indices      = {};
+  lods.indices = {};
+}
+
+Model::Model(ccstr path) {
+  using clock = std::chrono::steady_clock;
+
+  auto             importBegin = clock::now();
+  Assimp::Importer importer;
+  const aiScene*   scene = importer.ReadFile(
+      path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
+                aiProcess_GenSmoothNormals | aiProcess_FlipUVs);
+  if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) ||
+      !scene->mRootNode) {
+    LOG_ERR("failed to import {}: {}", path, importer.GetErrorString());
+    return;
+  }
+  LOG_INFO("import {}: {} ms", path,
+           std::chrono::duration<double, std::milli>(clock::now() -
+                                                     importBegin)
+               .count());
+
+  std::string pathString = path;
+  size_t      slash      = pathString.find_last_of("/\\");
+  directory = slash == std::string::npos ? "." : pathString.substr(0, slash);
+
+  auto        convertBegin = clock::now();
+  ThreadPool& pool         = ThreadPool::GetGlobal();
+
+  materials.resize(scene->mNumMaterials);
+  pool.parallelFor(scene->mNumMaterials, [&](u32 i) {
+    const aiMaterial* source   = scene->mMaterials[i];
+    ModelMaterial&    material = materials[i];
+    material.name              = source->GetName().C_Str();
+
+    aiColor3D color{0.f, 0.f, 0.f};
+    if (source->Get(AI_MATKEY_COLOR_AMBIENT, color) == AI_SUCCESS)
+      material.params.ambient = toGlm(color);
+    if (source->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS)
+      material.params.diffuse = toGlm(color);
+    if (source->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS)
+      material.params.specular = toGlm(color);
+    source->Get(AI_MATKEY_SHININESS, material.params.shininess);
 
+    aiString texture;
+    if (source->GetTexture(aiTextureType_DIFFUSE, 0, &texture) == AI_SUCCESS)
+      material.diffuseTexture = texture.C_Str();
+  });
+
+  std::vector<MeshPlacement> placements;
+  collectPlacements(scene, scene->mRootNode, aiMatrix4x4{}, placements);
+
+  // every aiMesh a node refers to, once
+  std::vector<const aiMesh*>             sources;
+  std::vector<u32>                       placementSource(placements.size());
+  std::unordered_map<const aiMesh*, u32> sourceIndex;
+  for (size_t i = 0; i < placements.size(); ++i) {
+    auto [it, inserted] =
+        sourceIndex.try_emplace(placements[i].mesh, (u32)sources.size());
+    if (inserted)
+      sources.push_back(placements[i].mesh);
+    placementSource[i] = it->second;
+  }
+
+  std::vector<std::vector<u32>> triangles(sources.size());
+  std::vector<u64>              hashes(sources.size());
+  pool.parallelFor((u32)sources.size(), [&](u32 i) {
+    triangles[i] = triangleIndices(sources[i]);
+    hashes[i]    = hashMesh(sources[i], triangles[i]);
+  });
+
+  // sources with the same content become one mesh, a hash match is only a
+  // candidate until the data compares equal
+  std::vector<u32>                          sourceMesh(sources.size());
+  std::vector<u32>                          meshSource;
+  std::unordered_map<u64, std::vector<u32>> byHash;
+  for (u32 i = 0; i < sources.size(); ++i) {
+    std::vector<u32>& candidates = byHash[hashes[i]];
+    sourceMesh[i]                = (u32)meshSource.size();
+    for (u32 mesh : candidates) {
+      u32 source = meshSource[mesh];
+      if (sameMesh(sources[i], triangles[i], sources[source],
+                   triangles[source])) {
+        sourceMesh[i] = mesh;
+        break;
+      }
+    }
+    if (sourceMesh[i] == meshSource.size()) {
+      candidates.push_back(sourceMesh[i]);
+      meshSource.push_back(i);
+    }
+  }
+
+  // every mesh gets its slice of the shared buffers up front, so the
+  // conversion writes in place without merging afterwards
+  meshes.resize(meshSource.size());
+  u32 vertexCount = 0, indexCount = 0;
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    u32 source = meshSource[i];
+
+    meshes[i] = {
+        .firstIndex    = indexCount,
+        .indexCount    = (u32)triangles[source].size(),
+        .vertexOffset  = (i32)vertexCount,
+        .vertexCount   = sources[source]->mNumVertices,
+        .materialIndex = sources[source]->mMaterialIndex,
+        .boundsMin     = glm::vec3{0.f},
+        .boundsMax     = glm::vec3{0.f},
+        .firstInstance = 0,
+        .instanceCount = 0,
+    };
+    vertexCount += meshes[i].vertexCount;
+    indexCount += meshes[i].indexCount;
+  }
+  vertices.resize(vertexCount);
+  indices.resize(indexCount);
+
+  pool.parallelFor((u32)meshes.size(), [&](u32 i) {
+    const aiMesh* mesh  = sources[meshSource[i]];
+    MeshRange&    range = meshes[i];
+
+    Vertex* dst = vertices.data() + range.vertexOffset;
+    for (u32 v = 0; v < mesh->mNumVertices; ++v) {
+      Vertex&           vertex = dst[v];
+      const aiVector3D& pos    = mesh->mVertices[v];
+      vertex                   = {};
+      vertex.pos               = {pos.x, pos.y, pos.z};
+      if (mesh->HasNormals()) {
+        const aiVector3D& n = mesh->mNormals[v];
+        vertex.norm         = {n.x, n.y, n.z};
+      }
+      if (mesh->HasTextureCoords(0)) {
+        vertex.uv = {mesh->mTextureCoords[0][v].x,
+                     mesh->mTextureCoords[0][v].y};
+      }
+      if (mesh->HasVertexColors(0)) {
+        const aiColor4D& c = mesh->mColors[0][v];
+        vertex.color       = {c.r, c.g, c.b};
+      }
+
+      if (v == 0)
+        range.boundsMin = range.boundsMax = vertex.pos;
+      range.boundsMin = glm::min(range.boundsMin, vertex.pos);
+      range.boundsMax = glm::max(range.boundsMax, vertex.pos);
+    }
+
+    const std::vector<u32>& source = triangles[meshSource[i]];
+    std::copy(source.begin(), source.end(),
+              indices.begin() + range.firstIndex);
+  });
+
+  // placements grouped by mesh, so each mesh draws its range in one call
+  instances.resize(placements.size());
+  for (size_t i = 0; i < placements.size(); ++i) {
+    instances[i] = {
+        .transform = toGlm(placements[i].transform),
+        .mesh      = sourceMesh[placementSource[i]],
+    };
+  }
+  std::stable_sort(instances.begin(), instances.end(),
+                   [](const ModelInstance& a, const ModelInstance& b) {
+                     return a.mesh < b.mesh;
+                   });
+  for (u32 i = 0; i < instances.size(); ++i) {
+    MeshRange& range = meshes[instances[i].mesh];
+    if (range.instanceCount++ == 0)
+      range.firstInstance = i;
+  }
+
+  bool first = true;
+  for (ModelInstance& instance : instances) {
+    const MeshRange& range = meshes[instance.mesh];
+    if (range.vertexCount == 0)
+      continue;
+    for (u32 corner = 0; corner < 8; ++corner) {
+      glm::vec3 local{corner & 1 ? range.boundsMax.x : range.boundsMin.x,
+                      corner & 2 ? range.boundsMax.y : range.boundsMin.y,
+                      corner & 4 ? range.boundsMax.z : range.boundsMin.z};
+      glm::vec3 pos = instance.transform * glm::vec4{local, 1.f};
+      instance.boundsMin =
+          corner == 0 ? pos : glm::min(instance.boundsMin, pos);
+      instance.boundsMax =
+          corner == 0 ? pos : glm::max(instance.boundsMax, pos);
+    }
+    boundsMin = first ? instance.boundsMin
+                      : glm::min(boundsMin, instance.boundsMin);
+    boundsMax = first ? instance.boundsMax
+                      : glm::max(boundsMax, instance.boundsMax);
+    first     = false;
+  }
+
+  LOG_INFO("{} placements of {} meshes in {}, {} of them found by content",
+           instances.size(), meshes.size(), path,
+           sources.size() - meshes.size());
+  LOG_INFO("convert {} meshes and {} materials of {} into {} vertices and {} "
+           "indices: {} ms",
+           meshes.size(), materials.size(), path, vertices.size(),
+           indices.size(),
+           std::chrono::duration<double, std::milli>(clock::now() -
+                                                     convertBegin)
+               .count());
+}
+
+u32 Model::allocateVerticesUsingStaging(GeometryBuffer& geometry,
+                                        UploadBatch&    batch) {
+  return geometry.addVertices(batch, vertices.data(),
+                              vertices.size() * sizeof(Vertex), sizeof(Vertex));
+}
+u32 Model::allocateIndicesUsingStaging(GeometryBuffer& geometry,
+                                       UploadBatch&    batch) {
+  return geometry.addIndices(batch, indices.data(),
+                             indices.size() * sizeof(u32),
+                             VK_INDEX_TYPE_UINT32);
+}
+
+InstanceData InstanceData::Create(const glm::mat4& transform, u32 material) {
+  return {
+      .transform       = transform,
+      .normalTransform = glm::transpose(glm::inverse(transform)),
+      .material        = {material, 0, 0, 0},
+  };
+}
+
+void Model::releaseGeometry() {
+  vertices = {};
+  indices  = {};
+}
 
 } // namespace myvk::data
\ No newline at end of file
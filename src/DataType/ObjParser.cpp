@@ -0,0 +1,327 @@
+#include "DataType/ObjParser.hpp"
+#include "DataType/MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <string>
+
+namespace myvk::data {
+
+namespace {
+constexpr size_t kMinChunkSize = 1 << 20;
+
+// Indices inside a chunk are either absolute (>= 0), missing (-1) or relative
+// to the chunk's first attribute (< -1, biased) until the chunks are merged.
+// A relative index may point into an earlier chunk, so it can go negative.
+constexpr int kRelativeBias = 1 << 30;
+
+struct ObjChunk {
+  std::vector<float>            positions;
+  std::vector<float>            texcoords;
+  std::vector<float>            normals;
+  std::vector<tinyobj::index_t> indices;
+  bool                          failed{false};
+};
+
+inline const char* skipSpaces(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t'))
+    ++p;
+  return p;
+}
+
+inline bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* parseFloat(const char* p, const char* end, float& out) {
+  p = skipSpaces(p, end);
+  if (p < end && *p == '+')
+    ++p;
+  auto [ptr, ec] = std::from_chars(p, end, out);
+  if (ec == std::errc::invalid_argument)
+    return nullptr;
+  // denormals and overflow still consume the token
+  if (ec == std::errc::result_out_of_range)
+    out = 0.f;
+  return ptr;
+}
+
+inline int encodeIndex(int raw, size_t localCount) {
+  if (raw > 0)
+    return raw - 1;
+  if (raw < 0)
+    return (int)localCount + raw - kRelativeBias - 2;
+  return -1;
+}
+
+inline int resolveIndex(int encoded, int base) {
+  return encoded >= -1 ? encoded : base + encoded + kRelativeBias + 2;
+}
+
+const char* parseIndexToken(const char* p, const char* end, ObjChunk& chunk,
+                            tinyobj::index_t& out) {
+  int raw = 0;
+  auto [ptr, ec] = std::from_chars(p, end, raw);
+  if (ec != std::errc{})
+    return nullptr;
+  p                = ptr;
+  out.vertex_index = encodeIndex(raw, chunk.positions.size() / 3);
+  out.texcoord_index = -1;
+  out.normal_index   = -1;
+
+  if (p < end && *p == '/') {
+    ++p;
+    if (p < end && *p != '/') {
+      auto [tPtr, tEc] = std::from_chars(p, end, raw);
+      if (tEc != std::errc{})
+        return nullptr;
+      p                  = tPtr;
+      out.texcoord_index = encodeIndex(raw, chunk.texcoords.size() / 2);
+    }
+    if (p < end && *p == '/') {
+      ++p;
+      auto [nPtr, nEc] = std::from_chars(p, end, raw);
+      if (nEc != std::errc{})
+        return nullptr;
+      p                = nPtr;
+      out.normal_index = encodeIndex(raw, chunk.normals.size() / 3);
+    }
+  }
+  return p;
+}
+
+bool parseFace(const char* p, const char* end, ObjChunk& chunk,
+               std::vector<tinyobj::index_t>& polygon) {
+  polygon.clear();
+  while (true) {
+    p = skipSpaces(p, end);
+    if (p >= end || *p == '\r' || *p == '#')
+      break;
+    tinyobj::index_t index;
+    p = parseIndexToken(p, end, chunk, index);
+    if (!p)
+      return false;
+    polygon.push_back(index);
+    while (p < end && !isSpace(*p))
+      ++p;
+  }
+
+  for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+    chunk.indices.push_back(polygon[0]);
+    chunk.indices.push_back(polygon[i]);
+    chunk.indices.push_back(polygon[i + 1]);
+  }
+  return true;
+}
+
+void parseChunk(const char* p, const char* end, ObjChunk& chunk) {
+  std::vector<tinyobj::index_t> polygon;
+
+  while (p < end) {
+    const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+    if (!lineEnd)
+      lineEnd = end;
+
+    const char* cur = skipSpaces(p, lineEnd);
+    if (lineEnd - cur >= 2) {
+      if (cur[0] == 'v' && (cur[1] == ' ' || cur[1] == '\t')) {
+        float xyz[3];
+        cur = parseFloat(cur + 2, lineEnd, xyz[0]);
+        cur = cur ? parseFloat(cur, lineEnd, xyz[1]) : nullptr;
+        cur = cur ? parseFloat(cur, lineEnd, xyz[2]) : nullptr;
+        if (!cur) {
+          chunk.failed = true;
+          return;
+        }
+        chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+      } else if (cur[0] == 'v' && cur[1] == 't') {
+        float uv[2] = {0.f, 0.f};
+        cur         = parseFloat(cur + 2, lineEnd, uv[0]);
+        if (!cur) {
+          chunk.failed = true;
+          return;
+        }
+        // the second coordinate is optional
+        cur = skipSpaces(cur, lineEnd);
+        if (cur < lineEnd && *cur != '\r' && !parseFloat(cur, lineEnd, uv[1])) {
+          chunk.failed = true;
+          return;
+        }
+        chunk.texcoords.insert(chunk.texcoords.end(), uv, uv + 2);
+      } else if (cur[0] == 'v' && cur[1] == 'n') {
+        float xyz[3];
+        cur = parseFloat(cur + 2, lineEnd, xyz[0]);
+        cur = cur ? parseFloat(cur, lineEnd, xyz[1]) : nullptr;
+        cur = cur ? parseFloat(cur, lineEnd, xyz[2]) : nullptr;
+        if (!cur) {
+          chunk.failed = true;
+          return;
+        }
+        chunk.normals.insert(chunk.normals.end(), xyz, xyz + 3);
+      } else if (cur[0] == 'f' && (cur[1] == ' ' || cur[1] == '\t')) {
+        if (!parseFace(cur + 2, lineEnd, chunk, polygon)) {
+          chunk.failed = true;
+          return;
+        }
+      }
+    }
+    p = lineEnd + 1;
+  }
+}
+} // namespace
+
+bool ObjParser::parse(ccstr filename) {
+  MappedFile file;
+  if (!file.open(filename)) {
+    LOG_ERR("failed to map {}", filename);
+    return false;
+  }
+  return parse(file.data(), file.size());
+}
+
+bool ObjParser::parse(const char* text, size_t size) {
+  attrib = {};
+  indices.clear();
+  return append(text, size);
+}
+
+bool ObjParser::append(const char* text, size_t size) {
+  ThreadPool& pool = ThreadPool::GetGlobal();
+
+  size_t chunkCount = std::max<size_t>(1, size / kMinChunkSize);
+  chunkCount        = std::min<size_t>(chunkCount, (pool.size() + 1) * 4);
+
+  // split at line boundaries
+  std::vector<const char*> bounds(chunkCount + 1);
+  bounds[0]          = text;
+  bounds[chunkCount] = text + size;
+  for (size_t i = 1; i < chunkCount; ++i) {
+    const char* p = std::max(text + size / chunkCount * i, bounds[i - 1]);
+    const char* newline =
+        (const char*)memchr(p, '\n', text + size - p);
+    bounds[i] = newline ? newline + 1 : text + size;
+  }
+
+  std::vector<ObjChunk> chunks(chunkCount);
+  pool.parallelFor((u32)chunkCount, [&](u32 i) {
+    parseChunk(bounds[i], bounds[i + 1], chunks[i]);
+  });
+
+  struct ChunkBase {
+    size_t position, texcoord, normal, index;
+  };
+  std::vector<ChunkBase> bases(chunkCount);
+  ChunkBase              total{attrib.vertices.size(), attrib.texcoords.size(),
+                  attrib.normals.size(), indices.size()};
+  for (size_t i = 0; i < chunkCount; ++i) {
+    if (chunks[i].failed) {
+      LOG_ERR("obj parse error in chunk {}", i);
+      return false;
+    }
+    bases[i] = total;
+    total.position += chunks[i].positions.size();
+    total.texcoord += chunks[i].texcoords.size();
+    total.normal += chunks[i].normals.size();
+    total.index += chunks[i].indices.size();
+  }
+
+  attrib.vertices.resize(total.position);
+  attrib.texcoords.resize(total.texcoord);
+  attrib.normals.resize(total.normal);
+  indices.resize(total.index);
+
+  int positionCount = (int)(total.position / 3);
+  int texcoordCount = (int)(total.texcoord / 2);
+  int normalCount   = (int)(total.normal / 3);
+
+  std::atomic<bool> invalidIndex{false};
+  pool.parallelFor((u32)chunkCount, [&](u32 i) {
+    ObjChunk&        chunk = chunks[i];
+    const ChunkBase& base  = bases[i];
+    std::copy(chunk.positions.begin(), chunk.positions.end(),
+              attrib.vertices.begin() + base.position);
+    std::copy(chunk.texcoords.begin(), chunk.texcoords.end(),
+              attrib.texcoords.begin() + base.texcoord);
+    std::copy(chunk.normals.begin(), chunk.normals.end(),
+              attrib.normals.begin() + base.normal);
+
+    int positionBase = (int)(base.position / 3);
+    int texcoordBase = (int)(base.texcoord / 2);
+    int normalBase   = (int)(base.normal / 3);
+
+    bool              invalid = false;
+    tinyobj::index_t* dst     = indices.data() + base.index;
+    for (const auto& index : chunk.indices) {
+      dst->vertex_index   = resolveIndex(index.vertex_index, positionBase);
+      dst->texcoord_index = resolveIndex(index.texcoord_index, texcoordBase);
+      dst->normal_index   = resolveIndex(index.normal_index, normalBase);
+      invalid |= dst->vertex_index < 0 || dst->vertex_index >= positionCount ||
+                 dst->texcoord_index < -1 ||
+                 dst->texcoord_index >= texcoordCount ||
+                 dst->normal_index < -1 || dst->normal_index >= normalCount;
+      ++dst;
+    }
+    if (invalid)
+      invalidIndex = true;
+    chunk = {};
+  });
+
+  if (invalidIndex) {
+    LOG_ERR("obj face references an undefined vertex, {} positions defined",
+            positionCount);
+    return false;
+  }
+  return true;
+}
+
+Vertex ObjParser::vertexAt(const tinyobj::index_t& tuple) const {
+  Vertex vertex{};
+  vertex.pos = {
+      attrib.vertices[3 * tuple.vertex_index + 0],
+      attrib.vertices[3 * tuple.vertex_index + 1],
+      attrib.vertices[3 * tuple.vertex_index + 2],
+  };
+
+  if (tuple.texcoord_index >= 0)
+    vertex.uv = {
+        attrib.texcoords[2 * tuple.texcoord_index + 0],
+        1 - attrib.texcoords[2 * tuple.texcoord_index + 1],
+    };
+
+  if (tuple.normal_index >= 0)
+    vertex.norm = {
+        attrib.normals[3 * tuple.normal_index + 0],
+        attrib.normals[3 * tuple.normal_index + 1],
+        attrib.normals[3 * tuple.normal_index + 2],
+    };
+  return vertex;
+}
+
+bool ObjParser::parseWithTinyObj(ccstr filename) {
+  std::string                     warn, err;
+  std::vector<tinyobj::shape_t>    shapes;
+  std::vector<tinyobj::material_t> material;
+  bool result = tinyobj::LoadObj(&attrib, &shapes, &material, &warn, &err,
+                                 filename);
+
+  if (!warn.empty()) {
+    LOG_WARN("{}", warn);
+  }
+  if (!err.empty()) {
+    LOG_ERR("{}", err);
+  }
+  if (!result) {
+    return false;
+  }
+
+  indices.clear();
+  for (auto& shape : shapes) {
+    indices.insert(indices.end(), shape.mesh.indices.begin(),
+                   shape.mesh.indices.end());
+  }
+  return true;
+}
+
+} // namespace myvk::data
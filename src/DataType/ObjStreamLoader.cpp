@@ -0,0 +1,163 @@
+#include "DataType/ObjStreamLoader.hpp"
+#include "DataType/IndexTupleMap.hpp"
+#include "DataType/MeshCache.hpp"
+#include "DataType/ObjParser.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace myvk::data {
+
+ObjStreamLoader::~ObjStreamLoader() {
+  stop();
+}
+
+void ObjStreamLoader::start(ccstr filename, size_t blockSize) {
+  stop();
+  m_done   = false;
+  m_stop   = false;
+  m_thread = std::thread(&ObjStreamLoader::run, this, std::string(filename),
+                         blockSize);
+}
+
+void ObjStreamLoader::stop() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_stop = true;
+  }
+  m_consumed.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+  m_ready.clear();
+}
+
+bool ObjStreamLoader::poll(ObjStreamChunk& out) {
+  {
+    std::lock_guard lock(m_mutex);
+    if (m_ready.empty())
+      return false;
+    out = std::move(m_ready.front());
+    m_ready.pop_front();
+  }
+  m_consumed.notify_one();
+  return true;
+}
+
+bool ObjStreamLoader::isFinished() {
+  std::lock_guard lock(m_mutex);
+  return m_done && m_ready.empty();
+}
+
+bool ObjStreamLoader::publish(ObjStreamChunk&& chunk) {
+  std::unique_lock lock(m_mutex);
+  m_consumed.wait(
+      lock, [this] { return m_stop || m_ready.size() < kMaxQueuedChunks; });
+  if (m_stop)
+    return false;
+  m_ready.push_back(std::move(chunk));
+  return true;
+}
+
+void ObjStreamLoader::run(std::string filename, size_t blockSize) {
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    LOG_ERR("failed to open {}", filename);
+    std::lock_guard lock(m_mutex);
+    m_done = true;
+    return;
+  }
+
+  MeshCacheWriter cacheWriter;
+  bool            writeCache = cacheWriter.begin(filename.c_str());
+
+  ObjParser     parser;
+  IndexTupleMap uniqueTuples;
+  glm::vec3     boundsMin{std::numeric_limits<float>::max()};
+  glm::vec3     boundsMax{std::numeric_limits<float>::lowest()};
+  u32           vertexBase = 0;
+  bool          failed     = false;
+
+  std::vector<char> block(blockSize);
+  size_t            carry = 0;
+  while (!failed) {
+    in.read(block.data() + carry, block.size() - carry);
+    size_t size = carry + (size_t)in.gcount();
+    bool   eof  = !in;
+    if (size == 0)
+      break;
+
+    // parse up to the last complete line and keep the rest for later
+    size_t parsed = size;
+    if (!eof) {
+      const char* text = block.data();
+      while (parsed > 0 && text[parsed - 1] != '\n')
+        --parsed;
+      if (parsed == 0) {
+        // a single line longer than the block
+        block.resize(block.size() * 2);
+        carry = size;
+        continue;
+      }
+    }
+
+    parser.indices.clear();
+    if (!parser.append(block.data(), parsed)) {
+      failed = true;
+      break;
+    }
+
+    ObjStreamChunk chunk;
+    uniqueTuples.clear();
+    uniqueTuples.reserve(parser.indices.size() / 6);
+    chunk.indices.reserve(parser.indices.size());
+    for (const auto& tuple : parser.indices) {
+      auto [id, inserted] =
+          uniqueTuples.insert(tuple, (u32)chunk.vertices.size());
+      if (inserted) {
+        chunk.vertices.push_back(parser.vertexAt(tuple));
+        boundsMin = glm::min(boundsMin, chunk.vertices.back().pos);
+        boundsMax = glm::max(boundsMax, chunk.vertices.back().pos);
+      }
+      chunk.indices.push_back(id);
+    }
+
+    if (!chunk.indices.empty()) {
+      if (writeCache) {
+        cacheWriter.appendVertices(chunk.vertices);
+        cacheWriter.appendIndices(chunk.indices, vertexBase);
+      }
+      vertexBase += (u32)chunk.vertices.size();
+      if (!publish(std::move(chunk)))
+        break;
+    }
+
+    carry = size - parsed;
+    memmove(block.data(), block.data() + parsed, carry);
+    // the long line is parsed, go back to blocks of blockSize
+    if (block.size() > blockSize && carry < blockSize) {
+      block.resize(blockSize);
+      block.shrink_to_fit();
+    }
+    if (eof)
+      break;
+  }
+
+  bool stopped;
+  {
+    std::lock_guard lock(m_mutex);
+    stopped = m_stop;
+  }
+
+  if (failed) {
+    LOG_ERR("streaming parse of {} failed", filename);
+  } else if (writeCache && !stopped) {
+    if (!cacheWriter.finish(boundsMin, boundsMax))
+      LOG_WARN("failed to write mesh cache for {}", filename);
+  }
+
+  std::lock_guard lock(m_mutex);
+  m_done = true;
+}
+
+} // namespace myvk::data
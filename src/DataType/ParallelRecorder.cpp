@@ -0,0 +1,87 @@
+#include "DataType/ParallelRecorder.hpp"
+
+namespace myvk::data {
+
+void ParallelRecorder::create(VkDevice device, u32 queueFamily,
+                              u32 frameCount, u32 maxThreads) {
+  m_device = device;
+  m_pools.assign(frameCount, std::vector<VkCommandPool>(maxThreads));
+  m_cmds.assign(frameCount, std::vector<VkCommandBuffer>(maxThreads));
+  m_kept.assign(frameCount, 0);
+
+  VkCommandPoolCreateInfo poolCI{
+      .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      .pNext            = nullptr,
+      .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+      .queueFamilyIndex = queueFamily,
+  };
+  for (u32 frame = 0; frame < frameCount; ++frame) {
+    for (u32 thread = 0; thread < maxThreads; ++thread) {
+      VkCommandPool& pool = m_pools[frame][thread];
+      vkCreateCommandPool(device, &poolCI, nullptr, &pool);
+      VkCommandBufferAllocateInfo cmdAI{
+          .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+          .pNext              = nullptr,
+          .commandPool        = pool,
+          .level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+          .commandBufferCount = 1,
+      };
+      vkAllocateCommandBuffers(device, &cmdAI, &m_cmds[frame][thread]);
+    }
+  }
+}
+
+void ParallelRecorder::destroy() {
+  // the buffers go with their pools
+  for (const auto& pools : m_pools) {
+    for (VkCommandPool pool : pools)
+      vkDestroyCommandPool(m_device, pool, nullptr);
+  }
+  m_pools.clear();
+  m_cmds.clear();
+  m_kept.clear();
+  m_recorded = 0;
+}
+
+bool ParallelRecorder::reuse(u64 frame) {
+  m_frame = (u32)(frame % m_pools.size());
+  if (m_kept[m_frame] == 0)
+    return false;
+  m_recorded = m_kept[m_frame];
+  return true;
+}
+
+void ParallelRecorder::invalidate() {
+  std::fill(m_kept.begin(), m_kept.end(), 0);
+}
+
+void ParallelRecorder::execute(VkCommandBuffer primary) const {
+  vkCmdExecuteCommands(primary, m_recorded, m_cmds[m_frame].data());
+}
+
+void ParallelRecorder::beginFrame(u64 frame) {
+  m_frame = (u32)(frame % m_pools.size());
+  for (VkCommandPool pool : m_pools[m_frame])
+    vkResetCommandPool(m_device, pool, 0);
+}
+
+VkCommandBuffer
+ParallelRecorder::begin(u32                                   thread,
+                        const VkCommandBufferInheritanceInfo& inheritance,
+                        bool                                  keep) {
+  VkCommandBuffer           cmd   = m_cmds[m_frame][thread];
+  VkCommandBufferUsageFlags flags =
+      VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  if (!keep)
+    flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  VkCommandBufferBeginInfo beginInfo{
+      .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .pNext            = nullptr,
+      .flags            = flags,
+      .pInheritanceInfo = &inheritance,
+  };
+  vkBeginCommandBuffer(cmd, &beginInfo);
+  return cmd;
+}
+
+} // namespace myvk::data
@@ -0,0 +1,133 @@
+#include "DataType/ResidencyManager.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace myvk::data {
+
+void ResidencyManager::create(ezvk::BufferAllocator& allocator,
+                              VkPhysicalDevice gpu, VkDeviceSize budget) {
+  m_allocator   = &allocator;
+  m_fixedBudget = budget;
+
+  VkPhysicalDeviceMemoryProperties memory;
+  vkGetPhysicalDeviceMemoryProperties(gpu, &memory);
+  m_heapCount = memory.memoryHeapCount;
+  m_heapMask  = 0;
+  for (u32 heap = 0; heap < memory.memoryHeapCount; ++heap) {
+    if (memory.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+      m_heapMask |= 1u << heap;
+  }
+
+  u32 extensionCount = 0;
+  vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extensionCount,
+                                       nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extensionCount,
+                                       extensions.data());
+  bool memoryBudget = std::any_of(
+      extensions.begin(), extensions.end(), [](const auto& extension) {
+        return std::strcmp(extension.extensionName,
+                           VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+      });
+  LOG_INFO("device memory budget {}, the driver {} {}",
+           budget ? std::to_string(budget) : "from the driver",
+           memoryBudget ? "supports" : "does not support",
+           VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+}
+
+void ResidencyManager::destroy() {
+  m_assets.clear();
+  m_freeHandles.clear();
+}
+
+u32 ResidencyManager::track(std::string name, VkDeviceSize bytes,
+                            std::function<void()> evict) {
+  u32 asset;
+  if (m_freeHandles.empty()) {
+    asset = (u32)m_assets.size();
+    m_assets.emplace_back();
+  } else {
+    asset = m_freeHandles.back();
+    m_freeHandles.pop_back();
+  }
+  m_assets[asset] = {std::move(name), bytes, m_frame, std::move(evict), true};
+  return asset;
+}
+
+void ResidencyManager::untrack(u32 asset) {
+  if (asset == kInvalid || !m_assets[asset].live)
+    return;
+  m_assets[asset] = {};
+  m_freeHandles.push_back(asset);
+}
+
+void ResidencyManager::touch(u32 asset) {
+  if (asset != kInvalid)
+    m_assets[asset].lastUsed = m_frame;
+}
+
+void ResidencyManager::update() {
+  ++m_frame;
+
+  VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+  vmaGetHeapBudgets(*m_allocator, budgets);
+  VkDeviceSize driverBudget = 0;
+  m_usage                   = 0;
+  for (u32 heap = 0; heap < m_heapCount; ++heap) {
+    if (m_heapMask & (1u << heap)) {
+      m_usage += budgets[heap].usage;
+      driverBudget += budgets[heap].budget;
+    }
+  }
+  m_budget = m_fixedBudget ? m_fixedBudget
+                           : (VkDeviceSize)(driverBudget * kBudgetShare);
+
+  if (m_usage <= m_budget) {
+    m_overBudgetLogged = false;
+    return;
+  }
+  if (m_frame < m_nextEviction)
+    return;
+
+  // least recently drawn first
+  std::vector<u32> candidates;
+  for (u32 asset = 0; asset < m_assets.size(); ++asset) {
+    if (m_assets[asset].live &&
+        m_assets[asset].lastUsed + kMinIdleFrames <= m_frame)
+      candidates.push_back(asset);
+  }
+  std::sort(candidates.begin(), candidates.end(), [&](u32 a, u32 b) {
+    return m_assets[a].lastUsed < m_assets[b].lastUsed;
+  });
+
+  VkDeviceSize usage = m_usage;
+  for (u32 asset : candidates) {
+    if (usage <= m_budget)
+      break;
+    LOG_INFO("evicting {}, {} bytes, {} of {} bytes in use",
+             m_assets[asset].name, m_assets[asset].bytes, usage, m_budget);
+    usage -= std::min(usage, m_assets[asset].bytes);
+    std::function<void()> evict = std::move(m_assets[asset].evict);
+    untrack(asset);
+    evict();
+    m_nextEviction = m_frame + kMinIdleFrames;
+  }
+
+  if (usage > m_budget && !m_overBudgetLogged) {
+    LOG_WARN("{} of {} bytes in use and nothing left to evict", usage,
+             m_budget);
+    m_overBudgetLogged = true;
+  }
+}
+
+VkDeviceSize ResidencyManager::trackedBytes() const {
+  VkDeviceSize bytes = 0;
+  for (const Asset& asset : m_assets) {
+    if (asset.live)
+      bytes += asset.bytes;
+  }
+  return bytes;
+}
+
+} // namespace myvk::data
@@ -0,0 +1,97 @@
+#include "DataType/StagingRing.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace myvk::data {
+
+void StagingRing::create(ezvk::BufferAllocator& allocator, VkDevice device,
+                         VkDeviceSize size) {
+  m_allocator = &allocator;
+  m_device    = device;
+
+  VkBufferCreateInfo bufferCI{
+      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext       = nullptr,
+      .flags       = 0,
+      .size        = size / kAlignment * kAlignment,
+      .usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  // CPU_ONLY memory is host coherent, writes need no flush
+  VmaAllocationCreateInfo bufferAI{.usage = VMA_MEMORY_USAGE_CPU_ONLY};
+  m_buffer = allocator.createBuffer(&bufferCI, &bufferAI);
+
+  void* mapped;
+  vmaMapMemory(allocator, m_buffer.allocation, &mapped);
+  m_mapped = (u8*)mapped;
+  m_head = m_fenced = m_tail = 0;
+}
+
+void StagingRing::destroy() {
+  while (!m_regions.empty())
+    reclaim(true);
+  vmaUnmapMemory(*m_allocator, m_buffer.allocation);
+  m_allocator->destroyBuffer(m_buffer);
+  m_mapped = nullptr;
+}
+
+StagingRing::Span StagingRing::allocate(VkDeviceSize size,
+                                        VkDeviceSize minSize) {
+  VkDeviceSize capacity = m_buffer.size;
+  minSize               = std::min({minSize, size, capacity});
+
+  reclaim(false);
+  while (true) {
+    // an allocation never wraps, a short end of the ring is skipped
+    u64 start = (m_head + kAlignment - 1) / kAlignment * kAlignment;
+    if (capacity - start % capacity < minSize)
+      start += capacity - start % capacity;
+    u64 limit =
+        std::min(start - start % capacity + capacity, m_tail + capacity);
+    if (limit >= start + minSize) {
+      VkDeviceSize taken = std::min<u64>(size, limit - start);
+      m_head             = start + taken;
+      return {m_buffer.buffer, start % capacity, taken,
+              m_mapped + start % capacity};
+    }
+    if (m_regions.empty())
+      return {};
+    reclaim(true);
+  }
+}
+
+void StagingRing::fence(VkFence fence) {
+  if (m_head == m_fenced)
+    return;
+  m_regions.push_back({m_head, fence});
+  m_fenced = m_head;
+}
+
+void StagingRing::release(VkFence fence) {
+  for (Region& region : m_regions) {
+    if (region.fence == fence)
+      region.fence = VK_NULL_HANDLE;
+  }
+  reclaim(false);
+}
+
+void StagingRing::reclaim(bool wait) {
+  while (!m_regions.empty()) {
+    Region& region = m_regions.front();
+    if (region.fence &&
+        vkGetFenceStatus(m_device, region.fence) != VK_SUCCESS) {
+      if (!wait)
+        break;
+      vkWaitForFences(m_device, 1, &region.fence, VK_TRUE,
+                      std::numeric_limits<u64>::max());
+      wait = false;
+    }
+    m_tail = region.end;
+    m_regions.pop_front();
+  }
+  if (m_regions.empty())
+    m_tail = m_fenced;
+}
+
+} // namespace myvk::data
@@ -1,51 +1,265 @@
 #include "DataType/Texture.hpp"
+#include "DataType/TextureSource.hpp"
+#include "ThreadPool.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
+#define STB_DXT_IMPLEMENTATION
 
+#include "stb_dxt.h"
 #include "stb_image.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
 namespace myvk::data {
 
-void TextureImage::create(ezvk::BufferAllocator& allocator,
-                          ezvk::CommandPool cmdPool, ccstr filename,
-                          VkQueue transferQueue, VkDevice device) {
-  stbi_uc* pixel =
-      stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
-  size_t imageSize = width * height * 4;
-  if (!pixel) {
+namespace {
+constexpr VkFormat kTextureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+// access masks and stages of the layout changes a texture goes through
+bool barrierMasksFor(VkImageLayout oldLayout, VkImageLayout newLayout,
+                     VkImageMemoryBarrier& barrier,
+                     VkPipelineStageFlags& srcStage,
+                     VkPipelineStageFlags& dstStage) {
+  if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
+      newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+             newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+             newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL &&
+             newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  } else {
+    return false;
+  }
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  return true;
+}
+
+// sRGB is decoded through a table and encoded through a table indexed by
+// the linear value in 1/4095 steps
+struct SrgbTables {
+  std::array<float, 256> toLinear;
+  std::array<u8, 4096>   fromLinear;
+
+  SrgbTables() {
+    for (u32 i = 0; i < 256; ++i) {
+      float c     = i / 255.f;
+      toLinear[i] = c <= .04045f ? c / 12.92f
+                                 : std::pow((c + .055f) / 1.055f, 2.4f);
+    }
+    for (u32 i = 0; i < 4096; ++i) {
+      float c       = i / 4095.f;
+      float srgb    = c <= .0031308f ? c * 12.92f
+                                     : 1.055f * std::pow(c, 1.f / 2.4f) - .055f;
+      fromLinear[i] = (u8)std::lround(std::clamp(srgb, 0.f, 1.f) * 255.f);
+    }
+  }
+};
+} // namespace
+
+u32 MipLevelCount(u32 width, u32 height) {
+  return std::bit_width(std::max({width, height, 1u}));
+}
+
+bool SupportsBC(VkPhysicalDevice gpu) {
+  for (VkFormat format :
+       {VK_FORMAT_BC1_RGB_SRGB_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK}) {
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(gpu, format, &props);
+    if (!(props.optimalTilingFeatures &
+          VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+      return false;
+  }
+  return true;
+}
+
+size_t MipLevelSize(VkFormat format, VkExtent2D extent) {
+  size_t blocks = (size_t)((extent.width + 3) / 4) * ((extent.height + 3) / 4);
+  switch (format) {
+  case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    return blocks * 8;
+  case VK_FORMAT_BC3_SRGB_BLOCK:
+    return blocks * 16;
+  default:
+    return (size_t)extent.width * extent.height * 4;
+  }
+}
+
+MipChain MipChain::Build(const u8* rgba, u32 width, u32 height) {
+  static const SrgbTables tables;
+
+  MipChain ret;
+  u32      levels = MipLevelCount(width, height);
+  size_t   size   = 0;
+  for (u32 level = 0, w = width, h = height; level < levels; ++level) {
+    ret.extents.push_back({w, h});
+    ret.offsets.push_back(size);
+    size += (size_t)w * h * 4;
+    w = std::max(w / 2, 1u);
+    h = std::max(h / 2, 1u);
+  }
+  ret.pixels.resize(size);
+  std::memcpy(ret.pixels.data(), rgba, (size_t)width * height * 4);
+
+  for (u32 level = 1; level < levels; ++level) {
+    const u8*  src       = ret.pixels.data() + ret.offsets[level - 1];
+    u8*        dst       = ret.pixels.data() + ret.offsets[level];
+    VkExtent2D srcExtent = ret.extents[level - 1];
+    VkExtent2D dstExtent = ret.extents[level];
+    // The filter stays scalar: a texel costs 12 table lookups to decode and 3
+    // to encode against a few adds, and SSE that packs the decoded channels
+    // into one register gave the same bytes but no faster. Rows run in
+    // parallel instead, each level still waits for the one it reads.
+    ThreadPool::GetGlobal().parallelFor(dstExtent.height, [&](u32 y) {
+      // odd sizes repeat the last row or column
+      const u8* row0 = src + (size_t)std::min(y * 2, srcExtent.height - 1) *
+                                 srcExtent.width * 4;
+      const u8* row1 = src + (size_t)std::min(y * 2 + 1,
+                                              srcExtent.height - 1) *
+                                 srcExtent.width * 4;
+      for (u32 x = 0; x < dstExtent.width; ++x) {
+        u32 x0 = std::min(x * 2, srcExtent.width - 1) * 4;
+        u32 x1 = std::min(x * 2 + 1, srcExtent.width - 1) * 4;
+        u8* out = dst + ((size_t)y * dstExtent.width + x) * 4;
+        for (u32 c = 0; c < 3; ++c) {
+          float linear =
+              (tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] +
+               tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]]) *
+              .25f;
+          out[c] = tables.fromLinear[(u32)(linear * 4095.f + .5f)];
+        }
+        // alpha is stored linearly
+        out[3] =
+            (u8)((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] +
+                  2) /
+                 4);
+      }
+    });
+  }
+  return ret;
+}
+
+MipChain EncodeBC(const MipChain& rgba) {
+  bool opaque = true;
+  for (size_t i = 3; i < rgba.pixels.size() && opaque; i += 4)
+    opaque = rgba.pixels[i] == 255;
+
+  MipChain ret;
+  ret.format =
+      opaque ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+  ret.extents = rgba.extents;
+  size_t size = 0;
+  for (VkExtent2D extent : rgba.extents) {
+    ret.offsets.push_back(size);
+    size += MipLevelSize(ret.format, extent);
+  }
+  ret.pixels.resize(size);
+
+  u32 blockBytes = opaque ? 8 : 16;
+  for (size_t level = 0; level < rgba.extents.size(); ++level) {
+    VkExtent2D extent  = rgba.extents[level];
+    u32        columns = (extent.width + 3) / 4;
+    u32        rows    = (extent.height + 3) / 4;
+    const u8*  src     = rgba.pixels.data() + rgba.offsets[level];
+    u8*        dst     = ret.pixels.data() + ret.offsets[level];
+    ThreadPool::GetGlobal().parallelFor(rows, [&](u32 row) {
+      u8 block[16 * 4];
+      for (u32 column = 0; column < columns; ++column) {
+        for (u32 y = 0; y < 4; ++y) {
+          u32 sy = std::min(row * 4 + y, extent.height - 1);
+          for (u32 x = 0; x < 4; ++x) {
+            u32 sx = std::min(column * 4 + x, extent.width - 1);
+            std::memcpy(block + (y * 4 + x) * 4,
+                        src + ((size_t)sy * extent.width + sx) * 4, 4);
+          }
+        }
+        stb_compress_dxt_block(
+            dst + ((size_t)row * columns + column) * blockBytes, block,
+            !opaque, STB_DXT_HIGHQUAL);
+      }
+    });
+  }
+  return ret;
+}
+
+void TextureImage::create(UploadBatch& batch, ccstr filename,
+                          VkPhysicalDevice gpu) {
+  // linear filtered blits need both blit features and linear filtering
+  constexpr VkFormatFeatureFlags kBlitFeatures =
+      VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  VkFormatProperties formatProps;
+  vkGetPhysicalDeviceFormatProperties(gpu, kTextureFormat, &formatProps);
+  bool bc = SupportsBC(gpu);
+  bool blitMips =
+      (formatProps.optimalTilingFeatures & kBlitFeatures) == kBlitFeatures;
+
+  TextureSource source;
+  if (!source.load(filename, bc, blitMips)) {
     LOG_ERR("Load image {} failed", filename);
     exit(-1);
   }
+  allocate(batch.allocator(), source);
+  upload(batch, source, 0, (u32)source.extents().size());
+}
 
-  VkBufferCreateInfo stagingBufferCI{
-      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-      .pNext       = nullptr,
-      .flags       = 0,
-      .size        = imageSize,
-      .usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-  };
+void TextureImage::createSolid(UploadBatch& batch, u32 rgba) {
+  TextureSource source = TextureSource::Solid(rgba);
+  allocate(batch.allocator(), source);
+  upload(batch, source, 0, 1);
+}
 
-  VmaAllocationCreateInfo stagingBufferAI{
-      .usage = VMA_MEMORY_USAGE_CPU_ONLY,
-  };
-  ezvk::AllocatedBuffer stagingBuffer =
-      allocator.createBuffer(&stagingBufferCI, &stagingBufferAI);
+void TextureImage::allocate(ezvk::BufferAllocator& allocator,
+                            const TextureSource&   source) {
+  width     = (i32)source.extents()[0].width;
+  height    = (i32)source.extents()[0].height;
+  channels  = 4;
+  mipLevels = source.mipLevels;
+  format    = source.format();
 
-  stagingBuffer.transferMemory(allocator, (void*)(pixel), stagingBuffer.size);
+  // block compressed images are never blitted
+  VkImageUsageFlags usage =
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  if (source.extents().size() < mipLevels)
+    usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
   VkImageCreateInfo imageCI{
-      .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-      .pNext       = nullptr,
-      .flags       = 0,
-      .imageType   = VK_IMAGE_TYPE_2D,
-      .format      = VK_FORMAT_R8G8B8A8_SRGB,
-      .extent      = {(u32)width, (u32)height, 1},
-      .mipLevels   = 1,
-      .arrayLayers = 1,
-      .samples     = VK_SAMPLE_COUNT_1_BIT,
-      .tiling      = VK_IMAGE_TILING_OPTIMAL,
-      .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .pNext         = nullptr,
+      .flags         = 0,
+      .imageType     = VK_IMAGE_TYPE_2D,
+      .format        = format,
+      .extent        = {(u32)width, (u32)height, 1},
+      .mipLevels     = mipLevels,
+      .arrayLayers   = 1,
+      .samples       = VK_SAMPLE_COUNT_1_BIT,
+      .tiling        = VK_IMAGE_TILING_OPTIMAL,
+      .usage         = usage,
       .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
       .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
   };
@@ -54,100 +268,102 @@ void TextureImage::create(ezvk::BufferAllocator& allocator,
       .usage = VMA_MEMORY_USAGE_GPU_ONLY,
   };
   this->image = allocator.createImage(&imageCI, &vmaCI);
+}
+
+void TextureImage::upload(UploadBatch& batch, const TextureSource& source,
+                          u32 firstLevel, u32 lastLevel) {
+  std::vector<VkBufferImageCopy> regions;
+  for (u32 level = firstLevel; level < lastLevel; ++level) {
+    VkExtent2D extent = source.extents()[level];
+    regions.push_back({
+        .bufferOffset      = source.offsets()[level],
+        .bufferRowLength   = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = level,
+                .baseArrayLayer = 0,
+                .layerCount     = 1,
+            },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {extent.width, extent.height, 1},
+    });
+  }
 
-  transitionImageLayout(cmdPool, device, transferQueue, VK_FORMAT_R8G8B8A8_SRGB,
-                        VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  u32 available = (u32)source.extents().size();
+  if (lastLevel == available) {
+    recordTransition(batch.cmd(), VK_IMAGE_LAYOUT_UNDEFINED,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  }
+  batch.copyToImage(this->image.image, format, source.data().data(), regions);
 
-  VkBufferImageCopy copyRegion{
-      .bufferOffset      = 0,
-      .bufferRowLength   = 0,
-      .bufferImageHeight = 0,
-      .imageSubresource =
-          {
-              .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-              .mipLevel       = 0,
-              .baseArrayLayer = 0,
-              .layerCount     = 1,
-          },
-      .imageOffset = {0, 0, 0},
-      .imageExtent = {(u32)width, (u32)height, 1},
-  };
-  stagingBuffer.copyToImage(this->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                            copyRegion, device, cmdPool, transferQueue);
+  if (firstLevel == 0 && available < mipLevels) {
+    generateMipmaps(batch.cmd());
+  } else {
+    recordTransition(batch.cmd(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, firstLevel,
+                     lastLevel - firstLevel);
+  }
+}
+
+void TextureImage::generateMipmaps(ezvk::CommandBuffer& cmd) {
+  // each level is blitted from the one above, which is then done
+  i32 levelWidth = width, levelHeight = height;
+  for (u32 level = 1; level < mipLevels; ++level) {
+    recordTransition(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, level - 1, 1);
 
-  transitionImageLayout(cmdPool, device, transferQueue, VK_FORMAT_R8G8B8A8_SRGB,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    i32         nextWidth  = std::max(levelWidth / 2, 1);
+    i32         nextHeight = std::max(levelHeight / 2, 1);
+    VkImageBlit blit{
+        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1},
+        .srcOffsets     = {{0, 0, 0}, {levelWidth, levelHeight, 1}},
+        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1},
+        .dstOffsets     = {{0, 0, 0}, {nextWidth, nextHeight, 1}},
+    };
+    vkCmdBlitImage(cmd.cmdBuffer, this->image.image,
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, this->image.image,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                   VK_FILTER_LINEAR);
 
-  allocator.destroyBuffer(stagingBuffer);
-  stbi_image_free(pixel);
+    recordTransition(cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, level - 1, 1);
+    levelWidth  = nextWidth;
+    levelHeight = nextHeight;
+  }
+  recordTransition(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels - 1, 1);
 }
 
 void TextureImage::destroy(ezvk::BufferAllocator& allocator) {
   allocator.destroyImage(image);
 }
 
-void TextureImage::transitionImageLayout(VkCommandPool cmdPool, VkDevice device,
-                                         VkQueue transferQueue, VkFormat format,
-                                         VkImageLayout oldLayout,
-                                         VkImageLayout newLayout) {
-  // image transition
-  ezvk::CommandBuffer cmd;
-  cmd.alloc(device, cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
-  cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
+bool TextureImage::recordTransition(ezvk::CommandBuffer& cmd,
+                                    VkImageLayout        oldLayout,
+                                    VkImageLayout        newLayout,
+                                    u32 baseMipLevel, u32 levelCount) {
   VkImageMemoryBarrier barrier{
       .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-      .oldLayout           = oldLayout,
-      .newLayout           = newLayout,
       .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
       .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
       .image               = this->image.image,
       .subresourceRange =
           {
               .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-              .baseMipLevel   = 0,
-              .levelCount     = 1,
+              .baseMipLevel   = baseMipLevel,
+              .levelCount     = levelCount,
               .baseArrayLayer = 0,
               .layerCount     = 1,
           },
   };
 
   VkPipelineStageFlags srcStage, dstStage;
-
-  if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
-      newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-    srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-  } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-             newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-  } else {
-    LOG_ERR("invalid argument");
-    exit(-1);
-  }
-
+  if (!barrierMasksFor(oldLayout, newLayout, barrier, srcStage, dstStage))
+    return false;
   cmd.pipelineImageBarrier(srcStage, dstStage, 0, 1, &barrier);
-  cmd.end();
-
-  VkSubmitInfo submitInfo{
-      .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-      .pNext              = nullptr,
-      .commandBufferCount = 1,
-      .pCommandBuffers    = &cmd.cmdBuffer,
-  };
-  vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-
-  vkDeviceWaitIdle(device);
-  cmd.free(device, cmdPool);
+  return true;
 }
 
-} // namespace myvk::data
\ No newline at end of file
+} // namespace myvk::data
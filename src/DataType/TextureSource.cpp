@@ -0,0 +1,56 @@
+#include "DataType/TextureSource.hpp"
+
+#include "stb_image.h"
+
+#include <cstring>
+
+namespace myvk::data {
+
+bool TextureSource::load(ccstr filename, bool bc, bool gpuMips) {
+  if (bc && cache.open(filename)) {
+    mipLevels = cache.levelCount();
+    LOG_INFO("texture {}: {}x{}, {} mip levels from {}", filename,
+             cache.extents()[0].width, cache.extents()[0].height, mipLevels,
+             KtxFile::PathFor(filename));
+    return true;
+  }
+
+  i32      width, height, channels;
+  stbi_uc* pixel =
+      stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixel)
+    return false;
+  mipLevels = MipLevelCount(width, height);
+
+  if (bc) {
+    levels = EncodeBC(MipChain::Build(pixel, width, height));
+    if (!KtxFile::Write(filename, levels))
+      LOG_WARN("failed to write texture cache {}", KtxFile::PathFor(filename));
+  } else if (gpuMips) {
+    levels.extents = {{(u32)width, (u32)height}};
+    levels.offsets = {0};
+    levels.pixels.assign(pixel, pixel + (size_t)width * height * 4);
+  } else {
+    levels = MipChain::Build(pixel, width, height);
+  }
+  stbi_image_free(pixel);
+
+  ccstr encoding = !bc ? "RGBA8"
+                   : levels.format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ? "BC1"
+                                                                   : "BC3";
+  LOG_INFO("texture {}: {}x{}, {} of {} mip levels decoded to {}", filename,
+           width, height, levels.extents.size(), mipLevels, encoding);
+  return true;
+}
+
+TextureSource TextureSource::Solid(u32 rgba) {
+  TextureSource ret;
+  ret.mipLevels      = 1;
+  ret.levels.extents = {{1, 1}};
+  ret.levels.offsets = {0};
+  ret.levels.pixels.resize(4);
+  std::memcpy(ret.levels.pixels.data(), &rgba, 4);
+  return ret;
+}
+
+} // namespace myvk::data
@@ -0,0 +1,264 @@
+#include "DataType/TextureStreamer.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace myvk::data {
+
+void TextureStreamer::create(ezvk::BufferAllocator& allocator,
+                             VkDevice device, VkPhysicalDevice gpu,
+                             VkCommandPool cmdPool, VkQueue queue,
+                             StagingRing& ring) {
+  m_allocator = &allocator;
+  m_device    = device;
+  m_cmdPool   = cmdPool;
+  m_queue     = queue;
+  m_ring      = &ring;
+  m_bc        = SupportsBC(gpu);
+
+  UploadBatch batch;
+  batch.begin(allocator, device, cmdPool, queue, ring);
+  m_placeholder.createSolid(batch, kPlaceholderColor);
+  batch.submit();
+  batch.release();
+  m_placeholderView = createView(m_placeholder, 0);
+}
+
+void TextureStreamer::destroy() {
+  for (Batch& batch : m_batches)
+    batch.upload.wait();
+  retireFinishedBatches();
+  for (const RetiredView& retired : m_retired)
+    vkDestroyImageView(m_device, retired.view, nullptr);
+  m_retired.clear();
+  for (RetiredImage& retired : m_retiredImages)
+    retired.image.destroy(*m_allocator);
+  m_retiredImages.clear();
+
+  for (Entry& entry : m_entries) {
+    if (entry.pending.valid())
+      entry.pending.wait();
+    if (entry.view)
+      vkDestroyImageView(m_device, entry.view, nullptr);
+    if (entry.allocated)
+      entry.image.destroy(*m_allocator);
+  }
+  m_entries.clear();
+
+  vkDestroyImageView(m_device, m_placeholderView, nullptr);
+  m_placeholder.destroy(*m_allocator);
+}
+
+u32 TextureStreamer::request(ccstr filename, bool wait) {
+  u32    texture = (u32)m_entries.size();
+  Entry& entry   = m_entries.emplace_back();
+  entry.filename = filename;
+
+  auto load = [filename = entry.filename, bc = m_bc] {
+    return Load(filename, bc);
+  };
+
+  if (!wait) {
+    entry.pending = ThreadPool::GetGlobal().submit(std::move(load));
+    return texture;
+  }
+
+  accept(texture, load());
+  if (m_entries[texture].source) {
+    submit(texture, 0, m_entries[texture].image.mipLevels);
+    m_batches.back().upload.wait();
+    retireFinishedBatches();
+  }
+  return texture;
+}
+
+bool TextureStreamer::update() {
+  using namespace std::chrono_literals;
+  ++m_updateCount;
+  bool changed   = retireFinishedBatches() || m_viewsChanged;
+  m_viewsChanged = false;
+
+  std::erase_if(m_retired, [&](const RetiredView& retired) {
+    if (retired.destroyAt > m_updateCount)
+      return false;
+    vkDestroyImageView(m_device, retired.view, nullptr);
+    return true;
+  });
+  std::erase_if(m_retiredImages, [&](RetiredImage& retired) {
+    if (retired.destroyAt > m_updateCount)
+      return false;
+    retired.image.destroy(*m_allocator);
+    return true;
+  });
+
+  for (u32 texture = 0; texture < m_entries.size(); ++texture) {
+    Entry& entry = m_entries[texture];
+    if (entry.pending.valid() &&
+        entry.pending.wait_for(0s) == std::future_status::ready)
+      accept(texture, entry.pending.get());
+  }
+
+  // coarse levels are small, so the first batch of a texture brings in its
+  // whole tail and the finest levels follow in later updates
+  size_t budget = kUploadBudget;
+  for (u32 texture = 0; texture < m_entries.size() && budget > 0;
+       ++texture) {
+    Entry& entry = m_entries[texture];
+    if (!entry.source || entry.uploading || entry.uploadedLevel == 0)
+      continue;
+    u32    lastLevel  = entry.uploadedLevel;
+    u32    firstLevel = lastLevel;
+    size_t size       = 0;
+    while (firstLevel > 0 &&
+           (firstLevel == lastLevel ||
+            size + entry.source->levelSize(firstLevel - 1) <= budget))
+      size += entry.source->levelSize(--firstLevel);
+    budget -= std::min(budget, size);
+    submit(texture, firstLevel, lastLevel);
+  }
+  return changed;
+}
+
+VkImageView TextureStreamer::view(u32 texture) const {
+  VkImageView view = m_entries[texture].view;
+  return view ? view : m_placeholderView;
+}
+
+bool TextureStreamer::isResident(u32 texture) const {
+  const Entry& entry = m_entries[texture];
+  return entry.view && entry.residentLevel == 0;
+}
+
+void TextureStreamer::evict(u32 texture) {
+  Entry& entry = m_entries[texture];
+  if (entry.pending.valid())
+    entry.pending.get();
+  std::erase_if(m_batches, [&](Batch& batch) {
+    if (batch.texture != texture)
+      return false;
+    batch.upload.release();
+    return true;
+  });
+
+  // frames in flight may still sample the image through the old view
+  if (entry.view)
+    m_retired.push_back({entry.view, m_updateCount + kRetireDelay});
+  if (entry.allocated)
+    m_retiredImages.push_back({entry.image, m_updateCount + kRetireDelay});
+  entry.source.reset();
+  entry.view          = VK_NULL_HANDLE;
+  entry.residentLevel = 0;
+  entry.uploadedLevel = 0;
+  entry.allocated     = false;
+  entry.uploading     = false;
+  m_viewsChanged      = true;
+}
+
+void TextureStreamer::reload(u32 texture) {
+  Entry& entry = m_entries[texture];
+  if (entry.allocated || entry.pending.valid())
+    return;
+  entry.pending = ThreadPool::GetGlobal().submit(
+      [filename = entry.filename, bc = m_bc] { return Load(filename, bc); });
+}
+
+VkDeviceSize TextureStreamer::memorySize(u32 texture) const {
+  const Entry& entry = m_entries[texture];
+  if (!entry.allocated)
+    return 0;
+  const TextureImage& image = entry.image;
+  VkDeviceSize        size  = 0;
+  for (u32 level = 0; level < image.mipLevels; ++level) {
+    VkExtent2D extent{std::max(1u, (u32)image.width >> level),
+                      std::max(1u, (u32)image.height >> level)};
+    size += MipLevelSize(image.format, extent);
+  }
+  return size;
+}
+
+std::unique_ptr<TextureSource>
+TextureStreamer::Load(const std::string& filename, bool bc) {
+  auto source = std::make_unique<TextureSource>();
+  if (!source->load(filename.c_str(), bc, false))
+    return nullptr;
+  return source;
+}
+
+void TextureStreamer::accept(u32 texture,
+                             std::unique_ptr<TextureSource> source) {
+  Entry& entry = m_entries[texture];
+  if (!source) {
+    LOG_WARN("failed to load texture {}, keeping the placeholder",
+             entry.filename);
+    return;
+  }
+  entry.source = std::move(source);
+  entry.image.allocate(*m_allocator, *entry.source);
+  entry.allocated     = true;
+  entry.residentLevel = entry.image.mipLevels;
+  entry.uploadedLevel = entry.image.mipLevels;
+}
+
+void TextureStreamer::submit(u32 texture, u32 firstLevel, u32 lastLevel) {
+  Entry& entry = m_entries[texture];
+  Batch& batch = m_batches.emplace_back();
+
+  batch.texture    = texture;
+  batch.firstLevel = firstLevel;
+  batch.upload.begin(*m_allocator, m_device, m_cmdPool, m_queue, *m_ring);
+  entry.image.upload(batch.upload, *entry.source, firstLevel, lastLevel);
+  batch.upload.submit();
+
+  entry.uploadedLevel = firstLevel;
+  entry.uploading     = true;
+}
+
+bool TextureStreamer::retireFinishedBatches() {
+  bool changed = false;
+  std::erase_if(m_batches, [&](Batch& batch) {
+    if (!batch.upload.finished())
+      return false;
+
+    // the old view may still be bound by a frame in flight
+    Entry& entry = m_entries[batch.texture];
+    if (entry.view)
+      m_retired.push_back({entry.view, m_updateCount + kRetireDelay});
+    entry.residentLevel = batch.firstLevel;
+    entry.view          = createView(entry.image, entry.residentLevel);
+    entry.uploading     = false;
+    if (entry.residentLevel == 0) {
+      LOG_INFO("texture {} is resident", entry.filename);
+      entry.source.reset();
+    }
+
+    batch.upload.release();
+    changed = true;
+    return true;
+  });
+  return changed;
+}
+
+VkImageView TextureStreamer::createView(const TextureImage& image,
+                                        u32                 baseLevel) {
+  VkImageViewCreateInfo viewCI{
+      .sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .pNext    = nullptr,
+      .image    = image.image.image,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D,
+      .format   = image.format,
+      .subresourceRange =
+          {
+              .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+              .baseMipLevel   = baseLevel,
+              .levelCount     = image.mipLevels - baseLevel,
+              .baseArrayLayer = 0,
+              .layerCount     = 1,
+          },
+  };
+  VkImageView view;
+  vkCreateImageView(m_device, &viewCI, nullptr, &view);
+  return view;
+}
+
+} // namespace myvk::data
@@ -0,0 +1,64 @@
+#include "DataType/UniformRing.hpp"
+
+#include <cstring>
+
+namespace myvk::data {
+
+void UniformRing::create(ezvk::BufferAllocator& allocator,
+                         VkPhysicalDevice gpu, VkDeviceSize frameSize,
+                         u32 frameCount) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(gpu, &properties);
+
+  m_allocator  = &allocator;
+  m_alignment  = properties.limits.minUniformBufferOffsetAlignment;
+  m_frameSize  = (frameSize + m_alignment - 1) / m_alignment * m_alignment;
+  m_frameCount = frameCount;
+  m_frameBegin = m_head = 0;
+
+  VkBufferCreateInfo bufferCI{
+      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext       = nullptr,
+      .flags       = 0,
+      .size        = m_frameSize * frameCount,
+      .usage       = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo bufferAI{.usage = VMA_MEMORY_USAGE_CPU_TO_GPU};
+  m_buffer = allocator.createBuffer(&bufferCI, &bufferAI);
+
+  void* mapped;
+  vmaMapMemory(allocator, m_buffer.allocation, &mapped);
+  m_mapped = (u8*)mapped;
+}
+
+void UniformRing::destroy() {
+  vmaUnmapMemory(*m_allocator, m_buffer.allocation);
+  m_allocator->destroyBuffer(m_buffer);
+  m_mapped = nullptr;
+}
+
+void UniformRing::beginFrame(u64 frame) {
+  m_frameBegin = frame % m_frameCount * m_frameSize;
+  m_head       = m_frameBegin;
+}
+
+std::optional<u32> UniformRing::push(const void* data, VkDeviceSize size) {
+  if (m_head + size > m_frameBegin + m_frameSize) {
+    LOG_ERR("{} bytes of uniforms per frame are not enough for {} more",
+            m_frameSize, size);
+    return std::nullopt;
+  }
+  VkDeviceSize offset = m_head;
+  std::memcpy(m_mapped + offset, data, size);
+  m_head = (offset + size + m_alignment - 1) / m_alignment * m_alignment;
+  return (u32)offset;
+}
+
+void UniformRing::endFrame() {
+  // a no-op on host coherent memory
+  vmaFlushAllocation(*m_allocator, m_buffer.allocation, m_frameBegin,
+                     frameUsed());
+}
+
+} // namespace myvk::data
@@ -0,0 +1,182 @@
+#include "DataType/UploadBatch.hpp"
+#include "DataType/Texture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace myvk::data {
+
+void UploadBatch::begin(ezvk::BufferAllocator& allocator, VkDevice device,
+                        VkCommandPool cmdPool, VkQueue queue,
+                        StagingRing& ring) {
+  m_allocator   = &allocator;
+  m_device      = device;
+  m_cmdPool     = cmdPool;
+  m_queue       = queue;
+  m_ring        = &ring;
+  m_stagedBytes = 0;
+
+  m_cmd.alloc(device, cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+  m_cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  m_recording = true;
+}
+
+void UploadBatch::copyToBuffer(const void* data, VkDeviceSize size,
+                               VkBuffer dst, VkDeviceSize dstOffset) {
+  for (VkDeviceSize copied = 0; copied < size;) {
+    StagingRing::Span staging = stage(size - copied, 1);
+    std::memcpy(staging.data, (const u8*)data + copied, staging.size);
+
+    VkBufferCopy region{
+        .srcOffset = staging.offset,
+        .dstOffset = dstOffset + copied,
+        .size      = staging.size,
+    };
+    vkCmdCopyBuffer(m_cmd.cmdBuffer, staging.buffer, dst, 1, &region);
+    copied += staging.size;
+  }
+}
+
+ezvk::AllocatedBuffer UploadBatch::uploadBuffer(const void*        data,
+                                                VkDeviceSize       size,
+                                                VkBufferUsageFlags usage) {
+  VkBufferCreateInfo bufferCI{
+      .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .pNext       = nullptr,
+      .flags       = 0,
+      .size        = size,
+      .usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  VmaAllocationCreateInfo bufferAI{.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+  ezvk::AllocatedBuffer   ret = m_allocator->createBuffer(&bufferCI, &bufferAI);
+  copyToBuffer(data, size, ret.buffer);
+  return ret;
+}
+
+void UploadBatch::copyToImage(VkImage image, VkFormat format, const u8* data,
+                              std::span<const VkBufferImageCopy> regions) {
+  // a 1x1 and a 1x4 region are both one block of a block compressed format
+  u32 rowHeight =
+      MipLevelSize(format, {1, 1}) == MipLevelSize(format, {1, 4}) ? 4 : 1;
+
+  for (const VkBufferImageCopy& region : regions) {
+    VkExtent3D extent   = region.imageExtent;
+    size_t     rowBytes = MipLevelSize(format, {extent.width, rowHeight});
+    size_t     size     = MipLevelSize(format, {extent.width, extent.height});
+
+    // a level too large for the ring goes in runs of whole rows of blocks
+    for (u32 y = 0; y < extent.height;) {
+      size_t offset = (size_t)(y / rowHeight) * rowBytes;
+      StagingRing::Span staging =
+          stage(size - offset, std::min(rowBytes, size - offset));
+      u32 rows = (u32)std::min<u64>(extent.height - y,
+                                    staging.size / rowBytes * rowHeight);
+      size_t bytes = (size_t)((rows + rowHeight - 1) / rowHeight) * rowBytes;
+      std::memcpy(staging.data, data + region.bufferOffset + offset, bytes);
+
+      VkBufferImageCopy copy = region;
+      copy.bufferOffset      = staging.offset;
+      copy.imageOffset.y     = region.imageOffset.y + (i32)y;
+      copy.imageExtent       = {extent.width, rows, 1};
+      vkCmdCopyBufferToImage(m_cmd.cmdBuffer, staging.buffer, image,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+      y += rows;
+    }
+  }
+}
+
+void UploadBatch::submit() {
+  // a barrier at the end of a submit also orders the ones after it, so the
+  // buffers can be drawn from without waiting for the fence
+  VkMemoryBarrier barrier{
+      .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .pNext         = nullptr,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                       VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT |
+                       VK_ACCESS_SHADER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(m_cmd.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                           VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+  submitRecorded();
+  m_recording = false;
+}
+
+bool UploadBatch::finished() const {
+  if (m_recording)
+    return false;
+  for (const Submit& submit : m_submits) {
+    if (vkGetFenceStatus(m_device, submit.fence) != VK_SUCCESS)
+      return false;
+  }
+  return true;
+}
+
+void UploadBatch::wait() const {
+  for (const Submit& submit : m_submits) {
+    vkWaitForFences(m_device, 1, &submit.fence, VK_TRUE,
+                    std::numeric_limits<u64>::max());
+  }
+}
+
+void UploadBatch::release() {
+  // a batch that was never submitted has nothing in flight
+  if (m_recording) {
+    m_cmd.end();
+    m_cmd.free(m_device, m_cmdPool);
+    m_ring->fence(VK_NULL_HANDLE);
+    m_recording = false;
+  }
+  wait();
+  for (Submit& submit : m_submits) {
+    m_ring->release(submit.fence);
+    vkDestroyFence(m_device, submit.fence, nullptr);
+    submit.cmd.free(m_device, m_cmdPool);
+  }
+  m_submits.clear();
+  m_stagedBytes = 0;
+}
+
+StagingRing::Span UploadBatch::stage(VkDeviceSize size,
+                                     VkDeviceSize minSize) {
+  StagingRing::Span ret = m_ring->allocate(size, minSize);
+  if (!ret.size) {
+    // the ring only holds what this batch recorded, send it off to make room
+    submitRecorded();
+    m_cmd.alloc(m_device, m_cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    m_cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    ret = m_ring->allocate(size, minSize);
+  }
+  m_stagedBytes += ret.size;
+  return ret;
+}
+
+void UploadBatch::submitRecorded() {
+  m_cmd.end();
+
+  Submit            submit{.cmd = m_cmd};
+  VkFenceCreateInfo fenceCI{
+      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+  };
+  vkCreateFence(m_device, &fenceCI, nullptr, &submit.fence);
+
+  VkSubmitInfo submitInfo{
+      .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext              = nullptr,
+      .commandBufferCount = 1,
+      .pCommandBuffers    = &submit.cmd.cmdBuffer,
+  };
+  vkQueueSubmit(m_queue, 1, &submitInfo, submit.fence);
+  m_ring->fence(submit.fence);
+  m_submits.push_back(submit);
+}
+
+} // namespace myvk::data
@@ -0,0 +1,81 @@
+#include "DataType/VertexFormat.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+namespace myvk::data {
+
+namespace {
+inline u16 toUnorm16(float value) {
+  return (u16)std::round(glm::clamp(value, 0.f, 1.f) * 65535.f);
+}
+inline i16 toSnorm16(float value) {
+  return (i16)std::round(glm::clamp(value, -1.f, 1.f) * 32767.f);
+}
+inline glm::vec2 signNotZero(const glm::vec2& v) {
+  return {v.x >= 0.f ? 1.f : -1.f, v.y >= 0.f ? 1.f : -1.f};
+}
+} // namespace
+
+VertexQuantization VertexQuantization::FromBounds(const glm::vec3& boundsMin,
+                                                  const glm::vec3& boundsMax) {
+  VertexQuantization ret;
+  ret.offset = boundsMin;
+  ret.scale  = boundsMax - boundsMin;
+  for (int i = 0; i < 3; ++i) {
+    if (ret.scale[i] <= 0.f)
+      ret.scale[i] = 1.f;
+  }
+  return ret;
+}
+
+glm::vec2 OctEncode(const glm::vec3& normal) {
+  float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (l1 == 0.f)
+    return {0.f, 0.f};
+  glm::vec3 n = normal / l1;
+  glm::vec2 ret{n.x, n.y};
+  // fold the lower hemisphere over the diagonals
+  if (n.z < 0.f)
+    ret = (1.f - glm::abs(glm::vec2{ret.y, ret.x})) * signNotZero(ret);
+  return ret;
+}
+
+glm::vec3 OctDecode(const glm::vec2& encoded) {
+  glm::vec3 n{encoded.x, encoded.y,
+              1.f - std::abs(encoded.x) - std::abs(encoded.y)};
+  if (n.z < 0.f) {
+    glm::vec2 folded = (1.f - glm::abs(glm::vec2{n.y, n.x})) *
+                       signNotZero(glm::vec2{n.x, n.y});
+    n.x = folded.x;
+    n.y = folded.y;
+  }
+  return glm::normalize(n);
+}
+
+PackedVertex PackVertex(const Vertex&             vertex,
+                        const VertexQuantization& quantization) {
+  glm::vec3 pos  = (vertex.pos - quantization.offset) / quantization.scale;
+  glm::vec2 norm = OctEncode(vertex.norm);
+  return {
+      .pos  = {toUnorm16(pos.x), toUnorm16(pos.y), toUnorm16(pos.z), 0},
+      .norm = {toSnorm16(norm.x), toSnorm16(norm.y)},
+      .uv   = {glm::packHalf1x16(vertex.uv.x), glm::packHalf1x16(vertex.uv.y)},
+  };
+}
+
+std::vector<PackedVertex> PackVertices(std::span<const Vertex>   vertices,
+                                       const VertexQuantization& quantization,
+                                       std::span<const u32>      remap) {
+  if (!remap.empty()) {
+    std::vector<PackedVertex> ret(remap.size());
+    for (size_t i = 0; i < remap.size(); ++i)
+      ret[i] = PackVertex(vertices[remap[i]], quantization);
+    return ret;
+  }
+  std::vector<PackedVertex> ret(vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i)
+    ret[i] = PackVertex(vertices[i], quantization);
+  return ret;
+}
+
+} // namespace myvk::data
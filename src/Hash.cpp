@@ -0,0 +1,110 @@
+#include "Hash.hpp"
+#include "ThreadPool.hpp"
+
+#include <bit>
+#include <cstring>
+#include <vector>
+
+namespace myvk {
+
+namespace {
+constexpr u64 kPrime1 = 11400714785074694791ull;
+constexpr u64 kPrime2 = 14029467366897019727ull;
+constexpr u64 kPrime3 = 1609587929392839161ull;
+constexpr u64 kPrime4 = 9650029242287828579ull;
+constexpr u64 kPrime5 = 2870177450012600261ull;
+
+constexpr size_t kParallelBlockSize = 8 << 20;
+
+inline u64 read64(const u8* p) {
+  u64 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline u32 read32(const u8* p) {
+  u32 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline u64 hashRound(u64 acc, u64 input) {
+  acc += input * kPrime2;
+  acc = std::rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline u64 mergeRound(u64 acc, u64 val) {
+  acc ^= hashRound(0, val);
+  return acc * kPrime1 + kPrime4;
+}
+} // namespace
+
+u64 HashBytes(const void* data, size_t size, u64 seed) {
+  const u8* p   = static_cast<const u8*>(data);
+  const u8* end = p + size;
+  u64       h;
+
+  if (size >= 32) {
+    u64 v1 = seed + kPrime1 + kPrime2;
+    u64 v2 = seed + kPrime2;
+    u64 v3 = seed;
+    u64 v4 = seed - kPrime1;
+    do {
+      v1 = hashRound(v1, read64(p));
+      v2 = hashRound(v2, read64(p + 8));
+      v3 = hashRound(v3, read64(p + 16));
+      v4 = hashRound(v4, read64(p + 24));
+      p += 32;
+    } while (p + 32 <= end);
+
+    h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+        std::rotl(v4, 18);
+    h = mergeRound(h, v1);
+    h = mergeRound(h, v2);
+    h = mergeRound(h, v3);
+    h = mergeRound(h, v4);
+  } else {
+    h = seed + kPrime5;
+  }
+
+  h += (u64)size;
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= hashRound(0, read64(p));
+    h = std::rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    h ^= (u64)read32(p) * kPrime1;
+    h = std::rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= (*p) * kPrime5;
+    h = std::rotl(h, 11) * kPrime1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+u64 HashBytesParallel(const void* data, size_t size, u64 seed) {
+  const u8* bytes      = static_cast<const u8*>(data);
+  u32       blockCount = (u32)((size + kParallelBlockSize - 1) /
+                         kParallelBlockSize);
+
+  std::vector<u64> blockHashes(blockCount);
+  ThreadPool::GetGlobal().parallelFor(blockCount, [&](u32 block) {
+    size_t offset      = (size_t)block * kParallelBlockSize;
+    blockHashes[block] = HashBytes(
+        bytes + offset, std::min(kParallelBlockSize, size - offset), seed);
+  });
+  return HashBytes(blockHashes.data(), blockHashes.size() * sizeof(u64),
+                   seed ^ (u64)size);
+}
+
+} // namespace myvk
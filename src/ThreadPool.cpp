@@ -0,0 +1,58 @@
+#include "ThreadPool.hpp"
+
+namespace myvk {
+
+ThreadPool::ThreadPool(u32 threadCount) {
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  // the thread that calls parallelFor works too, so leave one core for it
+  for (u32 i = 0; i + 1 < threadCount; ++i) {
+    m_workers.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_stop = true;
+  }
+  m_taskReady.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+ThreadPool& ThreadPool::GetGlobal() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+  if (m_workers.empty()) {
+    task();
+    return;
+  }
+  {
+    std::lock_guard lock(m_mutex);
+    m_tasks.push_back(std::move(task));
+  }
+  m_taskReady.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(m_mutex);
+      m_taskReady.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+      if (m_stop && m_tasks.empty())
+        return;
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+} // namespace myvk
@@ -28,6 +28,7 @@ std::vector g_layerNames{"VK_LAYER_KHRONOS_validation"};
 
 std::vector g_deviceExtensionNames{
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+    VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
 };
 int main() {
   {
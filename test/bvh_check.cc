@@ -0,0 +1,68 @@
+// Culls boxes through Bvh and compares the result with testing every box
+// with Frustum::intersectsBox.
+#include "DataType/Bvh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace myvk;
+using namespace myvk::data;
+
+bool check(const char* name, const std::vector<glm::vec3>& boundsMin,
+           const std::vector<glm::vec3>& boundsMax, const Frustum& frustum) {
+  Bvh bvh;
+  bvh.build(boundsMin, boundsMax);
+  std::vector<u32> visible;
+  bvh.cull(frustum, visible);
+  std::sort(visible.begin(), visible.end());
+
+  std::vector<u32> expected;
+  for (u32 i = 0; i < boundsMin.size(); ++i) {
+    if (frustum.intersectsBox(boundsMin[i], boundsMax[i]))
+      expected.push_back(i);
+  }
+  bool ok = visible == expected;
+  printf("%s: %zu boxes, %zu visible, %zu expected, %s\n", name,
+         boundsMin.size(), visible.size(), expected.size(),
+         ok ? "ok" : "MISMATCH");
+  return ok;
+}
+
+int main() {
+  glm::mat4 proj = glm::perspective(glm::radians(60.f), 1.5f, .1f, 400.f);
+  glm::mat4 view = glm::lookAt(glm::vec3{0.f}, glm::vec3{1.f, .3f, .2f},
+                               glm::vec3{0.f, 1.f, 0.f});
+  Frustum   frustum = Frustum::FromMatrix(proj * view);
+  bool      ok      = true;
+
+  std::mt19937                          rng(1);
+  std::uniform_real_distribution<float> position(-500.f, 500.f);
+  std::uniform_real_distribution<float> size(.1f, 3.f);
+  std::vector<glm::vec3>                boundsMin, boundsMax;
+  for (u32 i = 0; i < 100000; ++i) {
+    glm::vec3 center{position(rng), position(rng), position(rng)};
+    glm::vec3 extent{size(rng), size(rng), size(rng)};
+    boundsMin.push_back(center - extent);
+    boundsMax.push_back(center + extent);
+  }
+  ok &= check("random", boundsMin, boundsMax, frustum);
+
+  // spread over many orders of magnitude, SAH splits off few boxes at a time
+  boundsMin.clear();
+  boundsMax.clear();
+  for (u32 i = 0; i < 200; ++i) {
+    glm::vec3 center{std::pow(1.5f, (float)i), 0.f, 0.f};
+    boundsMin.push_back(center - .5f);
+    boundsMax.push_back(center + .5f);
+  }
+  ok &= check("chain", boundsMin, boundsMax, frustum);
+
+  // boxes in one point have no axis to split on
+  boundsMin.assign(1000, glm::vec3{10.f, 0.f, 0.f});
+  boundsMax.assign(1000, glm::vec3{11.f, 1.f, 1.f});
+  ok &= check("coincident", boundsMin, boundsMax, frustum);
+
+  return ok ? 0 : 1;
+}
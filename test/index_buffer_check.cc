@@ -0,0 +1,190 @@
+// Round trips index streams through EncodeIndices and DecodeIndices, and
+// checks that CompactIndices splits large meshes into 16 bit chunks whose
+// indices lead back to the source vertices through vertexRemap.
+#include "DataType/IndexBuffer.hpp"
+#include "DataType/VertexFormat.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace myvk;
+using namespace myvk::data;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+bool roundTrips(const std::vector<u32>& indices) {
+  std::vector<u8>  encoded = EncodeIndices(indices);
+  std::vector<u32> decoded(indices.size());
+  return DecodeIndices(encoded, decoded) && decoded == indices;
+}
+
+constexpr u32 kSide = 300;
+
+// a (kSide + 1)^2 vertex grid, two triangles per cell in row order
+std::vector<u32> gridIndices() {
+  std::vector<u32> ret;
+  for (u32 y = 0; y < kSide; ++y)
+    for (u32 x = 0; x < kSide; ++x) {
+      u32 i = y * (kSide + 1) + x;
+      ret.insert(ret.end(), {i, i + 1, i + kSide + 2, i, i + kSide + 2,
+                             i + kSide + 1});
+    }
+  return ret;
+}
+
+// the source triangles of compact, sorted, by way of the chunks
+std::vector<std::array<u32, 3>> uploadedTriangles(
+    const CompactIndices& compact) {
+  std::vector<std::array<u32, 3>> ret;
+  for (const IndexChunk& chunk : compact.chunks) {
+    for (u32 i = chunk.firstIndex; i < chunk.firstIndex + chunk.indexCount;
+         i += 3) {
+      std::array<u32, 3> t;
+      for (u32 c = 0; c < 3; ++c)
+        t[c] = compact.vertexRemap[chunk.vertexOffset +
+                                   compact.indices16[i + c]];
+      ret.push_back(t);
+    }
+  }
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
+
+std::vector<std::array<u32, 3>> sourceTriangles(
+    const std::vector<u32>& indices) {
+  std::vector<std::array<u32, 3>> ret;
+  for (size_t i = 0; i < indices.size(); i += 3)
+    ret.push_back({indices[i], indices[i + 1], indices[i + 2]});
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
+
+bool chunksFit(const CompactIndices& compact, size_t indexCount) {
+  u32 next = 0;
+  for (const IndexChunk& chunk : compact.chunks) {
+    if (chunk.firstIndex != next || chunk.indexCount % 3 != 0)
+      return false;
+    next += chunk.indexCount;
+  }
+  return next == indexCount;
+}
+
+int main() {
+  // deltas at the extremes of the zigzag range and wrap around
+  expect(roundTrips({}), "empty");
+  expect(roundTrips({0, 0xFFFFFFFFu, 0, 0x80000000u, 0x7FFFFFFFu, 1, 127,
+                     128, 16383, 16384, 0xFFFFFFFFu, 0xFFFFFFFEu}),
+         "extreme deltas");
+  std::mt19937     random(5);
+  std::vector<u32> noise(10000);
+  for (u32& index : noise)
+    index = random();
+  expect(roundTrips(noise), "random indices");
+
+  std::vector<u32> grid    = gridIndices();
+  std::vector<u8>  encoded = EncodeIndices(grid);
+  expect(encoded.size() < grid.size() * 2, "grid is compressed");
+  std::vector<u32> decoded(grid.size());
+  expect(!DecodeIndices({encoded.data(), encoded.size() - 1}, decoded),
+         "truncated input");
+  encoded.push_back(0);
+  expect(!DecodeIndices(encoded, decoded), "trailing bytes");
+  // a varint longer than five bytes
+  const u8 overlong[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+  u32      one;
+  expect(!DecodeIndices(overlong, {&one, 1}), "overlong varint");
+
+  // small meshes keep their indices and vertices
+  std::vector<u32> small = {0, 1, 2, 2, 1, 65535};
+  CompactIndices   direct = CompactIndices::Build(small, 65536, {});
+  expect(direct.type == VK_INDEX_TYPE_UINT16 && direct.chunks.size() == 1 &&
+             direct.vertexRemap.empty() && direct.indices16[5] == 65535,
+         "small mesh");
+
+  // 90601 vertices do not fit one chunk
+  size_t         gridVertices = (kSide + 1) * (kSide + 1);
+  CompactIndices chunked      = CompactIndices::Build(grid, gridVertices, {});
+  expect(chunked.type == VK_INDEX_TYPE_UINT16 && chunked.chunks.size() > 1,
+         "grid is chunked");
+  expect(chunksFit(chunked, grid.size()), "chunks cover the indices");
+  expect(chunked.vertexRemap.size() < gridVertices + gridVertices / 8,
+         "few duplicated vertices");
+  expect(uploadedTriangles(chunked) == sourceTriangles(grid),
+         "chunks remap to the source");
+
+  // vertices no triangle uses are left out of the remap
+  CompactIndices sparse = CompactIndices::Build(grid, gridVertices + 1000, {});
+  expect(sparse.type == VK_INDEX_TYPE_UINT16 &&
+             sparse.vertexRemap.size() == chunked.vertexRemap.size(),
+         "unused vertices");
+
+  // meshlets of 50 triangles each stay whole and take their chunk's offset
+  std::vector<Meshlet> meshlets;
+  for (u32 first = 0; first < grid.size(); first += 150) {
+    Meshlet meshlet{};
+    meshlet.firstIndex = first;
+    meshlet.indexCount = std::min<u32>(150, (u32)grid.size() - first);
+    u32 v              = grid[first];
+    meshlet.center = {(float)(v % (kSide + 1)), (float)(v / (kSide + 1)), 0.f};
+    meshlets.push_back(meshlet);
+  }
+  CompactIndices clustered =
+      CompactIndices::Build(grid, gridVertices, meshlets);
+  expect(clustered.type == VK_INDEX_TYPE_UINT16 &&
+             chunksFit(clustered, grid.size()),
+         "meshlet chunks");
+  expect(uploadedTriangles(clustered) == sourceTriangles(grid),
+         "meshlet chunks remap to the source");
+  bool meshletsInChunks = true;
+  for (const Meshlet& meshlet : meshlets) {
+    auto chunk = std::find_if(
+        clustered.chunks.begin(), clustered.chunks.end(),
+        [&](const IndexChunk& c) {
+          return meshlet.firstIndex >= c.firstIndex &&
+                 meshlet.firstIndex + meshlet.indexCount <=
+                     c.firstIndex + c.indexCount;
+        });
+    if (chunk == clustered.chunks.end() ||
+        chunk->vertexOffset != meshlet.vertexOffset)
+      meshletsInChunks = false;
+  }
+  expect(meshletsInChunks, "meshlets stay in one chunk");
+
+  // the remap decides which vertices are packed
+  std::vector<Vertex> vertices(gridVertices);
+  for (size_t i = 0; i < vertices.size(); ++i)
+    vertices[i].pos = {(float)(i % (kSide + 1)), (float)(i / (kSide + 1)), 0};
+  VertexQuantization quantization = VertexQuantization::FromBounds(
+      vertices.front().pos, vertices.back().pos);
+  std::vector<PackedVertex> packed =
+      PackVertices(vertices, quantization, chunked.vertexRemap);
+  PackedVertex expected = PackVertex(
+      vertices[chunked.vertexRemap.back()], quantization);
+  expect(packed.size() == chunked.vertexRemap.size() &&
+             std::memcmp(&packed.back(), &expected, sizeof(expected)) == 0,
+         "packed through the remap");
+
+  // scattered triangles would duplicate too many vertices, 32 bit indices
+  // are kept instead
+  std::vector<u32> scattered(200000 * 3);
+  for (u32& index : scattered)
+    index = random() % 70000;
+  CompactIndices wide = CompactIndices::Build(scattered, 70000, {});
+  expect(wide.type == VK_INDEX_TYPE_UINT32 && wide.vertexRemap.empty() &&
+             wide.chunks.size() == 1 &&
+             wide.chunks[0].indexCount == scattered.size(),
+         "32 bit fallback");
+
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
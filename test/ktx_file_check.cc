@@ -0,0 +1,81 @@
+// Writes a BC mip chain with KtxFile, reads it back and checks that stale
+// and truncated caches are refused.
+#include "DataType/KtxFile.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace myvk;
+using namespace myvk::data;
+
+namespace fs = std::filesystem;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+int main() {
+  constexpr u32 kWidth = 21, kHeight = 10;
+
+  std::vector<u8> image(kWidth * kHeight * 4);
+  for (size_t i = 0; i < image.size(); ++i)
+    image[i] = (u8)(i * 7 % 251);
+  MipChain chain = EncodeBC(MipChain::Build(image.data(), kWidth, kHeight));
+
+  // the cache only looks at the size, time and hash of its source
+  std::string source = (fs::temp_directory_path() / "ktx_file_check.bin")
+                           .string();
+  {
+    std::ofstream out(source, std::ios::binary | std::ios::trunc);
+    out.write((const char*)image.data(), image.size());
+  }
+  expect(KtxFile::Write(source.c_str(), chain), "write");
+
+  KtxFile file;
+  expect(file.open(source.c_str()), "open");
+  expect(file.format() == chain.format, "format");
+  expect(file.levelCount() == chain.extents.size(), "level count");
+  for (u32 level = 0; level < file.levelCount(); ++level) {
+    VkExtent2D extent = file.extents()[level];
+    size_t     size   = MipLevelSize(chain.format, extent);
+    expect(extent.width == chain.extents[level].width &&
+               extent.height == chain.extents[level].height,
+           "extent");
+    expect(file.offsets()[level] + size <= file.levelData().size() &&
+               std::memcmp(file.levelData().data() + file.offsets()[level],
+                           chain.pixels.data() + chain.offsets[level],
+                           size) == 0,
+           "level data");
+  }
+  file.close();
+
+  // a touched but unchanged source still matches its hash
+  fs::last_write_time(source, fs::last_write_time(source) +
+                                  std::chrono::seconds(10));
+  expect(file.open(source.c_str()), "open after touch");
+  file.close();
+
+  {
+    std::ofstream out(source, std::ios::binary | std::ios::app);
+    out.put(0);
+  }
+  expect(!file.open(source.c_str()), "stale source refused");
+
+  expect(KtxFile::Write(source.c_str(), chain), "rewrite");
+  std::string path = KtxFile::PathFor(source.c_str());
+  fs::resize_file(path, fs::file_size(path) - 1);
+  expect(!file.open(source.c_str()), "truncated cache refused");
+
+  fs::remove(path);
+  fs::remove(source);
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// Moves a camera back and forth in front of a lod chain and checks that
+// LodSelector only switches levels past the hysteresis band, and builds a
+// chain for a grid to check that its levels get coarser.
+#include "DataType/Lod.hpp"
+
+#include <cstdio>
+
+using namespace myvk;
+using namespace myvk::data;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+int main() {
+  // a 90 degree projection on a 1000 pixel viewport gives 500 / distance
+  // pixels per unit, so a level with error e fits one pixel from 500 * e
+  // on and is taken from 500 * e / 0.75 on
+  glm::mat4             proj   = glm::perspective(glm::radians(90.f), 1.f, .1f,
+                                                  1000.f);
+  std::vector<LodLevel> levels = {{0, 3, .01f}, {3, 3, .02f}, {6, 3, .04f}};
+  LodSelector           selector;
+  auto select = [&](float distance) {
+    return selector.select(levels, proj, 1000.f, distance);
+  };
+
+  expect(select(1.f) == 0, "close up");
+  expect(select(5.5f) == 0, "inside the band, no coarser level yet");
+  expect(select(7.f) == 1, "past the band");
+  expect(select(5.5f) == 1, "inside the band, the level stays");
+  expect(select(4.9f) == 0, "too coarse for one pixel");
+  expect(select(100.f) == 3, "jumps to the coarsest");
+  expect(select(15.f) == 2, "one level back");
+  expect(select(1000.f) == 3 && selector.level() == 3, "far away");
+  selector.reset();
+  expect(selector.level() == 0, "reset");
+  expect(selector.select({}, proj, 1000.f, 100.f) == 0, "no levels");
+
+  // a finely tessellated flat grid simplifies well
+  constexpr u32       kSide = 64;
+  std::vector<Vertex> vertices;
+  for (u32 y = 0; y <= kSide; ++y)
+    for (u32 x = 0; x <= kSide; ++x) {
+      Vertex v{};
+      v.pos  = {(float)x, (float)y, 0.f};
+      v.norm = {0.f, 0.f, 1.f};
+      vertices.push_back(v);
+    }
+  std::vector<u32> indices;
+  for (u32 y = 0; y < kSide; ++y)
+    for (u32 x = 0; x < kSide; ++x) {
+      u32 i = y * (kSide + 1) + x;
+      indices.insert(indices.end(), {i, i + 1, i + kSide + 2, i,
+                                     i + kSide + 2, i + kSide + 1});
+    }
+  LodChain chain = LodChain::Build(vertices, indices);
+  expect(!chain.levels.empty(), "levels are built");
+  u32   previous = (u32)indices.size();
+  float error    = 0.f;
+  bool  coarser = true, inRange = true;
+  for (const LodLevel& level : chain.levels) {
+    coarser &= level.indexCount < previous && level.error >= error;
+    previous = level.indexCount;
+    error    = level.error;
+    inRange &= (u64)level.firstIndex + level.indexCount <=
+               chain.indices.size();
+  }
+  expect(coarser, "levels get coarser");
+  expect(inRange, "levels index the chain");
+  bool valid = true;
+  for (u32 index : chain.indices)
+    valid &= index < vertices.size();
+  expect(valid, "levels index the full vertices");
+
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
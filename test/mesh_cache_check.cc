@@ -0,0 +1,136 @@
+// Writes a mesh cache, reads it back and checks that truncated, corrupt,
+// outdated and stale caches are refused, and that ObjModel parses the source
+// again and replaces such a cache.
+#include "DataType/MeshCache.hpp"
+#include "DataType/Model.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace myvk;
+using namespace myvk::data;
+
+namespace fs = std::filesystem;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+void writeFile(const std::string& path, const std::string& text) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << text;
+}
+
+void patchFile(const std::string& path, size_t offset, const void* data,
+               size_t size) {
+  std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+  out.seekp((std::streamoff)offset);
+  out.write((const char*)data, (std::streamsize)size);
+}
+
+int main() {
+  std::string source = (fs::temp_directory_path() / "mesh_cache_check.obj")
+                           .string();
+  std::string cache  = MeshCache::PathFor(source.c_str());
+  const char  quad[] = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n";
+  writeFile(source, quad);
+
+  std::vector<Vertex> vertices(4);
+  for (u32 i = 0; i < 4; ++i)
+    vertices[i].pos = {(float)(i == 1 || i == 2), (float)(i >= 2), 0.f};
+  std::vector<u32> indices = {0, 1, 2, 0, 2, 3};
+  glm::vec3        boundsMin{0.f}, boundsMax{1.f, 1.f, 0.f};
+  u64              sourceHash = MeshCache::HashSource(source.c_str());
+
+  auto writeCache = [&] {
+    return MeshCache::Write(source.c_str(), sourceHash, vertices, indices,
+                            boundsMin, boundsMax);
+  };
+
+  MeshCache meshCache;
+  expect(writeCache(), "write");
+  expect(meshCache.open(source.c_str()), "open");
+  expect(meshCache.isOpen() && meshCache.vertices().size() == 4 &&
+             meshCache.vertices()[2] == vertices[2],
+         "vertices");
+  expect(meshCache.isOpen() && meshCache.indices().size() == 6 &&
+             std::equal(indices.begin(), indices.end(),
+                        meshCache.indices().begin()),
+         "indices");
+  expect(meshCache.isOpen() && meshCache.header().boundsMax == boundsMax,
+         "bounds");
+  meshCache.close();
+
+  // a truncated payload and a file shorter than the header
+  fs::resize_file(cache, fs::file_size(cache) - 4);
+  expect(!meshCache.open(source.c_str()), "truncated cache");
+  fs::resize_file(cache, sizeof(MeshCacheHeader) / 2);
+  expect(!meshCache.open(source.c_str()), "cut into the header");
+
+  // bytes that were never a cache
+  std::string garbage(4096, '\0');
+  for (size_t i = 0; i < garbage.size(); ++i)
+    garbage[i] = (char)(i * 131 % 251);
+  writeFile(cache, garbage);
+  expect(!meshCache.open(source.c_str()), "garbage");
+
+  // a payload byte that flipped on disk
+  expect(writeCache(), "rewrite");
+  u8 flipped = 0xff;
+  patchFile(cache, fs::file_size(cache) - 1, &flipped, 1);
+  expect(!meshCache.open(source.c_str()), "corrupt payload");
+
+  // written by another version of the format
+  expect(writeCache(), "rewrite");
+  u32 version = MeshCache::kVersion + 1;
+  patchFile(cache, offsetof(MeshCacheHeader, version), &version,
+            sizeof(version));
+  expect(!meshCache.open(source.c_str()), "other version");
+
+  // touched without a change, the hash still matches and the new mtime is
+  // stored so the next open does not hash again
+  expect(writeCache(), "rewrite");
+  auto touched = fs::last_write_time(source) + std::chrono::seconds(10);
+  fs::last_write_time(source, touched);
+  expect(meshCache.open(source.c_str()), "touched source");
+  expect(meshCache.isOpen() && meshCache.header().sourceTime ==
+                                   touched.time_since_epoch().count(),
+         "mtime is updated");
+  meshCache.close();
+
+  // same size, new content and a new mtime
+  writeFile(source, std::string(quad).replace(2, 1, "2"));
+  fs::last_write_time(source, touched + std::chrono::seconds(10));
+  expect(!meshCache.open(source.c_str()), "changed source");
+
+  // ObjModel parses the source when the cache is refused and writes it
+  // again, the next load comes from the cache
+  writeFile(cache, garbage);
+  {
+    ObjModel parsed(source.c_str());
+    expect(!parsed.vertices.empty() && parsed.indexData().size() == 6,
+           "parsed after a bad cache");
+  }
+  expect(meshCache.open(source.c_str()), "cache written again");
+  meshCache.close();
+  {
+    ObjModel cached(source.c_str());
+    expect(cached.vertices.empty() && cached.vertexData().size() == 4 &&
+               cached.boundsMax == glm::vec3(2.f, 1.f, 0.f),
+           "loaded from the cache");
+  }
+
+  fs::remove(cache);
+  fs::remove(source);
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Runs MeshOptimizer over a shuffled grid and checks that it keeps every
+// triangle with its winding, improves the vertex cache and stores the
+// vertices in first use order, and that welding merges only close vertices.
+#include "DataType/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <random>
+
+using namespace myvk;
+using namespace myvk::data;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+using Corner   = std::array<float, 5>;
+using Triangle = std::array<Corner, 3>;
+
+// every triangle by value, each starting at its smallest corner
+std::vector<Triangle> triangles(const std::vector<Vertex>& vertices,
+                                const std::vector<u32>&    indices) {
+  std::vector<Triangle> ret;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    Triangle t;
+    for (u32 c = 0; c < 3; ++c) {
+      const Vertex& v = vertices[indices[i + c]];
+      t[c]            = {v.pos.x, v.pos.y, v.pos.z, v.uv.x, v.uv.y};
+    }
+    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+    ret.push_back(t);
+  }
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
+
+int main() {
+  constexpr u32 kSide = 64;
+
+  std::vector<Vertex> vertices;
+  for (u32 y = 0; y <= kSide; ++y)
+    for (u32 x = 0; x <= kSide; ++x) {
+      Vertex v{};
+      v.pos  = {(float)x, (float)y, 0.f};
+      v.norm = {0.f, 0.f, 1.f};
+      v.uv   = {(float)x / kSide, (float)y / kSide};
+      vertices.push_back(v);
+    }
+  std::vector<std::array<u32, 3>> quads;
+  for (u32 y = 0; y < kSide; ++y)
+    for (u32 x = 0; x < kSide; ++x) {
+      u32 i = y * (kSide + 1) + x;
+      quads.push_back({i, i + 1, i + kSide + 2});
+      quads.push_back({i, i + kSide + 2, i + kSide + 1});
+    }
+  std::shuffle(quads.begin(), quads.end(), std::mt19937(7));
+  std::vector<u32> indices;
+  for (auto& t : quads)
+    indices.insert(indices.end(), t.begin(), t.end());
+
+  std::vector<Triangle> before = triangles(vertices, indices);
+  float                 acmr =
+      MeshOptimizer::AnalyzeVertexCache(indices, vertices.size()).acmr;
+
+  std::vector<Vertex> optimizedVertices = vertices;
+  std::vector<u32>    optimizedIndices  = indices;
+  MeshOptimizer::Optimize(optimizedVertices, optimizedIndices);
+
+  expect(optimizedVertices.size() == vertices.size(), "vertex count");
+  expect(triangles(optimizedVertices, optimizedIndices) == before,
+         "same triangles");
+  expect(MeshOptimizer::AnalyzeVertexCache(optimizedIndices,
+                                           optimizedVertices.size())
+                 .acmr < acmr,
+         "better vertex cache");
+
+  // the vertices come in the order the indices first use them
+  u32  next    = 0;
+  bool inOrder = true;
+  for (u32 index : optimizedIndices) {
+    if (index > next)
+      inOrder = false;
+    if (index == next)
+      ++next;
+  }
+  expect(inOrder && next == optimizedVertices.size(), "first use order");
+
+  // the cache pass alone only reorders triangles, the clusters start at 0
+  std::vector<u32> cacheIndices = indices;
+  std::vector<u32> clusters =
+      MeshOptimizer::OptimizeVertexCache(cacheIndices, vertices.size(), 16);
+  expect(triangles(vertices, cacheIndices) == before, "cache pass");
+  expect(!clusters.empty() && clusters[0] == 0 &&
+             std::is_sorted(clusters.begin(), clusters.end()),
+         "clusters");
+
+  // a copy of vertex 0 within the epsilon is merged, the triangle through
+  // both collapses and is dropped, a farther copy stays. The unused vertex
+  // is left for OptimizeVertexFetch to drop.
+  std::vector<Vertex> weldVertices(vertices.begin(), vertices.begin() + 3);
+  weldVertices.push_back(weldVertices[0]);
+  weldVertices.back().pos.x += 1e-7f;
+  weldVertices.push_back(weldVertices[0]);
+  weldVertices.back().pos.x += 0.01f;
+  std::vector<u32> weldIndices = {0, 1, 2, 3, 1, 2, 0, 3, 1, 4, 1, 2};
+  MeshOptimizer::WeldVertices(weldVertices, weldIndices, 1e-6f, 1e-4f);
+  expect(weldIndices.size() == 9, "collapsed triangle");
+  expect(std::count(weldIndices.begin(), weldIndices.end(), 3) == 0,
+         "close copy merged");
+  expect(std::count(weldIndices.begin(), weldIndices.end(), 4) == 1,
+         "far copy kept");
+
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
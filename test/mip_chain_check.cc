@@ -0,0 +1,80 @@
+// Builds mip chains of odd sized images with MipChain::Build and EncodeBC
+// and checks their layout and filtered colors.
+#include "DataType/Texture.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace myvk;
+using namespace myvk::data;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+// levels follow each other without gaps, each its size in format
+void expectLayout(const MipChain& chain, VkFormat format, ccstr name) {
+  expect(chain.format == format, name);
+  size_t offset = 0;
+  for (u32 level = 0; level < chain.extents.size(); ++level) {
+    expect(chain.offsets[level] == offset, name);
+    offset += MipLevelSize(format, chain.extents[level]);
+  }
+  expect(chain.pixels.size() == offset, name);
+}
+
+int main() {
+  constexpr u32 kWidth = 13, kHeight = 7;
+
+  // a checker of black and white, with alpha alternating by column
+  std::vector<u8> image(kWidth * kHeight * 4);
+  for (u32 y = 0; y < kHeight; ++y) {
+    for (u32 x = 0; x < kWidth; ++x) {
+      u8* texel = &image[(y * kWidth + x) * 4];
+      u8  value = (x + y) % 2 ? 255 : 0;
+      texel[0] = texel[1] = texel[2] = value;
+      texel[3]                       = x % 2 ? 255 : 0;
+    }
+  }
+  MipChain chain = MipChain::Build(image.data(), kWidth, kHeight);
+
+  const VkExtent2D kExtents[] = {{13, 7}, {6, 3}, {3, 1}, {1, 1}};
+  expect(chain.extents.size() == 4, "13x7 has four levels");
+  for (u32 level = 0; level < 4 && level < chain.extents.size(); ++level) {
+    expect(chain.extents[level].width == kExtents[level].width &&
+               chain.extents[level].height == kExtents[level].height,
+           "level extents halve and round down");
+  }
+  expectLayout(chain, VK_FORMAT_R8G8B8A8_SRGB, "rgba layout");
+
+  // half black and half white is 0.5 in linear space, 187 or 188 in sRGB,
+  // not the 128 of averaging the encoded values
+  const u8* level1 = chain.pixels.data() + chain.offsets[1];
+  for (u32 i = 0; i < 6 * 3; ++i) {
+    expect(std::abs(level1[i * 4] - 188) <= 1, "colors average linearly");
+    expect(level1[i * 4 + 3] == 128, "alpha averages as stored");
+  }
+
+  // every texel opaque picks BC1, 8 bytes per 4x4 block
+  for (u32 i = 0; i < kWidth * kHeight; ++i)
+    image[i * 4 + 3] = 255;
+  MipChain opaque = EncodeBC(MipChain::Build(image.data(), kWidth, kHeight));
+  expectLayout(opaque, VK_FORMAT_BC1_RGB_SRGB_BLOCK, "bc1 layout");
+  // 4x2, 2x1, 1x1 and 1x1 blocks
+  expect(opaque.pixels.size() == (8 + 2 + 1 + 1) * 8, "bc1 size");
+
+  // BC3 with 16 bytes per block once a texel is translucent
+  image[3] = 254;
+  MipChain translucent =
+      EncodeBC(MipChain::Build(image.data(), kWidth, kHeight));
+  expectLayout(translucent, VK_FORMAT_BC3_SRGB_BLOCK, "bc3 layout");
+  expect(translucent.pixels.size() == (8 + 2 + 1 + 1) * 16, "bc3 size");
+
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// Loads cubes with hard edges through ObjModel and checks that every corner
+// keeps its own normal while corners with the same index tuple share one
+// vertex, and that the triangles are the ones in the file.
+#include "DataType/Model.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <glm/gtc/type_ptr.hpp>
+#include <string>
+
+using namespace myvk;
+using namespace myvk::data;
+
+namespace fs = std::filesystem;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+constexpr u32 kCubes = 2000;
+
+// Each cube has 8 positions, 6 face normals and 4 texcoords. Every face
+// is a quad of 4 corners, so a cube has 24 distinct tuples and a position is
+// shared by three of them. The texcoords of the first cube start at vt 1,
+// which is index 0 once parsed.
+std::string makeCubes() {
+  constexpr int kFaces[6][4] = {{1, 2, 3, 4}, {5, 8, 7, 6}, {1, 5, 6, 2},
+                                {2, 6, 7, 3}, {3, 7, 8, 4}, {5, 1, 4, 8}};
+  std::string   text;
+  char          line[128];
+  for (u32 cube = 0; cube < kCubes; ++cube) {
+    float x = 3.f * (float)(cube % 50), y = 3.f * (float)(cube / 50);
+    for (u32 i = 0; i < 8; ++i) {
+      snprintf(line, sizeof(line), "v %g %g %g\n", x + (float)(i & 1),
+               y + (float)(i >> 1 & 1), (float)(i >> 2 & 1));
+      text += line;
+    }
+    text += "vn 0 0 -1\nvn 0 0 1\nvn 0 -1 0\nvn 1 0 0\nvn 0 1 0\nvn -1 0 0\n";
+    text += "vt 0.25 0.5\nvt 1 0.5\nvt 1 1\nvt 0.25 1\n";
+    for (u32 face = 0; face < 6; ++face) {
+      text += "f";
+      for (u32 corner = 0; corner < 4; ++corner) {
+        snprintf(line, sizeof(line), " %u/%u/%u",
+                 cube * 8 + kFaces[face][corner], cube * 4 + corner + 1,
+                 cube * 6 + face + 1);
+        text += line;
+      }
+      text += "\n";
+    }
+  }
+  return text;
+}
+
+using Corner   = std::array<float, 8>;
+using Triangle = std::array<Corner, 3>;
+
+Corner cornerOf(const Vertex& v) {
+  return {v.pos.x, v.pos.y, v.pos.z, v.norm.x,
+          v.norm.y, v.norm.z, v.uv.x, v.uv.y};
+}
+
+// starts at the smallest corner, the winding stays
+Triangle canonical(Triangle t) {
+  auto first = std::min_element(t.begin(), t.end());
+  std::rotate(t.begin(), first, t.end());
+  return t;
+}
+
+int main() {
+  std::string path = (fs::temp_directory_path() / "obj_dedup_check.obj")
+                         .string();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << makeCubes();
+  }
+
+  ObjLoadOptions options;
+  options.useCache = false;
+  ObjModel model(path.c_str(), options);
+
+  expect(model.vertices.size() == kCubes * 24, "one vertex per tuple");
+  expect(model.indices.size() == kCubes * 36, "index count");
+
+  std::vector<Corner> corners;
+  for (const Vertex& v : model.vertices)
+    corners.push_back(cornerOf(v));
+  std::sort(corners.begin(), corners.end());
+  expect(std::adjacent_find(corners.begin(), corners.end()) == corners.end(),
+         "no vertex is stored twice");
+
+  // the same triangles as a plain walk over the parsed tuples, this also
+  // catches attributes at index 0 that are left out
+  ObjParser parser;
+  expect(parser.parse(path.c_str()), "parse");
+  const tinyobj::attrib_t& attrib = parser.attrib;
+  std::vector<Triangle>    expected, loaded;
+  for (size_t i = 0; i + 2 < parser.indices.size(); i += 3) {
+    Triangle t;
+    for (u32 c = 0; c < 3; ++c) {
+      const tinyobj::index_t& tuple = parser.indices[i + c];
+      Vertex                  v{};
+      v.pos  = glm::make_vec3(&attrib.vertices[3 * tuple.vertex_index]);
+      v.norm = glm::make_vec3(&attrib.normals[3 * tuple.normal_index]);
+      v.uv   = {attrib.texcoords[2 * tuple.texcoord_index],
+                1 - attrib.texcoords[2 * tuple.texcoord_index + 1]};
+      t[c]   = cornerOf(v);
+    }
+    expected.push_back(canonical(t));
+  }
+  for (size_t i = 0; i + 2 < model.indices.size(); i += 3) {
+    Triangle t;
+    for (u32 c = 0; c < 3; ++c)
+      t[c] = cornerOf(model.vertices[model.indices[i + c]]);
+    loaded.push_back(canonical(t));
+  }
+  std::sort(expected.begin(), expected.end());
+  std::sort(loaded.begin(), loaded.end());
+  expect(loaded == expected, "triangles");
+
+  fs::remove(path);
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
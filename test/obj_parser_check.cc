@@ -0,0 +1,146 @@
+// Parses a generated obj file with ObjParser and with tinyobj and checks that
+// both give the same attributes and triangles, across chunk boundaries too.
+#include "DataType/ObjParser.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace myvk;
+using namespace myvk::data;
+
+namespace fs = std::filesystem;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+// Every cell adds four corners of a kite whose 0-2 diagonal is the shorter
+// one, so tinyobj splits the quads the same way as the fans do. The faces
+// mix all index forms, absolute and relative ones, and some reach back into
+// the cell before, which lands in the chunk before now and then.
+std::string makeObj(u32 cells) {
+  std::string text = "# generated\r\n";
+  char        line[128];
+  for (u32 cell = 0; cell < cells; ++cell) {
+    if (cell % 1000 == 0) {
+      snprintf(line, sizeof(line), "o part%u\ng group%u\ns %u\n", cell, cell,
+               cell % 2);
+      text += line;
+    }
+    float x = (float)(cell % 300) * 2.5f, y = (float)(cell / 300) * 4.5f;
+    float corners[4][2] = {{x, y}, {x + 1.f, y - 2.f}, {x + 2.f, y},
+                           {x + 1.f, y + 2.f}};
+    for (auto& c : corners) {
+      snprintf(line, sizeof(line), "v %.4f %.4f %.4f\n", c[0], c[1],
+               0.001f * (float)cell);
+      text += line;
+    }
+    for (u32 i = 0; i < 4; ++i) {
+      snprintf(line, sizeof(line), "vt %.5f %.5f\nvn 0 %.3f 1\n", 0.25f * i,
+               0.001f * (float)(cell % 1000), 0.01f * (float)i);
+      text += line;
+    }
+
+    u32 v = cell * 4 + 1;
+    switch (cell % 5) {
+    case 0:
+      snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n",
+               v, v, v, v + 1, v + 1, v + 1, v + 2, v + 2, v + 2, v + 3, v + 3,
+               v + 3);
+      break;
+    case 1:
+      snprintf(line, sizeof(line), "f -4//-4 -3//-3 -2//-2\r\n");
+      break;
+    case 2:
+      snprintf(line, sizeof(line), "f %u/%u  %u/%u\t%u/%u\n", v, v, v + 2,
+               v + 2, v + 3, v + 3);
+      break;
+    case 3:
+      snprintf(line, sizeof(line), "f -4 -3 -2 -1\n");
+      break;
+    default:
+      // the first corner of the cell before
+      snprintf(line, sizeof(line), "f -8/-8/-8 -3/-3/-3 -2/-2/-2\n");
+      break;
+    }
+    text += line;
+  }
+  return text;
+}
+
+bool sameFloats(const std::vector<float>& a, const std::vector<float>& b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); ++i)
+    if (std::abs(a[i] - b[i]) > 1e-6f * std::max(1.f, std::abs(b[i])))
+      return false;
+  return true;
+}
+
+bool sameIndices(const std::vector<tinyobj::index_t>& a,
+                 const std::vector<tinyobj::index_t>& b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); ++i)
+    if (a[i].vertex_index != b[i].vertex_index ||
+        a[i].texcoord_index != b[i].texcoord_index ||
+        a[i].normal_index != b[i].normal_index)
+      return false;
+  return true;
+}
+
+int main() {
+  // large enough to be split into a few chunks
+  std::string text = makeObj(40000);
+  expect(text.size() > (3u << 20), "generated file is too small");
+
+  std::string path = (fs::temp_directory_path() / "obj_parser_check.obj")
+                         .string();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << text;
+  }
+
+  ObjParser parsed, reference;
+  expect(parsed.parse(path.c_str()), "parse");
+  expect(reference.parseWithTinyObj(path.c_str()), "parse with tinyobj");
+  expect(sameFloats(parsed.attrib.vertices, reference.attrib.vertices),
+         "positions");
+  expect(sameFloats(parsed.attrib.texcoords, reference.attrib.texcoords),
+         "texcoords");
+  expect(sameFloats(parsed.attrib.normals, reference.attrib.normals),
+         "normals");
+  expect(sameIndices(parsed.indices, reference.indices), "indices");
+
+  // the text itself parses to the same as the mapped file
+  ObjParser fromText;
+  expect(fromText.parse(text.data(), text.size()), "parse text");
+  expect(sameIndices(fromText.indices, parsed.indices), "text indices");
+
+  // polygons are fans around their first corner
+  const char polygon[] = "v 0 0 0\nv 1 0 0\nv 2 1 0\nv 1 2 0\nv 0 1 0\n"
+                         "f 1 2 3 4 5 # five\n";
+  ObjParser fan;
+  expect(fan.parse(polygon, sizeof(polygon) - 1), "parse polygon");
+  std::vector<int> corners;
+  for (auto& index : fan.indices)
+    corners.push_back(index.vertex_index);
+  expect(corners == std::vector<int>{0, 1, 2, 0, 2, 3, 0, 3, 4}, "fan");
+
+  // a face that can not be read fails the parse
+  const char broken[] = "v 0 0 0\nf 1 x 1\n";
+  ObjParser failed;
+  expect(!failed.parse(broken, sizeof(broken) - 1), "broken face");
+
+  fs::remove(path);
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+// Allocates and frees ranges through RangeAllocator and checks the best fit
+// choice, alignment and the merging of free neighbours.
+#include "DataType/GeometryBuffer.hpp"
+
+#include <cstdio>
+#include <optional>
+
+using namespace myvk;
+using namespace myvk::data;
+
+bool g_ok = true;
+
+void expect(const char* what, std::optional<VkDeviceSize> got,
+            std::optional<VkDeviceSize> expected) {
+  if (got == expected)
+    return;
+  printf("%s: got %lld, expected %lld\n", what, got ? (long long)*got : -1ll,
+         expected ? (long long)*expected : -1ll);
+  g_ok = false;
+}
+
+int main() {
+  RangeAllocator ranges;
+  ranges.reset(1000);
+  expect("first", ranges.allocate(100, 1), 0);
+  expect("second", ranges.allocate(200, 1), 100);
+  expect("third", ranges.allocate(300, 1), 300);
+
+  // [100, 300) and [600, 1000) are free, the hole fits 150 best
+  ranges.free(100, 200);
+  expect("best fit", ranges.allocate(150, 1), 100);
+  expect("exact fit", ranges.allocate(50, 1), 250);
+  expect("free bytes", ranges.freeBytes(), 400);
+  expect("too large", ranges.allocate(401, 1), std::nullopt);
+
+  // freeing everything merges back into one range
+  for (auto [offset, size] : {std::pair<VkDeviceSize, VkDeviceSize>{0, 100},
+                              {300, 300},
+                              {100, 150},
+                              {250, 50}})
+    ranges.free(offset, size);
+  expect("merged", ranges.freeBytes(), 1000);
+  expect("whole", ranges.allocate(1000, 1), 0);
+
+  // alignments need not be powers of two, the padding stays free and merges
+  // with the range in front when that is freed
+  ranges.reset(100);
+  expect("unaligned", ranges.allocate(10, 1), 0);
+  expect("aligned to 12", ranges.allocate(9, 12), 12);
+  ranges.free(0, 10);
+  expect("padding", ranges.allocate(12, 1), 0);
+  expect("aligned to 7", ranges.allocate(5, 7), 21);
+  expect("free bytes", ranges.freeBytes(), 74);
+
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
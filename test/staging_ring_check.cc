@@ -0,0 +1,118 @@
+// Runs StagingRing against fake fences and checks where allocations land,
+// how they wrap and when the space behind a fence comes back.
+#include "DataType/StagingRing.hpp"
+
+#include <cstdio>
+#include <set>
+
+using namespace myvk;
+using namespace myvk::data;
+
+// The ring only maps one buffer and asks for fence status, so both are faked
+// and the check runs without a device. A fence is any pointer, it signals
+// once it is in g_signaled.
+namespace {
+std::vector<u8>         g_memory;
+std::set<VkFence>       g_signaled;
+u32                     g_waits = 0;
+std::vector<VkFence_T*> g_fences;
+
+VkFence makeFence() {
+  g_fences.push_back(reinterpret_cast<VkFence_T*>(g_fences.size() + 1));
+  return g_fences.back();
+}
+} // namespace
+
+namespace ezvk {
+AllocatedBuffer BufferAllocator::createBuffer(VkBufferCreateInfo* bufferCI,
+                                              VmaAllocationCreateInfo*) {
+  g_memory.assign(bufferCI->size, 0);
+  AllocatedBuffer ret{};
+  ret.size = bufferCI->size;
+  return ret;
+}
+void BufferAllocator::destroyBuffer(AllocatedBuffer&) {
+  g_memory = {};
+}
+} // namespace ezvk
+
+VkResult vmaMapMemory(VmaAllocator, VmaAllocation, void** data) {
+  *data = g_memory.data();
+  return VK_SUCCESS;
+}
+void vmaUnmapMemory(VmaAllocator, VmaAllocation) {}
+
+VkResult vkGetFenceStatus(VkDevice, VkFence fence) {
+  return g_signaled.count(fence) ? VK_SUCCESS : VK_NOT_READY;
+}
+VkResult vkWaitForFences(VkDevice, uint32_t count, const VkFence* fences,
+                         VkBool32, uint64_t) {
+  for (u32 i = 0; i < count; ++i)
+    g_signaled.insert(fences[i]);
+  ++g_waits;
+  return VK_SUCCESS;
+}
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+int main() {
+  ezvk::BufferAllocator allocator;
+  StagingRing           ring;
+  ring.create(allocator, VK_NULL_HANDLE, 1024);
+  expect(ring.capacity() == 1024, "capacity");
+
+  StagingRing::Span first = ring.allocate(400, 400);
+  VkFence           fence1 = makeFence();
+  ring.fence(fence1);
+  // the next one starts aligned behind the first
+  StagingRing::Span second = ring.allocate(390, 390);
+  VkFence           fence2 = makeFence();
+  ring.fence(fence2);
+  expect(first.offset == 0 && first.size == 400, "first");
+  expect(second.offset == 400 && second.size == 390, "second");
+  expect(second.data == first.data + 400, "mapped pointer");
+
+  // 224 bytes are left at the end, too short for 400, so the ring wraps and
+  // waits for the first fence to get its space back
+  StagingRing::Span wrapped = ring.allocate(400, 400);
+  expect(wrapped.offset == 0 && wrapped.size == 400, "wrap");
+  expect(g_waits == 1 && g_signaled.count(fence1), "wait for the oldest");
+  VkFence fence3 = makeFence();
+  ring.fence(fence3);
+
+  // the second fence signaled, so its space is retired without waiting,
+  // and an allocation that does not fit takes what is free down to its
+  // minimum
+  g_signaled.insert(fence2);
+  StagingRing::Span partial = ring.allocate(600, 100);
+  expect(partial.offset == 400 && partial.size == 390, "partial");
+  expect(g_waits == 1, "no wait for a signaled fence");
+  VkFence fence4 = makeFence();
+  ring.fence(fence4);
+
+  // release() gives up on fences, their space is free right away
+  ring.release(fence3);
+  ring.release(fence4);
+  StagingRing::Span released = ring.allocate(1000, 16);
+  expect(released.offset == 800 && released.size == 224, "released");
+  expect(g_waits == 1, "no wait for released fences");
+  ring.destroy();
+
+  // bytes that are not fenced yet can not be waited for
+  ring.create(allocator, VK_NULL_HANDLE, 1024);
+  StagingRing::Span whole = ring.allocate(1024, 1024);
+  StagingRing::Span none  = ring.allocate(16, 16);
+  expect(whole.size == 1024, "whole ring");
+  expect(none.size == 0 && none.data == nullptr, "full without fences");
+  ring.destroy();
+
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
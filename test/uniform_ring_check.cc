@@ -0,0 +1,104 @@
+// Pushes uniform blocks through UniformRing and checks their aligned
+// offsets, that a full slice refuses pushes instead of overwriting earlier
+// blocks and that frames take turns on the slices.
+#include "DataType/UniformRing.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace myvk;
+using namespace myvk::data;
+
+// The ring maps one buffer, asks for the offset alignment and flushes its
+// writes, all of which are faked so the check runs without a device.
+namespace {
+constexpr VkDeviceSize kAlignment = 256;
+
+std::vector<u8> g_memory;
+VkDeviceSize    g_flushOffset = 0, g_flushSize = 0;
+} // namespace
+
+namespace ezvk {
+AllocatedBuffer BufferAllocator::createBuffer(VkBufferCreateInfo* bufferCI,
+                                              VmaAllocationCreateInfo*) {
+  g_memory.assign(bufferCI->size, 0);
+  AllocatedBuffer ret{};
+  ret.size = bufferCI->size;
+  return ret;
+}
+void BufferAllocator::destroyBuffer(AllocatedBuffer&) {
+  g_memory = {};
+}
+} // namespace ezvk
+
+void vkGetPhysicalDeviceProperties(VkPhysicalDevice,
+                                   VkPhysicalDeviceProperties* properties) {
+  *properties                                        = {};
+  properties->limits.minUniformBufferOffsetAlignment = kAlignment;
+}
+VkResult vmaMapMemory(VmaAllocator, VmaAllocation, void** data) {
+  *data = g_memory.data();
+  return VK_SUCCESS;
+}
+void     vmaUnmapMemory(VmaAllocator, VmaAllocation) {}
+VkResult vmaFlushAllocation(VmaAllocator, VmaAllocation, VkDeviceSize offset,
+                            VkDeviceSize size) {
+  g_flushOffset = offset;
+  g_flushSize   = size;
+  return VK_SUCCESS;
+}
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+int main() {
+  ezvk::BufferAllocator allocator;
+  UniformRing           ring;
+  // slices are rounded up to the alignment, 1000 bytes take 1024
+  ring.create(allocator, VK_NULL_HANDLE, 1000, 3);
+  expect(g_memory.size() == 3 * 1024, "slice size");
+
+  u8 block[1024];
+  std::memset(block, 0xAB, sizeof(block));
+  ring.beginFrame(0);
+  expect(ring.push(block, 100) == 0u, "first block");
+  expect(ring.push(block, 300) == 256u, "aligned block");
+  expect(ring.push(block, 16) == 768u, "third block");
+  // the slice is used up to 1024, the push fails and nothing moves
+  std::memset(block, 0xCD, sizeof(block));
+  expect(!ring.push(block, 300), "full slice");
+  expect(!ring.push(block, 1), "still full");
+  expect(ring.frameUsed() == 1024, "used bytes");
+  expect(g_memory[0] == 0xAB && g_memory[1023] == 0,
+         "earlier blocks are untouched");
+  expect(g_memory[1024] == 0, "the next slice is untouched");
+  ring.endFrame();
+  expect(g_flushOffset == 0 && g_flushSize == 1024, "flushed slice");
+
+  // a block may take the whole slice
+  ring.beginFrame(1);
+  expect(ring.push(block, 1024) == 1024u, "whole slice");
+  expect(!ring.push(block, 1), "nothing after a whole slice");
+  expect(g_memory[2048] == 0, "the last slice is untouched");
+  ring.endFrame();
+  expect(g_flushOffset == 1024 && g_flushSize == 1024, "flushed second");
+
+  // frame 3 is back on the first slice
+  ring.beginFrame(3);
+  expect(ring.frameUsed() == 0, "a new frame starts empty");
+  expect(ring.push(block, 8) == 0u, "first slice again");
+  ring.beginFrame(5);
+  expect(ring.push(block, 8) == 2048u, "last slice");
+  ring.endFrame();
+  expect(g_flushOffset == 2048 && g_flushSize == 256, "flushed aligned");
+  ring.destroy();
+
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Packs vertices with PackVertex and checks how far positions, normals and
+// uvs move once they are unpacked the way the vertex shader does.
+#include "DataType/VertexFormat.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <glm/gtc/packing.hpp>
+#include <random>
+
+using namespace myvk;
+using namespace myvk::data;
+
+bool g_ok = true;
+
+void expect(bool condition, const char* what) {
+  if (condition)
+    return;
+  printf("%s\n", what);
+  g_ok = false;
+}
+
+// R16G16B16A16_UNORM and R16G16_SNORM as the input assembler reads them
+glm::vec3 unpackPosition(const PackedVertex& v, const VertexQuantization& q) {
+  return q.offset + glm::vec3(v.pos.x, v.pos.y, v.pos.z) / 65535.f * q.scale;
+}
+glm::vec3 unpackNormal(const PackedVertex& v) {
+  return OctDecode(glm::max(glm::vec2(v.norm.x, v.norm.y) / 32767.f, -1.f));
+}
+
+float angleBetween(const glm::vec3& a, const glm::vec3& b) {
+  return std::acos(glm::clamp(glm::dot(a, b), -1.f, 1.f));
+}
+
+int main() {
+  glm::vec3          boundsMin{-3.f, 0.5f, -100.f}, boundsMax{5.f, 0.75f, 20.f};
+  VertexQuantization quantization =
+      VertexQuantization::FromBounds(boundsMin, boundsMax);
+
+  std::mt19937                          random(3);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  std::normal_distribution<float>       gauss;
+
+  // half a step of the 16 bit grid on every axis, plus float slack
+  glm::vec3 maxPosError = quantization.scale / 65535.f * 0.5f + 1e-5f;
+  // an octahedral snorm16 normal is a few hundredths of a degree off
+  float maxNormalError = glm::radians(0.06f);
+  bool  posOk = true, normalOk = true, uvOk = true;
+  for (u32 i = 0; i < 200000; ++i) {
+    Vertex v{};
+    v.pos = boundsMin + glm::vec3(unit(random), unit(random), unit(random)) *
+                            (boundsMax - boundsMin);
+    v.norm =
+        glm::normalize(glm::vec3(gauss(random), gauss(random), gauss(random)));
+    v.uv = {unit(random) * 4.f - 2.f, unit(random)};
+
+    PackedVertex packed = PackVertex(v, quantization);
+    glm::vec3    pos    = unpackPosition(packed, quantization);
+    if (glm::any(glm::greaterThan(glm::abs(pos - v.pos), maxPosError)))
+      posOk = false;
+    if (angleBetween(unpackNormal(packed), v.norm) > maxNormalError)
+      normalOk = false;
+    glm::vec2 uv = {glm::unpackHalf1x16(packed.uv.x),
+                    glm::unpackHalf1x16(packed.uv.y)};
+    // half floats keep 11 significant bits
+    if (glm::any(glm::greaterThan(glm::abs(uv - v.uv),
+                                  glm::abs(v.uv) / 2048.f + 1e-7f)))
+      uvOk = false;
+  }
+  expect(posOk, "position error");
+  expect(normalOk, "normal error");
+  expect(uvOk, "uv error");
+
+  // the axes, the folded lower hemisphere and the bounds corners are exact
+  for (glm::vec3 axis : {glm::vec3(1, 0, 0), glm::vec3(0, -1, 0),
+                         glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)}) {
+    glm::vec3 decoded = OctDecode(OctEncode(axis));
+    expect(glm::all(glm::lessThan(glm::abs(decoded - axis), glm::vec3(1e-6f))),
+           "axis normal");
+  }
+  Vertex corner{};
+  corner.pos = boundsMax;
+  expect(unpackPosition(PackVertex(corner, quantization), quantization) ==
+             boundsMax,
+         "upper corner");
+  corner.pos = boundsMin;
+  PackedVertex lower = PackVertex(corner, quantization);
+  expect(lower.pos.x == 0 && lower.pos.y == 0 && lower.pos.z == 0,
+         "lower corner");
+
+  // flat bounds keep a scale of one, so the axis does not divide by zero
+  VertexQuantization flat =
+      VertexQuantization::FromBounds({0.f, 2.f, 0.f}, {1.f, 2.f, 1.f});
+  expect(flat.scale.y == 1.f, "flat bounds");
+  expect(OctEncode(glm::vec3(0.f)) == glm::vec2(0.f), "zero normal");
+
+  puts(g_ok ? "ok" : "FAILED");
+  return g_ok ? 0 : 1;
+}